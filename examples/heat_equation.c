@@ -0,0 +1,123 @@
+#include <petscksp.h>
+#include "../src/solver.h"
+#include "../src/matrix_utils.h"
+
+// Источник тепла: гауссово пятно, движущееся по окружности вокруг центра области
+static PetscErrorCode heat_source(DM da, PetscReal t, PetscReal h, Vec f) {
+    PetscErrorCode ierr;
+    DMDALocalInfo info;
+    PetscScalar **arr;
+    PetscReal xc = 0.5 + 0.25 * PetscCosReal(2.0 * PETSC_PI * t), yc = 0.5 + 0.25 * PetscSinReal(2.0 * PETSC_PI * t);
+    PetscInt i, j;
+    
+    ierr = DMDAGetLocalInfo(da, &info); CHKERRQ(ierr);
+    ierr = DMDAVecGetArray(da, f, &arr); CHKERRQ(ierr);
+    for (j = info.ys; j < info.ys + info.ym; j++) {
+        for (i = info.xs; i < info.xs + info.xm; i++) {
+            PetscReal x = (i + 1) * h, y = (j + 1) * h;
+            arr[j][i] = 100.0 * PetscExpReal(-((x - xc) * (x - xc) + (y - yc) * (y - yc)) / 0.01);
+        }
+    }
+    ierr = DMDAVecRestoreArray(da, f, &arr); CHKERRQ(ierr);
+    return 0;
+}
+
+// Неявная схема Эйлера для u_t = Δu + f(t) на [0,1]^2, u = 0 на границе:
+// (I/dt - Δ_h) u^{n+1} = u^n/dt + f(t_{n+1}); в масштабе сеточного оператора
+// (4, -1) это (L + h^2/dt I) u^{n+1} = (h^2/dt) u^n + h^2 f
+static PetscErrorCode heat_run(Mat A, DM da, const char *pc_type, SolverGuessType guess, PetscInt guess_size,
+                               PetscInt steps, PetscReal dt, PetscReal h, PetscInt iterations[], PetscLogDouble *solve_time,
+                               PetscInt *pc_builds) {
+    PetscErrorCode ierr;
+    SolverSession session;
+    SolverResult result;
+    Vec u, b, f;
+    PetscInt step;
+    
+    // Матрица не меняется между шагами: сессия строит предобуславливатель один раз
+    ierr = solver_session_create(&session, A); CHKERRQ(ierr);
+    ierr = solver_set_preconditioner(&session.solver, pc_type); CHKERRQ(ierr);
+    ierr = solver_set_initial_guess(&session.solver, guess, guess_size); CHKERRQ(ierr);
+    
+    ierr = DMCreateGlobalVector(da, &u); CHKERRQ(ierr);
+    ierr = VecDuplicate(u, &b); CHKERRQ(ierr);
+    ierr = VecDuplicate(u, &f); CHKERRQ(ierr);
+    ierr = VecSet(u, 0.0); CHKERRQ(ierr);
+    
+    *solve_time = 0.0;
+    for (step = 0; step < steps; step++) {
+        ierr = heat_source(da, (step + 1) * dt, h, f); CHKERRQ(ierr);
+        ierr = VecAXPBYPCZ(b, h * h / dt, h * h, 0.0, u, f); CHKERRQ(ierr);
+        // u^n остаётся в u и служит начальным приближением для SOLVER_GUESS_LAST
+        ierr = solver_session_solve(&session, b, u, &result); CHKERRQ(ierr);
+        iterations[step] = result.iterations;
+        *solve_time += result.solve_time;
+        if (!result.converged) {
+            PetscPrintf(PETSC_COMM_WORLD, "Warning: step %" PetscInt_FMT " did not converge\n", step);
+        }
+    }
+    *pc_builds = session.pc_builds;
+    
+    ierr = solver_session_destroy(&session); CHKERRQ(ierr);
+    ierr = VecDestroy(&u); CHKERRQ(ierr);
+    ierr = VecDestroy(&b); CHKERRQ(ierr);
+    ierr = VecDestroy(&f); CHKERRQ(ierr);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    PetscErrorCode ierr;
+    Mat A;
+    DM da;
+    PetscInt nx = 65, steps = 50, guess_size = 8, step, *its_zero, *its_guess, total_zero = 0, total_guess = 0;
+    PetscInt builds_zero, builds_guess;
+    PetscReal dt = 1e-3, h;
+    PetscLogDouble time_zero, time_guess;
+    char pc_type[64] = PCMG, guess_name[32] = "fischer";
+    SolverGuessType guess;
+    PetscBool found;
+    
+    ierr = solver_initialize(argc, argv); CHKERRQ(ierr);
+    
+    // Получение параметров из командной строки
+    ierr = PetscOptionsGetInt(NULL, NULL, "-nx", &nx, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetInt(NULL, NULL, "-steps", &steps, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetReal(NULL, NULL, "-dt", &dt, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetString(NULL, NULL, "-pc_type", pc_type, sizeof(pc_type), NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetString(NULL, NULL, "-guess", guess_name, sizeof(guess_name), NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetInt(NULL, NULL, "-guess_size", &guess_size, NULL); CHKERRQ(ierr);
+    ierr = solver_guess_type_from_string(guess_name, &guess, &found); CHKERRQ(ierr);
+    if (!found) SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_ARG_WRONG, "Unknown -guess (none, last, fischer)");
+    
+    h = 1.0 / (nx + 1);
+    PetscPrintf(PETSC_COMM_WORLD, "Heat equation: %" PetscInt_FMT " x %" PetscInt_FMT " grid, %" PetscInt_FMT " steps, dt = %g, initial guess: %s\n",
+                nx, nx, steps, (double)dt, guess_name);
+    
+    // Оператор L + (h^2/dt) I на сетке DMDA собирается один раз
+    ierr = create_poisson_grid(2, nx, nx, 1, &da); CHKERRQ(ierr);
+    ierr = create_poisson_grid_matrix(da, &A); CHKERRQ(ierr);
+    ierr = MatShift(A, h * h / dt); CHKERRQ(ierr);
+    
+    // Одни и те же шаги с нулевым начальным приближением и с выбранным
+    ierr = PetscMalloc2(steps, &its_zero, steps, &its_guess); CHKERRQ(ierr);
+    ierr = heat_run(A, da, pc_type, SOLVER_GUESS_ZERO, 0, steps, dt, h, its_zero, &time_zero, &builds_zero); CHKERRQ(ierr);
+    ierr = heat_run(A, da, pc_type, guess, guess_size, steps, dt, h, its_guess, &time_guess, &builds_guess); CHKERRQ(ierr);
+    
+    PetscPrintf(PETSC_COMM_WORLD, "%6s %10s %10s\n", "step", "zero", guess_name);
+    for (step = 0; step < steps; step++) {
+        PetscPrintf(PETSC_COMM_WORLD, "%6" PetscInt_FMT " %10" PetscInt_FMT " %10" PetscInt_FMT "\n", step, its_zero[step], its_guess[step]);
+        total_zero += its_zero[step];
+        total_guess += its_guess[step];
+    }
+    PetscPrintf(PETSC_COMM_WORLD, "Total iterations: %" PetscInt_FMT " (zero guess) vs %" PetscInt_FMT " (%s)\n", total_zero, total_guess, guess_name);
+    PetscPrintf(PETSC_COMM_WORLD, "Solve time: %g vs %g seconds\n", time_zero, time_guess);
+    PetscPrintf(PETSC_COMM_WORLD, "Preconditioner builds: %" PetscInt_FMT " vs %" PetscInt_FMT "\n", builds_zero, builds_guess);
+    
+    // Очистка
+    ierr = PetscFree2(its_zero, its_guess); CHKERRQ(ierr);
+    ierr = MatDestroy(&A); CHKERRQ(ierr);
+    ierr = DMDestroy(&da); CHKERRQ(ierr);
+    
+    ierr = solver_finalize();
+    return ierr;
+}
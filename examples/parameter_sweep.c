@@ -0,0 +1,60 @@
+#include <petscksp.h>
+#include "../src/solver.h"
+#include "../src/matrix_utils.h"
+#include "../src/ensemble.h"
+
+typedef struct {
+    PetscInt nx_min, nx_step;
+    PetscReal shift;
+} SweepContext;
+
+// Система index: оператор Пуассона на своей сетке со своим сдвигом -
+// размеры и число итераций у систем разные
+static PetscErrorCode sweep_system(MPI_Comm comm, PetscInt index, Mat *A, Vec *b, void *ctx) {
+    PetscErrorCode ierr;
+    SweepContext *sweep = (SweepContext *)ctx;
+    PetscInt nx = sweep->nx_min + sweep->nx_step * (index % 8);
+    
+    ierr = create_poisson2d_matrix_comm(comm, nx, nx, A); CHKERRQ(ierr);
+    ierr = MatShift(*A, sweep->shift * (index % 5)); CHKERRQ(ierr);
+    *b = NULL;
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    PetscErrorCode ierr;
+    SweepContext sweep = {16, 8, 0.05};
+    SolverConfig config = {KSPGMRES, PCJACOBI, 30};
+    EnsembleStats serial, ensemble;
+    PetscMPIInt size;
+    PetscInt nsystems = 64, group_size = 1;
+    
+    ierr = solver_initialize(argc, argv); CHKERRQ(ierr);
+    ierr = MPI_Comm_size(PETSC_COMM_WORLD, &size); CHKERRMPI(ierr);
+    
+    // Получение параметров из командной строки
+    ierr = PetscOptionsGetInt(NULL, NULL, "-systems", &nsystems, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetInt(NULL, NULL, "-group_size", &group_size, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetInt(NULL, NULL, "-nx_min", &sweep.nx_min, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetInt(NULL, NULL, "-nx_step", &sweep.nx_step, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetReal(NULL, NULL, "-shift", &sweep.shift, NULL); CHKERRQ(ierr);
+    
+    PetscPrintf(PETSC_COMM_WORLD, "Parameter sweep: %" PetscInt_FMT " systems on %d ranks\n", nsystems, size);
+    
+    // Те же системы по очереди на всех процессах и группами по group_size
+    ierr = ensemble_run(nsystems, size, &config, sweep_system, NULL, &sweep, &serial); CHKERRQ(ierr);
+    ierr = ensemble_run(nsystems, group_size, &config, sweep_system, NULL, &sweep, &ensemble); CHKERRQ(ierr);
+    
+    ierr = ensemble_print_stats(&serial); CHKERRQ(ierr);
+    ierr = ensemble_print_stats(&ensemble); CHKERRQ(ierr);
+    PetscPrintf(PETSC_COMM_WORLD, "Throughput: %.2f vs %.2f solves/s (x%.2f)\n",
+                (double)serial.solves_per_second, (double)ensemble.solves_per_second,
+                serial.solves_per_second > 0.0 ? (double)(ensemble.solves_per_second / serial.solves_per_second) : 0.0);
+    
+    // Очистка
+    ierr = ensemble_stats_destroy(&serial); CHKERRQ(ierr);
+    ierr = ensemble_stats_destroy(&ensemble); CHKERRQ(ierr);
+    
+    ierr = solver_finalize();
+    return ierr;
+}
@@ -1,82 +1,48 @@
 #include <petscksp.h>
 #include "../src/solver.h"
 #include "../src/matrix_utils.h"
-
-PetscErrorCode create_poisson2d_matrix(PetscInt nx, PetscInt ny, Mat *A) {
-    PetscErrorCode ierr;
-    PetscInt n = nx * ny;
-    PetscInt i, j, Istart, Iend;
-    PetscScalar v[5];
-    PetscInt col[5];
-    
-    ierr = MatCreate(PETSC_COMM_WORLD, A); CHKERRQ(ierr);
-    ierr = MatSetSizes(*A, PETSC_DECIDE, PETSC_DECIDE, n, n); CHKERRQ(ierr);
-    ierr = MatSetFromOptions(*A); CHKERRQ(ierr);
-    ierr = MatSetUp(*A); CHKERRQ(ierr);
-    
-    ierr = MatGetOwnershipRange(*A, &Istart, &Iend); CHKERRQ(ierr);
-    
-    for (i = Istart; i < Iend; i++) {
-        PetscInt ix = i % nx;
-        PetscInt iy = i / nx;
-        PetscInt count = 0;
-        
-        // Center
-        v[count] = 4.0; col[count] = i; count++;
-        
-        // Left
-        if (ix > 0) {
-            v[count] = -1.0; col[count] = i - 1; count++;
-        }
-        
-        // Right
-        if (ix < nx - 1) {
-            v[count] = -1.0; col[count] = i + 1; count++;
-        }
-        
-        // Bottom
-        if (iy > 0) {
-            v[count] = -1.0; col[count] = i - nx; count++;
-        }
-        
-        // Top
-        if (iy < ny - 1) {
-            v[count] = -1.0; col[count] = i + nx; count++;
-        }
-        
-        ierr = MatSetValues(*A, 1, &i, count, col, v, INSERT_VALUES); CHKERRQ(ierr);
-    }
-    
-    ierr = MatAssemblyBegin(*A, MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
-    ierr = MatAssemblyEnd(*A, MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
-    
-    return 0;
-}
+#include "../src/stencil_operator.h"
 
 int main(int argc, char **argv) {
     PetscErrorCode ierr;
     LinearSolver solver;
     Mat A;
-    Vec b, x;
-    PetscInt nx = 50, ny = 50;
+    Vec b;
+    DM da = NULL;
+    PetscInt nx = 65, ny = 65;
     PetscInt n;
+    PetscLogDouble assembly_time;
+    PetscBool matrix_free = PETSC_FALSE;
+    char pc_type[64] = PCMG;
     
     ierr = solver_initialize(argc, argv); CHKERRQ(ierr);
     
     // Получение параметров из командной строки
     ierr = PetscOptionsGetInt(NULL, NULL, "-nx", &nx, NULL); CHKERRQ(ierr);
     ierr = PetscOptionsGetInt(NULL, NULL, "-ny", &ny, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetBool(NULL, NULL, "-matrix_free", &matrix_free, NULL); CHKERRQ(ierr);
+    // Безматричному оператору многосеточный недоступен
+    if (matrix_free) { ierr = PetscStrncpy(pc_type, PCJACOBI, sizeof(pc_type)); CHKERRQ(ierr); }
+    ierr = PetscOptionsGetString(NULL, NULL, "-pc_type", pc_type, sizeof(pc_type), NULL); CHKERRQ(ierr);
     
     n = nx * ny;
     PetscPrintf(PETSC_COMM_WORLD, "Solving 2D Poisson problem: %D x %D grid (%D unknowns)\n", nx, ny, n);
     
-    // Создание матрицы и векторов
-    ierr = create_poisson2d_matrix(nx, ny, &A); CHKERRQ(ierr);
-    ierr = create_rhs_vector(n, &b); CHKERRQ(ierr);
+    // Создание матрицы и векторов: сетка DMDA, для PCMG она же задаёт уровни
+    if (matrix_free) {
+        ierr = create_poisson2d_operator(nx, ny, &A); CHKERRQ(ierr);
+        ierr = create_rhs_vector(n, &b); CHKERRQ(ierr);
+    } else {
+        ierr = create_poisson_grid(2, nx, ny, 1, &da); CHKERRQ(ierr);
+        ierr = create_poisson_grid_matrix(da, &A); CHKERRQ(ierr);
+        ierr = create_grid_rhs_vector(da, &b); CHKERRQ(ierr);
+        ierr = get_last_assembly_time(&assembly_time); CHKERRQ(ierr);
+        PetscPrintf(PETSC_COMM_WORLD, "Assembly time: %g seconds\n", assembly_time);
+    }
     
     // Решение
     ierr = solver_create(&solver, A); CHKERRQ(ierr);
-    ierr = solver_set_preconditioner(&solver, PCJACOBI); CHKERRQ(ierr);
+    ierr = solver_set_preconditioner(&solver, pc_type); CHKERRQ(ierr);
     ierr = solver_setup(&solver); CHKERRQ(ierr);
     
     ierr = solver_solve(&solver, b, solver.x); CHKERRQ(ierr);
@@ -86,6 +52,7 @@ int main(int argc, char **argv) {
     ierr = solver_destroy(&solver); CHKERRQ(ierr);
     ierr = MatDestroy(&A); CHKERRQ(ierr);
     ierr = VecDestroy(&b); CHKERRQ(ierr);
+    ierr = DMDestroy(&da); CHKERRQ(ierr);
     
     ierr = solver_finalize();
     return ierr;
@@ -0,0 +1,49 @@
+#include <petscksp.h>
+#include "../src/solver.h"
+#include "../src/matrix_utils.h"
+
+int main(int argc, char **argv) {
+    PetscErrorCode ierr;
+    LinearSolver solver;
+    Mat A;
+    Vec b;
+    DM da;
+    PetscInt nx = 33, ny = 33, nz = 33;
+    PetscLogDouble assembly_time;
+    char pc_type[64] = PCMG;
+    
+    ierr = solver_initialize(argc, argv); CHKERRQ(ierr);
+    
+    // Получение параметров из командной строки; (n - 1) кратно степени 2 - больше уровней PCMG
+    ierr = PetscOptionsGetInt(NULL, NULL, "-nx", &nx, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetInt(NULL, NULL, "-ny", &ny, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetInt(NULL, NULL, "-nz", &nz, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetString(NULL, NULL, "-pc_type", pc_type, sizeof(pc_type), NULL); CHKERRQ(ierr);
+    
+    PetscPrintf(PETSC_COMM_WORLD, "Solving 3D Poisson problem: %" PetscInt_FMT " x %" PetscInt_FMT " x %" PetscInt_FMT " grid (%" PetscInt_FMT " unknowns)\n",
+                nx, ny, nz, nx * ny * nz);
+    
+    // 7-точечный шаблон на сетке DMDA
+    ierr = create_poisson_grid(3, nx, ny, nz, &da); CHKERRQ(ierr);
+    ierr = create_poisson_grid_matrix(da, &A); CHKERRQ(ierr);
+    ierr = create_grid_rhs_vector(da, &b); CHKERRQ(ierr);
+    ierr = get_last_assembly_time(&assembly_time); CHKERRQ(ierr);
+    PetscPrintf(PETSC_COMM_WORLD, "Assembly time: %g seconds\n", assembly_time);
+    
+    // Решение
+    ierr = solver_create(&solver, A); CHKERRQ(ierr);
+    ierr = solver_set_preconditioner(&solver, pc_type); CHKERRQ(ierr);
+    ierr = solver_setup(&solver); CHKERRQ(ierr);
+    
+    ierr = solver_solve(&solver, b, solver.x); CHKERRQ(ierr);
+    ierr = solver_print_info(&solver); CHKERRQ(ierr);
+    
+    // Очистка
+    ierr = solver_destroy(&solver); CHKERRQ(ierr);
+    ierr = MatDestroy(&A); CHKERRQ(ierr);
+    ierr = VecDestroy(&b); CHKERRQ(ierr);
+    ierr = DMDestroy(&da); CHKERRQ(ierr);
+    
+    ierr = solver_finalize();
+    return ierr;
+}
@@ -0,0 +1,37 @@
+#!/bin/bash
+
+set -e
+
+# Strong/weak scaling: один CSV с результатами для разного числа процессов
+cd build
+
+NPROCS=${NPROCS:-"1 2 4 8"}
+SIZES=${SIZES:-"100000"}
+OUTPUT=${OUTPUT:-"benchmark.csv"}
+
+rm -f "$OUTPUT"
+
+# Разбиения ranks x threads при фиксированном числе ядер (сборка с OpenMP):
+# CORES=128 SPLITS="128 32 8 2", потоков на процесс - CORES/np; привязка процессов
+# к ядрам задается через MPIRUN_FLAGS (например, "--map-by ppr:8:node:pe=16" в Open MPI)
+if [ -n "$CORES" ]; then
+    SPLITS=${SPLITS:-"$CORES"}
+    for np in $SPLITS; do
+        threads=$((CORES / np))
+        echo "Running $np ranks x $threads threads..."
+        OMP_NUM_THREADS="$threads" OMP_PROC_BIND=close OMP_PLACES=cores \
+            mpirun -np "$np" $MPIRUN_FLAGS ./petsc_solver -benchmark -threads "$threads" \
+            -bench_sizes "$(echo $SIZES | tr ' ' ',')" \
+            -bench_output "$OUTPUT" -bench_append "$@"
+    done
+    exit 0
+fi
+
+for scaling in strong weak; do
+    for np in $NPROCS; do
+        echo "Running $scaling scaling benchmark with $np processes..."
+        mpirun -np "$np" ./petsc_solver -benchmark -bench_scaling "$scaling" \
+            -bench_sizes "$(echo $SIZES | tr ' ' ',')" \
+            -bench_output "$OUTPUT" -bench_append "$@"
+    done
+done
@@ -0,0 +1,337 @@
+#include "benchmark.h"
+#include "solver.h"
+#include "matrix_utils.h"
+#include "stencil_operator.h"
+#include "threading.h"
+#include <petsctime.h>
+
+#define BENCHMARK_MAX_LIST 32
+
+// Создание задачи по имени; global_size - фактический размер системы
+PetscErrorCode benchmark_create_problem(const char *problem, PetscInt size, PetscBool weak_scaling, Mat *A, PetscInt *global_size, PetscLogDouble *assembly_time) {
+    PetscErrorCode ierr;
+    PetscMPIInt nranks;
+    PetscInt N = size, nx, nz;
+    PetscBool match;
+    DM da;
+    PetscLogDouble start_time, end_time;
+    
+    ierr = MPI_Comm_size(PETSC_COMM_WORLD, &nranks); CHKERRMPI(ierr);
+    if (weak_scaling) N = size * nranks;
+    nx = (PetscInt)(PetscSqrtReal((PetscReal)N) + 0.5);
+    nz = (PetscInt)(PetscPowReal((PetscReal)N, 1.0 / 3.0) + 0.5);
+    
+    ierr = PetscTime(&start_time); CHKERRQ(ierr);
+    ierr = PetscStrcmp(problem, "laplace", &match); CHKERRQ(ierr);
+    if (match) { ierr = create_laplace_matrix(N, A); CHKERRQ(ierr); goto done; }
+    ierr = PetscStrcmp(problem, "laplace_mf", &match); CHKERRQ(ierr);
+    if (match) { ierr = create_laplace_operator(N, A); CHKERRQ(ierr); goto done; }
+    ierr = PetscStrcmp(problem, "poisson2d", &match); CHKERRQ(ierr);
+    if (match) { N = nx * nx; ierr = create_poisson2d_matrix(nx, nx, A); CHKERRQ(ierr); goto done; }
+    ierr = PetscStrcmp(problem, "poisson2d_mf", &match); CHKERRQ(ierr);
+    if (match) { N = nx * nx; ierr = create_poisson2d_operator(nx, nx, A); CHKERRQ(ierr); goto done; }
+    // Матрица держит ссылку на сетку, DM освобождается вместе с ней
+    ierr = PetscStrcmp(problem, "poisson2d_grid", &match); CHKERRQ(ierr);
+    if (match) {
+        N = nx * nx;
+        ierr = create_poisson_grid(2, nx, nx, 1, &da); CHKERRQ(ierr);
+        ierr = create_poisson_grid_matrix(da, A); CHKERRQ(ierr);
+        ierr = DMDestroy(&da); CHKERRQ(ierr);
+        goto done;
+    }
+    ierr = PetscStrcmp(problem, "poisson3d_grid", &match); CHKERRQ(ierr);
+    if (match) {
+        N = nz * nz * nz;
+        ierr = create_poisson_grid(3, nz, nz, nz, &da); CHKERRQ(ierr);
+        ierr = create_poisson_grid_matrix(da, A); CHKERRQ(ierr);
+        ierr = DMDestroy(&da); CHKERRQ(ierr);
+        goto done;
+    }
+    ierr = PetscStrcmp(problem, "random", &match); CHKERRQ(ierr);
+    if (match) { ierr = create_random_sparse_matrix(N, 5.0 / PetscMax(N - 1, 1), A); CHKERRQ(ierr); goto done; }
+    ierr = PetscStrcmp(problem, "diagonal", &match); CHKERRQ(ierr);
+    if (match) { ierr = create_diagonal_dominant_matrix(N, 2.0, A); CHKERRQ(ierr); goto done; }
+    SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_ARG_WRONG, "Unknown benchmark problem %s", problem);
+
+done:
+    ierr = PetscTime(&end_time); CHKERRQ(ierr);
+    *global_size = N;
+    *assembly_time = end_time - start_time;
+    return 0;
+}
+
+static PetscLogDouble benchmark_min(const PetscLogDouble values[], PetscInt n) {
+    PetscLogDouble m = values[0];
+    PetscInt i;
+    for (i = 1; i < n; i++) m = PetscMin(m, values[i]);
+    return m;
+}
+
+PetscErrorCode benchmark_median(const PetscLogDouble values[], PetscInt n, PetscLogDouble *median) {
+    PetscErrorCode ierr;
+    PetscReal *sorted;
+    PetscInt i;
+    
+    ierr = PetscMalloc1(n, &sorted); CHKERRQ(ierr);
+    for (i = 0; i < n; i++) sorted[i] = values[i];
+    ierr = PetscSortReal(n, sorted); CHKERRQ(ierr);
+    *median = (n % 2) ? sorted[n / 2] : 0.5 * (sorted[n / 2 - 1] + sorted[n / 2]);
+    ierr = PetscFree(sorted); CHKERRQ(ierr);
+    return 0;
+}
+
+// Времена отдельных процессов сводятся к максимуму: конфигурация работает со скоростью самого медленного
+static PetscErrorCode benchmark_reduce_times(SolverResult *result) {
+    PetscErrorCode ierr;
+    PetscLogDouble times[3] = {result->assembly_time, result->setup_time, result->solve_time};
+    
+    ierr = MPI_Allreduce(MPI_IN_PLACE, times, 3, MPI_DOUBLE, MPI_MAX, PETSC_COMM_WORLD); CHKERRMPI(ierr);
+    result->assembly_time = times[0];
+    result->setup_time = times[1];
+    result->solve_time = times[2];
+    return 0;
+}
+
+PetscErrorCode benchmark_write_csv(const char *filename, const BenchmarkRecord records[], PetscInt count) {
+    PetscErrorCode ierr;
+    FILE *fd;
+    PetscBool exists = PETSC_FALSE, append = PETSC_FALSE;
+    PetscInt i;
+    
+    // -bench_append: результаты запусков с разным числом процессов в одном файле
+    ierr = PetscOptionsGetBool(NULL, NULL, "-bench_append", &append, NULL); CHKERRQ(ierr);
+    if (append) { ierr = PetscTestFile(filename, 'r', &exists); CHKERRQ(ierr); }
+    
+    ierr = PetscFOpen(PETSC_COMM_WORLD, filename, exists ? "a" : "w", &fd); CHKERRQ(ierr);
+    if (!exists) {
+        ierr = PetscFPrintf(PETSC_COMM_WORLD, fd, "problem,size,global_size,nranks,nthreads,scaling,ksp,pc,restart,repeats,"
+                            "assembly_min,assembly_median,setup_min,setup_median,solve_min,solve_median,iterations,"
+                            "reductions_per_iteration,time_per_iteration,converged\n"); CHKERRQ(ierr);
+    }
+    for (i = 0; i < count; i++) {
+        const BenchmarkRecord *r = &records[i];
+        ierr = PetscFPrintf(PETSC_COMM_WORLD, fd, "%s,%" PetscInt_FMT ",%" PetscInt_FMT ",%d,%" PetscInt_FMT ",%s,%s,%s,%" PetscInt_FMT ",%" PetscInt_FMT ","
+                            "%.6e,%.6e,%.6e,%.6e,%.6e,%.6e,%" PetscInt_FMT ",%.3f,%.6e,%d\n",
+                            r->problem, r->size, r->global_size, r->nranks, r->nthreads, r->weak_scaling ? "weak" : "strong",
+                            r->ksp_type, r->pc_type, r->restart, r->repeats,
+                            r->assembly_min, r->assembly_median, r->setup_min, r->setup_median,
+                            r->solve_min, r->solve_median, r->iterations,
+                            r->reductions_per_iteration, r->time_per_iteration, (int)r->converged); CHKERRQ(ierr);
+    }
+    ierr = PetscFClose(PETSC_COMM_WORLD, fd); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode benchmark_write_json(const char *filename, const BenchmarkRecord records[], PetscInt count) {
+    PetscErrorCode ierr;
+    FILE *fd;
+    PetscInt i;
+    
+    ierr = PetscFOpen(PETSC_COMM_WORLD, filename, "w", &fd); CHKERRQ(ierr);
+    ierr = PetscFPrintf(PETSC_COMM_WORLD, fd, "[\n"); CHKERRQ(ierr);
+    for (i = 0; i < count; i++) {
+        const BenchmarkRecord *r = &records[i];
+        ierr = PetscFPrintf(PETSC_COMM_WORLD, fd,
+                            "  {\"problem\": \"%s\", \"size\": %" PetscInt_FMT ", \"global_size\": %" PetscInt_FMT ", "
+                            "\"nranks\": %d, \"nthreads\": %" PetscInt_FMT ", \"scaling\": \"%s\", \"ksp\": \"%s\", \"pc\": \"%s\", \"restart\": %" PetscInt_FMT ", "
+                            "\"repeats\": %" PetscInt_FMT ", "
+                            "\"assembly_time\": {\"min\": %.6e, \"median\": %.6e}, "
+                            "\"setup_time\": {\"min\": %.6e, \"median\": %.6e}, "
+                            "\"solve_time\": {\"min\": %.6e, \"median\": %.6e}, "
+                            "\"iterations\": %" PetscInt_FMT ", \"reductions_per_iteration\": %.3f, "
+                            "\"time_per_iteration\": %.6e, \"converged\": %s}%s\n",
+                            r->problem, r->size, r->global_size, r->nranks, r->nthreads, r->weak_scaling ? "weak" : "strong",
+                            r->ksp_type, r->pc_type, r->restart, r->repeats,
+                            r->assembly_min, r->assembly_median, r->setup_min, r->setup_median,
+                            r->solve_min, r->solve_median, r->iterations,
+                            r->reductions_per_iteration, r->time_per_iteration, r->converged ? "true" : "false",
+                            (i + 1 < count) ? "," : ""); CHKERRQ(ierr);
+    }
+    ierr = PetscFPrintf(PETSC_COMM_WORLD, fd, "]\n"); CHKERRQ(ierr);
+    ierr = PetscFClose(PETSC_COMM_WORLD, fd); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode benchmark_get_list(const char *option, char *list[], PetscInt *count, const char *default_value) {
+    PetscErrorCode ierr;
+    PetscBool set;
+    
+    *count = BENCHMARK_MAX_LIST;
+    ierr = PetscOptionsGetStringArray(NULL, NULL, option, list, count, &set); CHKERRQ(ierr);
+    if (!set) {
+        // Значение по умолчанию в том же формате, что и в командной строке
+        char **tokens;
+        int ntokens, i;
+        ierr = PetscStrToArray(default_value, ',', &ntokens, &tokens); CHKERRQ(ierr);
+        *count = PetscMin(ntokens, BENCHMARK_MAX_LIST);
+        for (i = 0; i < *count; i++) {
+            ierr = PetscStrallocpy(tokens[i], &list[i]); CHKERRQ(ierr);
+        }
+        ierr = PetscStrToArrayDestroy(ntokens, tokens); CHKERRQ(ierr);
+    }
+    return 0;
+}
+
+PetscErrorCode run_benchmarks(void) {
+    PetscErrorCode ierr;
+    char *problems[BENCHMARK_MAX_LIST], *pcs[BENCHMARK_MAX_LIST], *ksps[BENCHMARK_MAX_LIST];
+    PetscInt sizes[BENCHMARK_MAX_LIST] = {10000}, restarts[BENCHMARK_MAX_LIST] = {30};
+    PetscInt nproblems, npcs, nksps, nsizes = BENCHMARK_MAX_LIST, nrestarts = BENCHMARK_MAX_LIST;
+    PetscInt repeats = 3, warmup = 1, nconfigs, ip, is, ic, ir, i;
+    PetscInt nrecords = 0;
+    BenchmarkRecord *records;
+    PetscLogDouble *assembly, *setup, *solve;
+    PetscInt *iterations;
+    PetscLogDouble *reductions;
+    PetscBool *converged, *skipped, shell, set, weak_scaling = PETSC_FALSE, json = PETSC_FALSE;
+    char scaling[16] = "strong", format[16] = "csv", output[PETSC_MAX_PATH_LEN] = "";
+    PetscMPIInt nranks;
+    
+    ierr = MPI_Comm_size(PETSC_COMM_WORLD, &nranks); CHKERRMPI(ierr);
+    
+    ierr = benchmark_get_list("-bench_problems", problems, &nproblems, "laplace,poisson2d"); CHKERRQ(ierr);
+    ierr = benchmark_get_list("-bench_pcs", pcs, &npcs, "jacobi,bjacobi,none"); CHKERRQ(ierr);
+    ierr = benchmark_get_list("-bench_ksps", ksps, &nksps, "gmres"); CHKERRQ(ierr);
+    ierr = PetscOptionsGetIntArray(NULL, NULL, "-bench_sizes", sizes, &nsizes, &set); CHKERRQ(ierr);
+    if (!set) nsizes = 1;
+    ierr = PetscOptionsGetIntArray(NULL, NULL, "-bench_restarts", restarts, &nrestarts, &set); CHKERRQ(ierr);
+    if (!set) nrestarts = 1;
+    ierr = PetscOptionsGetInt(NULL, NULL, "-bench_repeat", &repeats, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetInt(NULL, NULL, "-bench_warmup", &warmup, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetString(NULL, NULL, "-bench_scaling", scaling, sizeof(scaling), NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetString(NULL, NULL, "-bench_format", format, sizeof(format), NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetString(NULL, NULL, "-bench_output", output, sizeof(output), NULL); CHKERRQ(ierr);
+    ierr = PetscStrcmp(scaling, "weak", &weak_scaling); CHKERRQ(ierr);
+    ierr = PetscStrcmp(format, "json", &json); CHKERRQ(ierr);
+    if (repeats < 1) SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "-bench_repeat must be positive");
+    if (warmup < 0) SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "-bench_warmup must be non-negative");
+    
+    nconfigs = nksps * npcs * nrestarts;
+    ierr = PetscMalloc1(nproblems * nsizes * nconfigs, &records); CHKERRQ(ierr);
+    ierr = PetscMalloc3(repeats, &assembly, nconfigs * repeats, &setup, nconfigs * repeats, &solve); CHKERRQ(ierr);
+    ierr = PetscMalloc4(nconfigs, &iterations, nconfigs, &reductions, nconfigs, &converged, nconfigs, &skipped); CHKERRQ(ierr);
+    
+    PetscPrintf(PETSC_COMM_WORLD, "Benchmark: %d ranks x %" PetscInt_FMT " threads, %s scaling, %" PetscInt_FMT " repeats\n",
+                nranks, solver_threads_count(), weak_scaling ? "weak" : "strong", repeats);
+    PetscPrintf(PETSC_COMM_WORLD, "%-14s %10s %-10s %-8s %7s %10s %10s %10s %6s %8s %10s %s\n",
+                "problem", "N", "ksp", "pc", "restart", "assembly", "setup", "solve", "its", "red/it", "time/it", "conv");
+    
+    for (ip = 0; ip < nproblems; ip++) {
+        for (is = 0; is < nsizes; is++) {
+            PetscInt N = 0;
+    
+            for (ic = 0; ic < nconfigs; ic++) converged[ic] = PETSC_TRUE;
+    
+            for (ir = -warmup; ir < repeats; ir++) {
+                Mat A;
+                Vec b, x;
+                PetscLogDouble assembly_time;
+    
+                // Матрица собирается заново в каждом повторе: время сборки тоже усредняется
+                ierr = benchmark_create_problem(problems[ip], sizes[is], weak_scaling, &A, &N, &assembly_time); CHKERRQ(ierr);
+                // Сборка общая для всех конфигураций, включая пропущенные
+                ierr = MPI_Allreduce(MPI_IN_PLACE, &assembly_time, 1, MPI_DOUBLE, MPI_MAX, PETSC_COMM_WORLD); CHKERRMPI(ierr);
+                if (ir >= 0) assembly[ir] = assembly_time;
+                ierr = MatCreateVecs(A, &x, &b); CHKERRQ(ierr);
+                ierr = VecSet(b, 1.0); CHKERRQ(ierr);
+    
+                ierr = PetscObjectTypeCompare((PetscObject)A, MATSHELL, &shell); CHKERRQ(ierr);
+    
+                for (ic = 0; ic < nconfigs; ic++) {
+                    SolverConfig config;
+                    SolverResult result;
+    
+                    config.ksp_type = ksps[ic / (npcs * nrestarts)];
+                    config.pc_type = pcs[(ic / nrestarts) % npcs];
+                    config.restart = restarts[ic % nrestarts];
+    
+                    // Безматричным операторам доступна только диагональ
+                    skipped[ic] = PETSC_FALSE;
+                    if (shell) {
+                        PetscBool none, jacobi;
+                        ierr = PetscStrcmp(config.pc_type, PCNONE, &none); CHKERRQ(ierr);
+                        ierr = PetscStrcmp(config.pc_type, PCJACOBI, &jacobi); CHKERRQ(ierr);
+                        skipped[ic] = (PetscBool)!(none || jacobi);
+                    }
+                    // Геометрическому многосеточному нужна сетка задачи
+                    if (!skipped[ic]) {
+                        PetscBool mg;
+                        DM dm;
+                        ierr = PetscStrcmp(config.pc_type, PCMG, &mg); CHKERRQ(ierr);
+                        ierr = MatGetDM(A, &dm); CHKERRQ(ierr);
+                        skipped[ic] = (PetscBool)(mg && !dm);
+                    }
+                    if (skipped[ic]) continue;
+    
+                    ierr = VecSet(x, 0.0); CHKERRQ(ierr);
+                    ierr = solver_benchmark_config(A, b, x, &config, &result); CHKERRQ(ierr);
+                    result.assembly_time = assembly_time;
+                    ierr = benchmark_reduce_times(&result); CHKERRQ(ierr);
+    
+                    // Прогревочные повторы не учитываются
+                    if (ir < 0) continue;
+                    setup[ic * repeats + ir] = result.setup_time;
+                    solve[ic * repeats + ir] = result.solve_time;
+                    iterations[ic] = result.iterations;
+                    reductions[ic] = result.reductions;
+                    if (!result.converged) converged[ic] = PETSC_FALSE;
+                }
+    
+                ierr = MatDestroy(&A); CHKERRQ(ierr);
+                ierr = VecDestroy(&b); CHKERRQ(ierr);
+                ierr = VecDestroy(&x); CHKERRQ(ierr);
+            }
+    
+            for (ic = 0; ic < nconfigs; ic++) {
+                BenchmarkRecord *r;
+    
+                if (skipped[ic]) continue;
+                r = &records[nrecords++];
+    
+                ierr = PetscStrncpy(r->problem, problems[ip], BENCHMARK_NAME_LEN); CHKERRQ(ierr);
+                ierr = PetscStrncpy(r->ksp_type, ksps[ic / (npcs * nrestarts)], BENCHMARK_NAME_LEN); CHKERRQ(ierr);
+                ierr = PetscStrncpy(r->pc_type, pcs[(ic / nrestarts) % npcs], BENCHMARK_NAME_LEN); CHKERRQ(ierr);
+                r->size = sizes[is];
+                r->global_size = N;
+                r->restart = restarts[ic % nrestarts];
+                r->nranks = nranks;
+                r->nthreads = solver_threads_count();
+                r->weak_scaling = weak_scaling;
+                r->repeats = repeats;
+                r->assembly_min = benchmark_min(assembly, repeats);
+                ierr = benchmark_median(assembly, repeats, &r->assembly_median); CHKERRQ(ierr);
+                r->setup_min = benchmark_min(setup + ic * repeats, repeats);
+                ierr = benchmark_median(setup + ic * repeats, repeats, &r->setup_median); CHKERRQ(ierr);
+                r->solve_min = benchmark_min(solve + ic * repeats, repeats);
+                ierr = benchmark_median(solve + ic * repeats, repeats, &r->solve_median); CHKERRQ(ierr);
+                r->iterations = iterations[ic];
+                r->reductions_per_iteration = r->iterations ? reductions[ic] / r->iterations : 0.0;
+                r->time_per_iteration = r->iterations ? r->solve_median / r->iterations : 0.0;
+                r->converged = converged[ic];
+    
+                PetscPrintf(PETSC_COMM_WORLD, "%-14s %10" PetscInt_FMT " %-10s %-8s %7" PetscInt_FMT " %10.3e %10.3e %10.3e %6" PetscInt_FMT " %8.2f %10.3e %s\n",
+                            r->problem, r->global_size, r->ksp_type, r->pc_type, r->restart,
+                            r->assembly_median, r->setup_median, r->solve_median, r->iterations,
+                            r->reductions_per_iteration, r->time_per_iteration, r->converged ? "yes" : "no");
+            }
+        }
+    }
+    
+    if (output[0]) {
+        if (json) {
+            ierr = benchmark_write_json(output, records, nrecords); CHKERRQ(ierr);
+        } else {
+            ierr = benchmark_write_csv(output, records, nrecords); CHKERRQ(ierr);
+        }
+        PetscPrintf(PETSC_COMM_WORLD, "Benchmark results written to %s\n", output);
+    }
+    
+    for (i = 0; i < nproblems; i++) { ierr = PetscFree(problems[i]); CHKERRQ(ierr); }
+    for (i = 0; i < npcs; i++) { ierr = PetscFree(pcs[i]); CHKERRQ(ierr); }
+    for (i = 0; i < nksps; i++) { ierr = PetscFree(ksps[i]); CHKERRQ(ierr); }
+    ierr = PetscFree(records); CHKERRQ(ierr);
+    ierr = PetscFree3(assembly, setup, solve); CHKERRQ(ierr);
+    ierr = PetscFree4(iterations, reductions, converged, skipped); CHKERRQ(ierr);
+    
+    return 0;
+}
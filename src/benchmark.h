@@ -0,0 +1,37 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <petscksp.h>
+
+#define BENCHMARK_NAME_LEN 32
+
+// Одна конфигурация бенчмарка и сводка по её повторам (времена - максимум по процессам)
+typedef struct {
+    char problem[BENCHMARK_NAME_LEN];
+    char ksp_type[BENCHMARK_NAME_LEN];
+    char pc_type[BENCHMARK_NAME_LEN];
+    PetscInt size;              // размер из -bench_sizes (на процесс при weak scaling)
+    PetscInt global_size;
+    PetscInt restart;
+    PetscMPIInt nranks;
+    PetscInt nthreads;          // потоков на процесс
+    PetscBool weak_scaling;
+    PetscInt repeats;
+    PetscLogDouble assembly_min, assembly_median;
+    PetscLogDouble setup_min, setup_median;
+    PetscLogDouble solve_min, solve_median;
+    PetscInt iterations;
+    PetscLogDouble reductions_per_iteration;    // глобальные редукции (MPIU_Allreduce) на итерацию
+    PetscLogDouble time_per_iteration;          // медиана времени решения на итерацию
+    PetscBool converged;
+} BenchmarkRecord;
+
+// Режим -benchmark: перебор задач, размеров, предобуславливателей, методов и рестартов
+PetscErrorCode run_benchmarks(void);
+PetscErrorCode benchmark_write_csv(const char *filename, const BenchmarkRecord records[], PetscInt count);
+PetscErrorCode benchmark_write_json(const char *filename, const BenchmarkRecord records[], PetscInt count);
+// Задачи -bench_problems (laplace, poisson2d, random, ...) и медиана повторов; используются и в tests/perf_regression.c
+PetscErrorCode benchmark_create_problem(const char *problem, PetscInt size, PetscBool weak_scaling, Mat *A, PetscInt *global_size, PetscLogDouble *assembly_time);
+PetscErrorCode benchmark_median(const PetscLogDouble values[], PetscInt n, PetscLogDouble *median);
+
+#endif
@@ -0,0 +1,332 @@
+#include "solver.h"
+#include <petsctime.h>
+
+// Псевдоблочный GMRES(m) с правым предобуславливанием: все столбцы B
+// итерируются синхронно. Умножение на A выполняется как SpMM над блоком
+// (матрица читается из памяти один раз на итерацию для всех правых частей),
+// скалярные произведения всех столбцов собираются в одну редукцию.
+
+typedef struct {
+    PetscInt nrhs, m, nloc;
+    Mat *V;                 // базис Крылова: V[k] - плотный блок nloc x nrhs
+    Mat Z, W;               // M^{-1} V[k] и A M^{-1} V[k]
+    PetscScalar *H;         // матрицы Хессенберга: H[(j*m + k)*(m+1) + i]
+    PetscReal *cs, *sn;     // вращения Гивенса: [j*m + k]
+    PetscScalar *g;         // правые части МНК: [j*(m+1) + i]
+    PetscScalar *dots;      // буфер редукций: (m+1) * nrhs
+    PetscInt *steps;        // число шагов Арнольди столбца в текущем цикле
+    PetscInt *its;          // итерации по столбцам
+    PetscReal *target;      // абсолютный порог сходимости столбца
+    PetscBool *active;
+} BlockGMRES;
+
+// Классический Грам-Шмидт с повторной ортогонализацией (CGS2) для всех
+// столбцов сразу: две редукции скалярных произведений и одна для норм
+static PetscErrorCode block_orthogonalize(BlockGMRES *bg, PetscInt k, MPI_Comm comm) {
+    PetscErrorCode ierr;
+    PetscInt pass, i, j, r, lda_w, lda_v;
+    PetscScalar *w;
+    const PetscScalar *v;
+    const PetscInt m = bg->m, s = bg->nrhs, nloc = bg->nloc;
+    
+    ierr = MatDenseGetLDA(bg->W, &lda_w); CHKERRQ(ierr);
+    for (pass = 0; pass < 2; pass++) {
+        ierr = MatDenseGetArray(bg->W, &w); CHKERRQ(ierr);
+        for (i = 0; i <= k; i++) {
+            ierr = MatDenseGetArrayRead(bg->V[i], &v); CHKERRQ(ierr);
+            ierr = MatDenseGetLDA(bg->V[i], &lda_v); CHKERRQ(ierr);
+            for (j = 0; j < s; j++) {
+                PetscScalar d = 0.0;
+                const PetscScalar *vj = v + j * lda_v, *wj = w + j * lda_w;
+                for (r = 0; r < nloc; r++) d += wj[r] * vj[r];
+                bg->dots[i * s + j] = d;
+            }
+            ierr = MatDenseRestoreArrayRead(bg->V[i], &v); CHKERRQ(ierr);
+        }
+        ierr = MPIU_Allreduce(MPI_IN_PLACE, bg->dots, (PetscMPIInt)((k + 1) * s), MPIU_SCALAR, MPIU_SUM, comm); CHKERRMPI(ierr);
+        for (i = 0; i <= k; i++) {
+            ierr = MatDenseGetArrayRead(bg->V[i], &v); CHKERRQ(ierr);
+            ierr = MatDenseGetLDA(bg->V[i], &lda_v); CHKERRQ(ierr);
+            for (j = 0; j < s; j++) {
+                const PetscScalar d = bg->dots[i * s + j];
+                const PetscScalar *vj = v + j * lda_v;
+                PetscScalar *wj = w + j * lda_w;
+                for (r = 0; r < nloc; r++) wj[r] -= d * vj[r];
+                bg->H[(j * m + k) * (m + 1) + i] += d;
+            }
+            ierr = MatDenseRestoreArrayRead(bg->V[i], &v); CHKERRQ(ierr);
+        }
+        ierr = MatDenseRestoreArray(bg->W, &w); CHKERRQ(ierr);
+    }
+    return 0;
+}
+
+// V[k+1] = W / h_{k+1,k}; у сошедшихся столбцов и при вырождении - нулевой столбец
+static PetscErrorCode block_normalize(BlockGMRES *bg, PetscInt k, MPI_Comm comm) {
+    PetscErrorCode ierr;
+    PetscInt j, r, lda_w, lda_v;
+    const PetscScalar *w;
+    PetscScalar *v;
+    const PetscInt m = bg->m, s = bg->nrhs, nloc = bg->nloc;
+    
+    ierr = MatDenseGetArrayRead(bg->W, &w); CHKERRQ(ierr);
+    ierr = MatDenseGetLDA(bg->W, &lda_w); CHKERRQ(ierr);
+    for (j = 0; j < s; j++) {
+        PetscScalar d = 0.0;
+        const PetscScalar *wj = w + j * lda_w;
+        for (r = 0; r < nloc; r++) d += wj[r] * wj[r];
+        bg->dots[j] = d;
+    }
+    ierr = MPIU_Allreduce(MPI_IN_PLACE, bg->dots, (PetscMPIInt)s, MPIU_SCALAR, MPIU_SUM, comm); CHKERRMPI(ierr);
+    
+    ierr = MatDenseGetArray(bg->V[k + 1], &v); CHKERRQ(ierr);
+    ierr = MatDenseGetLDA(bg->V[k + 1], &lda_v); CHKERRQ(ierr);
+    for (j = 0; j < s; j++) {
+        PetscReal h = PetscSqrtReal(PetscRealPart(bg->dots[j]));
+        const PetscScalar *wj = w + j * lda_w;
+        PetscScalar *vj = v + j * lda_v;
+        PetscScalar scale = (bg->active[j] && h > PETSC_MACHINE_EPSILON) ? 1.0 / h : 0.0;
+        bg->H[(j * m + k) * (m + 1) + k + 1] = h;
+        for (r = 0; r < nloc; r++) vj[r] = scale * wj[r];
+    }
+    ierr = MatDenseRestoreArray(bg->V[k + 1], &v); CHKERRQ(ierr);
+    ierr = MatDenseRestoreArrayRead(bg->W, &w); CHKERRQ(ierr);
+    return 0;
+}
+
+// Вращения Гивенса для столбца k матрицы Хессенберга правой части j;
+// возвращает оценку нормы невязки
+static PetscReal block_givens(BlockGMRES *bg, PetscInt j, PetscInt k) {
+    const PetscInt m = bg->m;
+    PetscScalar *h = bg->H + (j * m + k) * (m + 1);
+    PetscReal *cs = bg->cs + j * m, *sn = bg->sn + j * m;
+    PetscScalar *g = bg->g + j * (m + 1);
+    PetscInt i;
+    PetscReal denom;
+    
+    for (i = 0; i < k; i++) {
+        PetscScalar t = cs[i] * h[i] + sn[i] * h[i + 1];
+        h[i + 1] = -sn[i] * h[i] + cs[i] * h[i + 1];
+        h[i] = t;
+    }
+    denom = PetscSqrtReal(PetscRealPart(h[k] * h[k] + h[k + 1] * h[k + 1]));
+    if (denom == 0.0) {
+        cs[k] = 1.0;
+        sn[k] = 0.0;
+    } else {
+        cs[k] = PetscRealPart(h[k]) / denom;
+        sn[k] = PetscRealPart(h[k + 1]) / denom;
+    }
+    h[k] = cs[k] * h[k] + sn[k] * h[k + 1];
+    h[k + 1] = 0.0;
+    g[k + 1] = -sn[k] * g[k];
+    g[k] = cs[k] * g[k];
+    return PetscAbsScalar(g[k + 1]);
+}
+
+// X += M^{-1} V y для каждого столбца (y - решение треугольной системы)
+static PetscErrorCode block_update_solution(BlockGMRES *bg, PC pc, Mat X) {
+    PetscErrorCode ierr;
+    PetscInt i, j, r, lda_w, lda_v;
+    const PetscInt m = bg->m, s = bg->nrhs, nloc = bg->nloc;
+    PetscScalar *w, *y;
+    const PetscScalar *v;
+    
+    ierr = PetscMalloc1(m * s, &y); CHKERRQ(ierr);
+    for (j = 0; j < s; j++) {
+        const PetscScalar *Hj = bg->H + j * m * (m + 1);
+        PetscScalar *yj = y + j * m;
+        for (i = bg->steps[j] - 1; i >= 0; i--) {
+            PetscInt c;
+            PetscScalar sum = bg->g[j * (m + 1) + i];
+            for (c = i + 1; c < bg->steps[j]; c++) sum -= Hj[c * (m + 1) + i] * yj[c];
+            yj[i] = (Hj[i * (m + 1) + i] != 0.0) ? sum / Hj[i * (m + 1) + i] : 0.0;
+        }
+    }
+    
+    ierr = MatZeroEntries(bg->W); CHKERRQ(ierr);
+    ierr = MatDenseGetArray(bg->W, &w); CHKERRQ(ierr);
+    ierr = MatDenseGetLDA(bg->W, &lda_w); CHKERRQ(ierr);
+    for (i = 0; i < m; i++) {
+        ierr = MatDenseGetArrayRead(bg->V[i], &v); CHKERRQ(ierr);
+        ierr = MatDenseGetLDA(bg->V[i], &lda_v); CHKERRQ(ierr);
+        for (j = 0; j < s; j++) {
+            if (i >= bg->steps[j]) continue;
+            const PetscScalar c = y[j * m + i];
+            const PetscScalar *vj = v + j * lda_v;
+            PetscScalar *wj = w + j * lda_w;
+            for (r = 0; r < nloc; r++) wj[r] += c * vj[r];
+        }
+        ierr = MatDenseRestoreArrayRead(bg->V[i], &v); CHKERRQ(ierr);
+    }
+    ierr = MatDenseRestoreArray(bg->W, &w); CHKERRQ(ierr);
+    ierr = PetscFree(y); CHKERRQ(ierr);
+    
+    ierr = PCMatApply(pc, bg->W, bg->Z); CHKERRQ(ierr);
+    ierr = MatAXPY(X, 1.0, bg->Z, SAME_NONZERO_PATTERN); CHKERRQ(ierr);
+    return 0;
+}
+
+// R = B - A X; по столбцам: V[0] = R / ||R||, g = ||R|| e1
+static PetscErrorCode block_restart(BlockGMRES *bg, Mat A, Mat B, Mat X, PetscReal rnorms[]) {
+    PetscErrorCode ierr;
+    PetscInt j, r, lda;
+    PetscScalar *v;
+    const PetscInt m = bg->m, s = bg->nrhs;
+    
+    ierr = MatMatMult(A, X, MAT_REUSE_MATRIX, PETSC_DEFAULT, &bg->W); CHKERRQ(ierr);
+    ierr = MatAYPX(bg->W, -1.0, B, SAME_NONZERO_PATTERN); CHKERRQ(ierr);
+    ierr = MatGetColumnNorms(bg->W, NORM_2, rnorms); CHKERRQ(ierr);
+    ierr = MatCopy(bg->W, bg->V[0], SAME_NONZERO_PATTERN); CHKERRQ(ierr);
+    
+    ierr = MatDenseGetArray(bg->V[0], &v); CHKERRQ(ierr);
+    ierr = MatDenseGetLDA(bg->V[0], &lda); CHKERRQ(ierr);
+    for (j = 0; j < s; j++) {
+        PetscScalar scale = (bg->active[j] && rnorms[j] > 0.0) ? 1.0 / rnorms[j] : 0.0;
+        for (r = 0; r < bg->nloc; r++) v[j * lda + r] *= scale;
+        ierr = PetscArrayzero(bg->g + j * (m + 1), m + 1); CHKERRQ(ierr);
+        bg->g[j * (m + 1)] = rnorms[j];
+        bg->steps[j] = 0;
+    }
+    ierr = MatDenseRestoreArray(bg->V[0], &v); CHKERRQ(ierr);
+    ierr = PetscArrayzero(bg->H, s * m * (m + 1)); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode solver_solve_multi(LinearSolver *solver, Mat B, Mat X, SolverResult results[]) {
+    PetscErrorCode ierr;
+    BlockGMRES bg;
+    MPI_Comm comm;
+    PetscReal rtol, atol, dtol, *rnorms, *bnorms;
+    PetscInt maxits, total_its = 0, k, j, N, nloc_max;
+    PetscBool is_gmres, any_active;
+    PetscLogDouble start_time, end_time, red_start, red_end, block_bytes;
+    
+    ierr = PetscObjectGetComm((PetscObject)solver->A, &comm); CHKERRQ(ierr);
+    if (solver->A_natural) SETERRQ(comm, PETSC_ERR_SUP, "Block solve does not support reordered operators");
+    ierr = KSPGetTolerances(solver->ksp, &rtol, &atol, &dtol, &maxits); CHKERRQ(ierr);
+    ierr = MatGetSize(B, &N, &bg.nrhs); CHKERRQ(ierr);
+    ierr = MatGetLocalSize(B, &bg.nloc, NULL); CHKERRQ(ierr);
+    
+    // Рестарт: заданный решателю, иначе рестарт KSPGMRES; для остальных типов KSP
+    // блочный GMRES берёт SOLVER_RESTART_INITIAL
+    bg.m = SOLVER_RESTART_INITIAL;
+    ierr = PetscObjectTypeCompare((PetscObject)solver->ksp, KSPGMRES, &is_gmres); CHKERRQ(ierr);
+    if (solver->restart > 0) {
+        bg.m = solver->restart;
+    } else if (is_gmres) {
+        ierr = KSPGMRESGetRestart(solver->ksp, &bg.m); CHKERRQ(ierr);
+    }
+    // Блок из m + 1 векторов базиса и Z, W: при бюджете памяти рестарт укорачивается
+    ierr = MPI_Allreduce(&bg.nloc, &nloc_max, 1, MPIU_INT, MPI_MAX, comm); CHKERRMPI(ierr);
+    block_bytes = (PetscLogDouble)nloc_max * bg.nrhs * sizeof(PetscScalar);
+    if (solver->memory_budget > 0.0) {
+        bg.m = PetscMin(bg.m, (PetscInt)(solver->memory_budget / block_bytes) - 3);
+        if (bg.m < SOLVER_RESTART_MIN) SETERRQ(comm, PETSC_ERR_ARG_OUTOFRANGE, "Memory budget is too small for the block Krylov basis");
+    }
+    
+    ierr = solver_get_reduction_count(&red_start); CHKERRQ(ierr);
+    ierr = PetscTime(&start_time); CHKERRQ(ierr);
+    
+    // Предобуславливатель решателя строится один раз и применяется ко всему блоку
+    ierr = KSPSetUp(solver->ksp); CHKERRQ(ierr);
+    ierr = MatZeroEntries(X); CHKERRQ(ierr);
+    
+    ierr = PetscMalloc1(bg.m + 1, &bg.V); CHKERRQ(ierr);
+    for (k = 0; k <= bg.m; k++) {
+        ierr = MatDuplicate(B, MAT_DO_NOT_COPY_VALUES, &bg.V[k]); CHKERRQ(ierr);
+    }
+    ierr = MatDuplicate(B, MAT_DO_NOT_COPY_VALUES, &bg.Z); CHKERRQ(ierr);
+    ierr = MatMatMult(solver->A, bg.Z, MAT_INITIAL_MATRIX, PETSC_DEFAULT, &bg.W); CHKERRQ(ierr);
+    ierr = PetscCalloc3(bg.nrhs * bg.m * (bg.m + 1), &bg.H, bg.nrhs * bg.m, &bg.cs, bg.nrhs * bg.m, &bg.sn); CHKERRQ(ierr);
+    ierr = PetscMalloc3(bg.nrhs * (bg.m + 1), &bg.g, (bg.m + 1) * bg.nrhs, &bg.dots, bg.nrhs, &bg.steps); CHKERRQ(ierr);
+    ierr = PetscMalloc3(bg.nrhs, &bg.its, bg.nrhs, &bg.target, bg.nrhs, &bg.active); CHKERRQ(ierr);
+    ierr = PetscMalloc2(bg.nrhs, &rnorms, bg.nrhs, &bnorms); CHKERRQ(ierr);
+    
+    ierr = MatGetColumnNorms(B, NORM_2, bnorms); CHKERRQ(ierr);
+    for (j = 0; j < bg.nrhs; j++) {
+        bg.its[j] = 0;
+        bg.target[j] = PetscMax(rtol * bnorms[j], atol);
+        bg.active[j] = PETSC_TRUE;
+    }
+    
+    any_active = PETSC_TRUE;
+    while (any_active && total_its < maxits) {
+        ierr = block_restart(&bg, solver->A, B, X, rnorms); CHKERRQ(ierr);
+        any_active = PETSC_FALSE;
+        for (j = 0; j < bg.nrhs; j++) {
+            if (bg.active[j] && rnorms[j] <= bg.target[j]) bg.active[j] = PETSC_FALSE;
+            if (bg.active[j]) any_active = PETSC_TRUE;
+        }
+        if (!any_active) break;
+    
+        for (k = 0; k < bg.m && total_its < maxits; k++) {
+            // Один PCApply и одно SpMM на весь блок
+            ierr = PCMatApply(solver->pc, bg.V[k], bg.Z); CHKERRQ(ierr);
+            ierr = MatMatMult(solver->A, bg.Z, MAT_REUSE_MATRIX, PETSC_DEFAULT, &bg.W); CHKERRQ(ierr);
+            ierr = block_orthogonalize(&bg, k, comm); CHKERRQ(ierr);
+            ierr = block_normalize(&bg, k, comm); CHKERRQ(ierr);
+            total_its++;
+    
+            any_active = PETSC_FALSE;
+            for (j = 0; j < bg.nrhs; j++) {
+                if (!bg.active[j]) continue;
+                rnorms[j] = block_givens(&bg, j, k);
+                bg.steps[j] = k + 1;
+                bg.its[j]++;
+                if (rnorms[j] <= bg.target[j]) bg.active[j] = PETSC_FALSE;
+                else any_active = PETSC_TRUE;
+            }
+            if (!any_active) break;
+        }
+        ierr = block_update_solution(&bg, solver->pc, X); CHKERRQ(ierr);
+    }
+    
+    ierr = PetscTime(&end_time); CHKERRQ(ierr);
+    ierr = solver_get_reduction_count(&red_end); CHKERRQ(ierr);
+    
+    // Истинные невязки по столбцам (одно SpMM)
+    ierr = MatMatMult(solver->A, X, MAT_REUSE_MATRIX, PETSC_DEFAULT, &bg.W); CHKERRQ(ierr);
+    ierr = MatAYPX(bg.W, -1.0, B, SAME_NONZERO_PATTERN); CHKERRQ(ierr);
+    ierr = MatGetColumnNorms(bg.W, NORM_2, rnorms); CHKERRQ(ierr);
+    
+    for (j = 0; j < bg.nrhs; j++) {
+        results[j].matrix_size = N;
+        results[j].nonzeros = 0;
+        results[j].iterations = bg.its[j];
+        results[j].residual = rnorms[j];
+        results[j].assembly_time = 0.0;
+        results[j].setup_time = 0.0;
+        results[j].solve_time = end_time - start_time;   // время всего блока
+        results[j].reductions = red_end - red_start;     // редукции общие для блока
+        results[j].reorder_time = 0.0;
+        results[j].reorder_its_natural = 0;
+        results[j].reorder_its_reordered = 0;
+        ierr = PetscStrncpy(results[j].spmv_format, solver->spmv_format, sizeof(results[j].spmv_format)); CHKERRQ(ierr);
+        results[j].spmv_gbs = solver->spmv_gbs;
+        results[j].krylov_memory = (bg.m + 3) * block_bytes;   // базис общий для блока
+        results[j].checkpoint_time = 0.0;
+        results[j].resumed_iteration = 0;
+        results[j].outer_iterations = 0;
+        results[j].converged = (PetscBool)!bg.active[j];
+        results[j].pc_rebuilt = PETSC_FALSE;
+    }
+    solver->iterations = total_its;
+    solver->residual = 0.0;
+    for (j = 0; j < bg.nrhs; j++) solver->residual = PetscMax(solver->residual, rnorms[j]);
+    solver->solve_time = end_time - start_time;
+    solver->reductions = red_end - red_start;
+    
+    for (k = 0; k <= bg.m; k++) {
+        ierr = MatDestroy(&bg.V[k]); CHKERRQ(ierr);
+    }
+    ierr = PetscFree(bg.V); CHKERRQ(ierr);
+    ierr = MatDestroy(&bg.Z); CHKERRQ(ierr);
+    ierr = MatDestroy(&bg.W); CHKERRQ(ierr);
+    ierr = PetscFree3(bg.H, bg.cs, bg.sn); CHKERRQ(ierr);
+    ierr = PetscFree3(bg.g, bg.dots, bg.steps); CHKERRQ(ierr);
+    ierr = PetscFree3(bg.its, bg.target, bg.active); CHKERRQ(ierr);
+    ierr = PetscFree2(rnorms, bnorms); CHKERRQ(ierr);
+    
+    return 0;
+}
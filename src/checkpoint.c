@@ -0,0 +1,342 @@
+#define _POSIX_C_SOURCE 200809L
+#include "checkpoint.h"
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// Заголовок файла снимка; за ним - nlocal значений PetscScalar
+typedef struct {
+    char magic[8];
+    int64_t n, nlocal, rstart, iteration;
+    double rnorm;
+    int32_t scalar_size;
+} CheckpointHeader;
+
+static const char checkpoint_magic[8] = "GMRESCK";
+
+// Монотонные часы фонового потока (MPI_Wtime из него не вызывается)
+static PetscLogDouble checkpoint_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (PetscLogDouble)ts.tv_sec + 1e-9 * (PetscLogDouble)ts.tv_nsec;
+}
+
+static void checkpoint_filename(const SolverCheckpoint *checkpoint, PetscInt slot, char *path, size_t len) {
+    snprintf(path, len, "%s_%d.%d.bin", checkpoint->prefix, (int)checkpoint->rank, (int)slot);
+}
+
+// Запись во временный файл и rename: прерванная запись не портит прошлый снимок слота.
+// Возвращает errno, 0 - успех
+static int checkpoint_write_file(SolverCheckpoint *checkpoint, const CheckpointHeader *header, PetscInt slot) {
+    char path[PETSC_MAX_PATH_LEN + 32], tmp[PETSC_MAX_PATH_LEN + 40];
+    FILE *fd;
+    int err = 0;
+    
+    checkpoint_filename(checkpoint, slot, path, sizeof(path));
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    fd = fopen(tmp, "wb");
+    if (!fd) return errno ? errno : EIO;
+    if (fwrite(header, sizeof(*header), 1, fd) != 1 ||
+        fwrite(checkpoint->buffer, sizeof(PetscScalar), (size_t)checkpoint->nlocal, fd) != (size_t)checkpoint->nlocal) {
+        err = errno ? errno : EIO;
+    }
+    if (fflush(fd) && !err) err = errno ? errno : EIO;
+    if (!err && fsync(fileno(fd))) err = errno;
+    if (fclose(fd) && !err) err = errno ? errno : EIO;
+    if (!err && rename(tmp, path)) err = errno;
+    return err;
+}
+
+// Фоновый поток: пишет снимок из буфера, PETSc не вызывает
+static void *checkpoint_writer(void *arg) {
+    SolverCheckpoint *checkpoint = (SolverCheckpoint *)arg;
+    
+    pthread_mutex_lock(&checkpoint->lock);
+    for (;;) {
+        CheckpointHeader header;
+        PetscInt slot;
+        PetscLogDouble start;
+        int err;
+    
+        while (!checkpoint->shutdown && !checkpoint->pending) pthread_cond_wait(&checkpoint->cond, &checkpoint->lock);
+        if (!checkpoint->pending) break;
+        checkpoint->pending = PETSC_FALSE;
+    
+        memset(&header, 0, sizeof(header));
+        memcpy(header.magic, checkpoint_magic, sizeof(header.magic));
+        header.n = checkpoint->n;
+        header.nlocal = checkpoint->nlocal;
+        header.rstart = checkpoint->rstart;
+        header.iteration = checkpoint->buffer_iteration;
+        header.rnorm = (double)checkpoint->buffer_rnorm;
+        header.scalar_size = (int32_t)sizeof(PetscScalar);
+        slot = checkpoint->buffer_slot;
+        pthread_mutex_unlock(&checkpoint->lock);
+    
+        // Буфер не меняется, пока busy: монитор пишет в него только при свободном потоке
+        start = checkpoint_now();
+        err = checkpoint_write_file(checkpoint, &header, slot);
+    
+        pthread_mutex_lock(&checkpoint->lock);
+        checkpoint->stats.write_time += checkpoint_now() - start;
+        if (err) {
+            checkpoint->write_error = err;
+        } else {
+            checkpoint->stats.written++;
+            checkpoint->stats.bytes += sizeof(header) + (PetscLogDouble)checkpoint->nlocal * sizeof(PetscScalar);
+        }
+        checkpoint->busy = PETSC_FALSE;
+        pthread_cond_broadcast(&checkpoint->cond);
+    }
+    pthread_mutex_unlock(&checkpoint->lock);
+    return NULL;
+}
+
+static PetscErrorCode checkpoint_monitor(KSP ksp, PetscInt it, PetscReal rnorm, void *ctx) {
+    PetscErrorCode ierr;
+    SolverCheckpoint *checkpoint = (SolverCheckpoint *)ctx;
+    PetscLogDouble start, end;
+    const PetscScalar *x;
+    int busy;
+    
+    // Нулевая итерация - начало KSPSolve (циклы бюджета памяти, переход с конвейерного
+    // варианта): номера снимков продолжают общий счёт
+    if (it == 0) {
+        checkpoint->base = checkpoint->iteration;
+        checkpoint->last_it = 0;
+        return 0;
+    }
+    if (it == checkpoint->last_it) return 0;
+    checkpoint->stats.iterations += it - checkpoint->last_it;
+    checkpoint->last_it = it;
+    checkpoint->iteration = checkpoint->base + it;
+    if (checkpoint->iteration % checkpoint->interval) return 0;
+    
+    ierr = PetscTime(&start); CHKERRQ(ierr);
+    pthread_mutex_lock(&checkpoint->lock);
+    busy = checkpoint->busy;
+    pthread_mutex_unlock(&checkpoint->lock);
+    // Решение о снимке общее, иначе слоты процессов разойдутся
+    ierr = MPI_Allreduce(MPI_IN_PLACE, &busy, 1, MPI_INT, MPI_LOR, PetscObjectComm((PetscObject)ksp)); CHKERRMPI(ierr);
+    if (busy) {
+        checkpoint->stats.skipped++;
+    } else {
+        ierr = KSPBuildSolution(ksp, checkpoint->work, NULL); CHKERRQ(ierr);
+        ierr = VecGetArrayRead(checkpoint->work, &x); CHKERRQ(ierr);
+        ierr = PetscArraycpy(checkpoint->buffer, x, checkpoint->nlocal); CHKERRQ(ierr);
+        ierr = VecRestoreArrayRead(checkpoint->work, &x); CHKERRQ(ierr);
+    
+        pthread_mutex_lock(&checkpoint->lock);
+        checkpoint->buffer_iteration = checkpoint->iteration;
+        checkpoint->buffer_rnorm = rnorm;
+        checkpoint->buffer_slot = checkpoint->snapshots % 2;
+        checkpoint->snapshots++;
+        checkpoint->pending = PETSC_TRUE;
+        checkpoint->busy = PETSC_TRUE;
+        pthread_cond_broadcast(&checkpoint->cond);
+        pthread_mutex_unlock(&checkpoint->lock);
+    }
+    ierr = PetscTime(&end); CHKERRQ(ierr);
+    checkpoint->stats.overhead += end - start;
+    return 0;
+}
+
+PetscErrorCode checkpoint_create(KSP ksp, Vec x, const char *prefix, PetscInt interval, SolverCheckpoint **checkpoint) {
+    PetscErrorCode ierr;
+    SolverCheckpoint *cp;
+    
+    if (interval < 1) SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Checkpoint interval must be positive");
+    if (*checkpoint) {
+        // Монитор уже стоит на ksp: меняются имя и период, после записи текущего снимка
+        cp = *checkpoint;
+        pthread_mutex_lock(&cp->lock);
+        while (cp->busy) pthread_cond_wait(&cp->cond, &cp->lock);
+        pthread_mutex_unlock(&cp->lock);
+        ierr = PetscStrncpy(cp->prefix, prefix, sizeof(cp->prefix)); CHKERRQ(ierr);
+        cp->interval = interval;
+        return 0;
+    }
+    ierr = PetscNew(&cp); CHKERRQ(ierr);
+    ierr = PetscStrncpy(cp->prefix, prefix, sizeof(cp->prefix)); CHKERRQ(ierr);
+    cp->interval = interval;
+    ierr = MPI_Comm_rank(PetscObjectComm((PetscObject)x), &cp->rank); CHKERRMPI(ierr);
+    ierr = VecGetSize(x, &cp->n); CHKERRQ(ierr);
+    ierr = VecGetLocalSize(x, &cp->nlocal); CHKERRQ(ierr);
+    ierr = VecGetOwnershipRange(x, &cp->rstart, NULL); CHKERRQ(ierr);
+    ierr = VecDuplicate(x, &cp->work); CHKERRQ(ierr);
+    ierr = PetscMalloc1(cp->nlocal, &cp->buffer); CHKERRQ(ierr);
+    
+    if (pthread_mutex_init(&cp->lock, NULL) || pthread_cond_init(&cp->cond, NULL)) {
+        SETERRQ(PETSC_COMM_SELF, PETSC_ERR_SYS, "Cannot initialize checkpoint synchronization");
+    }
+    if (pthread_create(&cp->writer, NULL, checkpoint_writer, cp)) {
+        SETERRQ(PETSC_COMM_SELF, PETSC_ERR_SYS, "Cannot start checkpoint writer thread");
+    }
+    ierr = KSPMonitorSet(ksp, checkpoint_monitor, cp, NULL); CHKERRQ(ierr);
+    *checkpoint = cp;
+    return 0;
+}
+
+// Номер итерации снимка слота; -1 - нет файла или он от другого разбиения
+static PetscErrorCode checkpoint_read_header(SolverCheckpoint *checkpoint, PetscInt slot, PetscInt *iteration) {
+    char path[PETSC_MAX_PATH_LEN + 32];
+    CheckpointHeader header;
+    FILE *fd;
+    
+    *iteration = -1;
+    checkpoint_filename(checkpoint, slot, path, sizeof(path));
+    fd = fopen(path, "rb");
+    if (!fd) return 0;
+    if (fread(&header, sizeof(header), 1, fd) == 1 && !memcmp(header.magic, checkpoint_magic, sizeof(header.magic)) &&
+        header.n == checkpoint->n && header.nlocal == checkpoint->nlocal && header.rstart == checkpoint->rstart &&
+        header.scalar_size == (int32_t)sizeof(PetscScalar)) {
+        *iteration = (PetscInt)header.iteration;
+    }
+    fclose(fd);
+    return 0;
+}
+
+PetscErrorCode checkpoint_load(SolverCheckpoint *checkpoint, Vec x, PetscInt *iteration, PetscBool *found) {
+    PetscErrorCode ierr;
+    MPI_Comm comm = PetscObjectComm((PetscObject)x);
+    PetscInt its[2], candidate[2], slot, s, c;
+    int have = 0;
+    
+    // Незаконченная запись не должна мешать фоновому потоку читать и писать те же файлы
+    pthread_mutex_lock(&checkpoint->lock);
+    while (checkpoint->busy) pthread_cond_wait(&checkpoint->cond, &checkpoint->lock);
+    pthread_mutex_unlock(&checkpoint->lock);
+    
+    for (s = 0; s < 2; s++) { ierr = checkpoint_read_header(checkpoint, s, &its[s]); CHKERRQ(ierr); }
+    
+    // Снимки пишутся всеми процессами в лад, но последний мог не дописаться на части
+    // процессов: сначала новейший у всех, затем старейший
+    candidate[0] = PetscMax(its[0], its[1]);
+    candidate[1] = (its[0] >= 0 && its[1] >= 0) ? PetscMin(its[0], its[1]) : candidate[0];
+    ierr = MPI_Allreduce(MPI_IN_PLACE, candidate, 2, MPIU_INT, MPI_MIN, comm); CHKERRMPI(ierr);
+    *found = PETSC_FALSE;
+    for (c = 0; c < 2 && !*found; c++) {
+        if (candidate[c] < 0) continue;
+        have = (its[0] == candidate[c] || its[1] == candidate[c]);
+        ierr = MPI_Allreduce(MPI_IN_PLACE, &have, 1, MPI_INT, MPI_LAND, comm); CHKERRMPI(ierr);
+        if (have) {
+            *found = PETSC_TRUE;
+            *iteration = candidate[c];
+        }
+    }
+    if (!*found) return 0;
+    
+    slot = (its[0] == *iteration) ? 0 : 1;
+    {
+        char path[PETSC_MAX_PATH_LEN + 32];
+        CheckpointHeader header;
+        PetscScalar *array;
+        FILE *fd;
+        int ok;
+    
+        checkpoint_filename(checkpoint, slot, path, sizeof(path));
+        fd = fopen(path, "rb");
+        if (!fd) SETERRQ(PETSC_COMM_SELF, PETSC_ERR_FILE_OPEN, "Cannot open checkpoint %s", path);
+        ierr = VecGetArray(x, &array); CHKERRQ(ierr);
+        ok = (fread(&header, sizeof(header), 1, fd) == 1 &&
+              fread(array, sizeof(PetscScalar), (size_t)checkpoint->nlocal, fd) == (size_t)checkpoint->nlocal);
+        ierr = VecRestoreArray(x, &array); CHKERRQ(ierr);
+        fclose(fd);
+        if (!ok) SETERRQ(PETSC_COMM_SELF, PETSC_ERR_FILE_READ, "Truncated checkpoint %s", path);
+    }
+    // Следующий снимок - в другой слот, чтобы не затереть тот, с которого продолжено
+    checkpoint->snapshots = slot + 1;
+    return 0;
+}
+
+PetscErrorCode checkpoint_begin(SolverCheckpoint *checkpoint, KSP ksp, Vec x, PetscBool *guess_nonzero) {
+    PetscErrorCode ierr;
+    PetscInt nlocal, iteration;
+    PetscBool found;
+    
+    ierr = VecGetLocalSize(x, &nlocal); CHKERRQ(ierr);
+    if (nlocal != checkpoint->nlocal) SETERRQ(PETSC_COMM_SELF, PETSC_ERR_ARG_SIZ, "Solution layout differs from the checkpoint layout");
+    ierr = KSPGetInitialGuessNonzero(ksp, guess_nonzero); CHKERRQ(ierr);
+    checkpoint->iteration = 0;
+    checkpoint->stats.resumed_iteration = 0;
+    if (!checkpoint->resume) return 0;
+    
+    // Продолжение действует на одно решение
+    checkpoint->resume = PETSC_FALSE;
+    ierr = checkpoint_load(checkpoint, x, &iteration, &found); CHKERRQ(ierr);
+    if (found) {
+        PetscPrintf(PetscObjectComm((PetscObject)x), "Resuming from checkpoint %s at iteration %" PetscInt_FMT "\n", checkpoint->prefix, iteration);
+        ierr = KSPSetInitialGuessNonzero(ksp, PETSC_TRUE); CHKERRQ(ierr);
+        checkpoint->iteration = iteration;
+        checkpoint->stats.resumed_iteration = iteration;
+    } else {
+        PetscPrintf(PetscObjectComm((PetscObject)x), "No checkpoint %s found, starting from the initial guess\n", checkpoint->prefix);
+    }
+    return 0;
+}
+
+PetscErrorCode checkpoint_end(SolverCheckpoint *checkpoint, KSP ksp, PetscBool guess_nonzero) {
+    PetscErrorCode ierr;
+    int err;
+    
+    ierr = KSPSetInitialGuessNonzero(ksp, guess_nonzero); CHKERRQ(ierr);
+    // Ошибка записи не прерывает решение: снимок остаётся прошлым
+    pthread_mutex_lock(&checkpoint->lock);
+    err = checkpoint->write_error;
+    checkpoint->write_error = 0;
+    pthread_mutex_unlock(&checkpoint->lock);
+    if (err) {
+        PetscPrintf(PETSC_COMM_SELF, "Warning: rank %d cannot write checkpoint %s: %s\n", (int)checkpoint->rank, checkpoint->prefix, strerror(err));
+    }
+    return 0;
+}
+
+PetscErrorCode checkpoint_get_stats(SolverCheckpoint *checkpoint, CheckpointStats *stats) {
+    pthread_mutex_lock(&checkpoint->lock);
+    *stats = checkpoint->stats;
+    pthread_mutex_unlock(&checkpoint->lock);
+    return 0;
+}
+
+PetscErrorCode checkpoint_print_stats(SolverCheckpoint *checkpoint) {
+    PetscErrorCode ierr;
+    CheckpointStats stats;
+    MPI_Comm comm = PetscObjectComm((PetscObject)checkpoint->work);
+    PetscLogDouble times[2];
+    
+    ierr = checkpoint_get_stats(checkpoint, &stats); CHKERRQ(ierr);
+    // Время - максимум по процессам
+    times[0] = stats.overhead;
+    times[1] = stats.write_time;
+    ierr = MPI_Allreduce(MPI_IN_PLACE, times, 2, MPI_DOUBLE, MPI_MAX, comm); CHKERRMPI(ierr);
+    PetscPrintf(comm, "Checkpoints: %" PetscInt_FMT " written, %" PetscInt_FMT " skipped (every %" PetscInt_FMT " iterations), %.0f bytes per rank\n",
+                stats.written, stats.skipped, checkpoint->interval, stats.bytes);
+    PetscPrintf(comm, "Checkpoint overhead: %g seconds (%g per iteration), background write %g seconds\n",
+                times[0], stats.iterations ? times[0] / stats.iterations : 0.0, times[1]);
+    if (stats.resumed_iteration) {
+        PetscPrintf(comm, "Resumed from iteration %" PetscInt_FMT "\n", stats.resumed_iteration);
+    }
+    return 0;
+}
+
+PetscErrorCode checkpoint_destroy(SolverCheckpoint **checkpoint) {
+    PetscErrorCode ierr;
+    SolverCheckpoint *cp = *checkpoint;
+    
+    if (!cp) return 0;
+    // Поток дописывает ожидающий снимок и завершается
+    pthread_mutex_lock(&cp->lock);
+    cp->shutdown = PETSC_TRUE;
+    pthread_cond_broadcast(&cp->cond);
+    pthread_mutex_unlock(&cp->lock);
+    pthread_join(cp->writer, NULL);
+    pthread_mutex_destroy(&cp->lock);
+    pthread_cond_destroy(&cp->cond);
+    
+    ierr = VecDestroy(&cp->work); CHKERRQ(ierr);
+    ierr = PetscFree(cp->buffer); CHKERRQ(ierr);
+    ierr = PetscFree(*checkpoint); CHKERRQ(ierr);
+    return 0;
+}
@@ -0,0 +1,65 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <pthread.h>
+#include <petscksp.h>
+
+// Снимки долгого решения. Каждые interval итераций монитор KSP строит текущее
+// приближение, копирует локальную часть в буфер и отдаёт фоновому потоку, который
+// пишет её в свой файл процесса (<prefix>_<rank>.<slot>.bin, два чередующихся слота,
+// запись через временный файл и rename). Поток вызывает только стандартный ввод-вывод,
+// PETSc - лишь вызывающий поток. Если прошлый снимок ещё пишется хотя бы на одном
+// процессе, очередной пропускается на всех - итерации не ждут диска.
+// Продолжение читает последний снимок, записанный всеми процессами, как ненулевое
+// начальное приближение; разбиение вектора должно совпадать.
+
+#define CHECKPOINT_DEFAULT_INTERVAL 50
+
+// Время на пути решения (построение приближения, копия, передача потоку) и фоновое
+typedef struct {
+    PetscInt written;
+    PetscInt skipped;               // пропущено: прошлый снимок ещё пишется
+    PetscInt iterations;            // итераций под наблюдением
+    PetscLogDouble overhead;        // секунд на пути решения
+    PetscLogDouble write_time;      // секунд фоновой записи
+    PetscLogDouble bytes;           // записано на процесс
+    PetscInt resumed_iteration;     // с какой итерации продолжено последнее решение; 0 - с начала
+} CheckpointStats;
+
+typedef struct {
+    char prefix[PETSC_MAX_PATH_LEN];
+    PetscInt interval;
+    PetscBool resume;               // продолжить следующее решение с последнего снимка
+    PetscMPIInt rank;
+    PetscInt n, nlocal, rstart;
+    PetscInt iteration;             // итераций с начала, включая решение до продолжения
+    PetscInt base, last_it;         // iteration в начале текущего KSPSolve и последний номер от монитора
+    PetscInt snapshots;             // номер следующего снимка; слот - snapshots % 2
+    Vec work;                       // текущее приближение (KSPBuildSolution)
+    // Состояние фонового потока, под lock
+    PetscScalar *buffer;
+    PetscInt buffer_iteration, buffer_slot;
+    PetscReal buffer_rnorm;
+    PetscBool pending, busy, shutdown;
+    int write_error;                // errno последней неудачной записи; 0 - без ошибок
+    pthread_t writer;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    CheckpointStats stats;
+} SolverCheckpoint;
+
+// Разбиение берётся из x; монитор добавляется к ksp. Для *checkpoint != NULL меняются
+// только имя и период
+PetscErrorCode checkpoint_create(KSP ksp, Vec x, const char *prefix, PetscInt interval, SolverCheckpoint **checkpoint);
+// Перед KSPSolve: при resume загружает снимок в x и включает ненулевое начальное приближение
+PetscErrorCode checkpoint_begin(SolverCheckpoint *checkpoint, KSP ksp, Vec x, PetscBool *guess_nonzero);
+// После KSPSolve: восстанавливает флаг начального приближения, сообщает об ошибках записи
+PetscErrorCode checkpoint_end(SolverCheckpoint *checkpoint, KSP ksp, PetscBool guess_nonzero);
+// Последний полный снимок; found - одинаков на всех процессах
+PetscErrorCode checkpoint_load(SolverCheckpoint *checkpoint, Vec x, PetscInt *iteration, PetscBool *found);
+PetscErrorCode checkpoint_get_stats(SolverCheckpoint *checkpoint, CheckpointStats *stats);
+PetscErrorCode checkpoint_print_stats(SolverCheckpoint *checkpoint);
+// Дожидается записи последнего снимка
+PetscErrorCode checkpoint_destroy(SolverCheckpoint **checkpoint);
+
+#endif
@@ -0,0 +1,337 @@
+#include "solver.h"
+#include "workspace_pool.h"
+
+// Отпечаток матрицы для кэша конфигураций
+typedef struct {
+    PetscInt n, nnz;
+    uint64_t pattern;
+    PetscReal asymmetry;            // ||A x - A^T x|| / ||A x|| для случайного x
+    PetscReal dominance;            // доля строк с диагональным преобладанием
+    PetscBool positive_diagonal;
+} TuneFingerprint;
+
+// Бюджет пробного решения: стандартная проверка сходимости и предел времени
+typedef struct {
+    void *default_ctx;
+    PetscLogDouble start, limit;    // limit = 0 - без предела времени
+} TuneBudget;
+
+// Кандидаты: ksp_type - имя варианта GMRES или тип KSP (как в SolverConfig)
+static const SolverConfig tune_candidates[] = {
+    {"classical", PCNONE, 30},
+    {"classical", PCJACOBI, 30},
+    {"classical", PCJACOBI, 100},
+    {"classical", PCBJACOBI, 30},
+    {"classical", PCBJACOBI, 100},
+    {"classical", PCSOR, 30},
+    {"classical", PCASM, 30},
+    {"classical", PCGAMG, 30},
+    {"classical", PCMG, 30},
+    {"pipelined", PCJACOBI, 30},
+    {KSPBCGS, PCJACOBI, 0},
+    {KSPBCGS, PCBJACOBI, 0},
+    {KSPCG, PCJACOBI, 0},
+    {KSPCG, PCBJACOBI, 0},
+    {KSPCG, PCGAMG, 0}
+};
+
+static PetscBool tune_symmetric(const TuneFingerprint *fp) {
+    return (PetscBool)(fp->asymmetry < SOLVER_TUNE_SYMMETRY_TOL);
+}
+
+// PCMG - только со структурированной сеткой, CG - для симметричных матриц с положительной диагональю
+static PetscErrorCode tune_candidate_applies(LinearSolver *solver, const TuneFingerprint *fp, const char *ksp_type,
+                                             const char *pc_type, PetscBool *applies) {
+    PetscErrorCode ierr;
+    PetscBool is_mg, is_cg;
+    
+    ierr = PetscStrcmp(pc_type, PCMG, &is_mg); CHKERRQ(ierr);
+    ierr = PetscStrcmp(ksp_type, KSPCG, &is_cg); CHKERRQ(ierr);
+    *applies = PETSC_TRUE;
+    if (is_mg && !solver->dm) *applies = PETSC_FALSE;
+    if (is_cg && !(tune_symmetric(fp) && fp->positive_diagonal)) *applies = PETSC_FALSE;
+    return 0;
+}
+
+static PetscErrorCode tune_fingerprint(Mat A, TuneFingerprint *fp) {
+    PetscErrorCode ierr;
+    PetscInt rstart, rend, row, ncols, k, counts[2] = {0, 0};
+    const PetscInt *cols;
+    const PetscScalar *vals;
+    PetscReal diag, off, ynorm, dnorm;
+    MatInfo info;
+    Vec x, y, z;
+    int positive = 1;
+    
+    ierr = MatGetSize(A, &fp->n, NULL); CHKERRQ(ierr);
+    ierr = MatGetInfo(A, MAT_GLOBAL_SUM, &info); CHKERRQ(ierr);
+    fp->nnz = (PetscInt)info.nz_used;
+    ierr = solver_pattern_fingerprint(A, &fp->pattern); CHKERRQ(ierr);
+    
+    // Диагональное преобладание: |a_ii| >= сумма |a_ij| по остальным столбцам строки
+    ierr = MatGetOwnershipRange(A, &rstart, &rend); CHKERRQ(ierr);
+    for (row = rstart; row < rend; row++) {
+        ierr = MatGetRow(A, row, &ncols, &cols, &vals); CHKERRQ(ierr);
+        diag = 0.0;
+        off = 0.0;
+        for (k = 0; k < ncols; k++) {
+            if (cols[k] == row) diag = PetscRealPart(vals[k]);
+            else off += PetscAbsScalar(vals[k]);
+        }
+        ierr = MatRestoreRow(A, row, &ncols, &cols, &vals); CHKERRQ(ierr);
+        if (PetscAbsReal(diag) >= off) counts[0]++;
+        if (diag <= 0.0) positive = 0;
+    }
+    counts[1] = rend - rstart;
+    ierr = MPI_Allreduce(MPI_IN_PLACE, counts, 2, MPIU_INT, MPI_SUM, PetscObjectComm((PetscObject)A)); CHKERRMPI(ierr);
+    ierr = MPI_Allreduce(MPI_IN_PLACE, &positive, 1, MPI_INT, MPI_LAND, PetscObjectComm((PetscObject)A)); CHKERRMPI(ierr);
+    fp->dominance = counts[1] ? (PetscReal)counts[0] / counts[1] : 0.0;
+    fp->positive_diagonal = (PetscBool)positive;
+    
+    // Несимметричность по одному произведению с A и A^T вместо сравнения элементов между процессами
+    ierr = MatCreateVecs(A, &x, &y); CHKERRQ(ierr);
+    ierr = VecDuplicate(y, &z); CHKERRQ(ierr);
+    ierr = VecSetRandom(x, NULL); CHKERRQ(ierr);
+    ierr = MatMult(A, x, y); CHKERRQ(ierr);
+    ierr = MatMultTranspose(A, x, z); CHKERRQ(ierr);
+    ierr = VecNorm(y, NORM_2, &ynorm); CHKERRQ(ierr);
+    ierr = VecAXPY(z, -1.0, y); CHKERRQ(ierr);
+    ierr = VecNorm(z, NORM_2, &dnorm); CHKERRQ(ierr);
+    fp->asymmetry = ynorm > 0.0 ? dnorm / ynorm : 0.0;
+    ierr = VecDestroy(&x); CHKERRQ(ierr);
+    ierr = VecDestroy(&y); CHKERRQ(ierr);
+    ierr = VecDestroy(&z); CHKERRQ(ierr);
+    return 0;
+}
+
+// Запись из кэша на процессе 0; found - одинаков на всех процессах.
+// Совпадение шаблона выигрывает (последняя запись - самая свежая), иначе похожая
+// матрица: та же симметрия, близкие доля преобладания и ненулевые на строку, размер
+// в пределах SOLVER_TUNE_SIZE_RATIO раз - ближайшая по размеру
+static PetscErrorCode tune_cache_lookup(MPI_Comm comm, const char *filename, const TuneFingerprint *fp, PetscBool similar,
+                                        char ksp_type[], char pc_type[], PetscInt *restart, PetscBool *found) {
+    PetscErrorCode ierr;
+    PetscMPIInt rank;
+    int match = 0;          // 0 - нет, 1 - похожая, 2 - тот же шаблон
+    
+    ierr = MPI_Comm_rank(comm, &rank); CHKERRMPI(ierr);
+    if (rank == 0) {
+        FILE *fd = fopen(filename, "r");
+        char line[512], ksp[SOLVER_TUNE_NAME_LEN], pc[SOLVER_TUNE_NAME_LEN];
+        double best_distance = PETSC_MAX_REAL;
+    
+        while (fd && fgets(line, sizeof(line), fd)) {
+            long long n, nnz;
+            unsigned long long pattern;
+            double asymmetry, dominance, time, distance;
+            long rst, iterations;
+    
+            if (line[0] == '#' || line[0] == '\n') continue;
+            if (sscanf(line, "%lld,%lld,%llx,%lf,%lf,%31[^,],%31[^,],%ld,%lf,%ld", &n, &nnz, &pattern, &asymmetry,
+                       &dominance, ksp, pc, &rst, &time, &iterations) != 10) continue;  // заголовок
+            if (n == fp->n && nnz == fp->nnz && pattern == fp->pattern) {
+                match = 2;
+            } else if (match < 2 && similar && n > 0 && fp->n > 0) {
+                PetscBool symmetric = (PetscBool)(asymmetry < SOLVER_TUNE_SYMMETRY_TOL);
+                double row_nnz = (double)nnz / n, fp_row_nnz = (double)fp->nnz / fp->n;
+    
+                distance = PetscAbsReal(PetscLogReal((PetscReal)n / fp->n));
+                if (symmetric != tune_symmetric(fp) || PetscAbsReal(dominance - fp->dominance) > SOLVER_TUNE_DOMINANCE_TOL ||
+                    PetscAbsReal(row_nnz - fp_row_nnz) > SOLVER_TUNE_ROW_NNZ_TOL * fp_row_nnz ||
+                    distance > PetscLogReal(SOLVER_TUNE_SIZE_RATIO) || distance >= best_distance) continue;
+                best_distance = distance;
+                match = 1;
+            } else {
+                continue;
+            }
+            ierr = PetscStrncpy(ksp_type, ksp, SOLVER_TUNE_NAME_LEN); CHKERRQ(ierr);
+            ierr = PetscStrncpy(pc_type, pc, SOLVER_TUNE_NAME_LEN); CHKERRQ(ierr);
+            *restart = (PetscInt)rst;
+        }
+        if (fd) fclose(fd);
+    }
+    ierr = MPI_Bcast(&match, 1, MPI_INT, 0, comm); CHKERRMPI(ierr);
+    *found = (PetscBool)(match > 0);
+    if (*found) {
+        ierr = MPI_Bcast(ksp_type, SOLVER_TUNE_NAME_LEN, MPI_CHAR, 0, comm); CHKERRMPI(ierr);
+        ierr = MPI_Bcast(pc_type, SOLVER_TUNE_NAME_LEN, MPI_CHAR, 0, comm); CHKERRMPI(ierr);
+        ierr = MPI_Bcast(restart, 1, MPIU_INT, 0, comm); CHKERRMPI(ierr);
+    }
+    return 0;
+}
+
+static PetscErrorCode tune_cache_append(MPI_Comm comm, const char *filename, const TuneFingerprint *fp, const SolverConfig *config,
+                                        PetscLogDouble time, PetscInt iterations) {
+    PetscErrorCode ierr;
+    PetscBool exists;
+    FILE *fd;
+    
+    ierr = PetscTestFile(filename, 'r', &exists); CHKERRQ(ierr);
+    ierr = PetscFOpen(comm, filename, exists ? "a" : "w", &fd); CHKERRQ(ierr);
+    if (!exists) {
+        ierr = PetscFPrintf(comm, fd, "# Кэш подбора конфигурации решателя (-solver_tune); последняя запись для шаблона - действующая\n"); CHKERRQ(ierr);
+        ierr = PetscFPrintf(comm, fd, "n,nnz,pattern,asymmetry,dominance,ksp,pc,restart,time,iterations\n"); CHKERRQ(ierr);
+    }
+    ierr = PetscFPrintf(comm, fd, "%" PetscInt_FMT ",%" PetscInt_FMT ",%016llx,%.3e,%.4f,%s,%s,%" PetscInt_FMT ",%.6e,%" PetscInt_FMT "\n",
+                        fp->n, fp->nnz, (unsigned long long)fp->pattern, (double)fp->asymmetry, (double)fp->dominance,
+                        config->ksp_type, config->pc_type, config->restart, time, iterations); CHKERRQ(ierr);
+    ierr = PetscFClose(comm, fd); CHKERRQ(ierr);
+    return 0;
+}
+
+// Стандартный критерий плюс предел времени; решение об остановке общее для всех процессов,
+// поэтому время сравнивается через редукцию раз в SOLVER_TUNE_CHECK_INTERVAL итераций
+static PetscErrorCode tune_converged(KSP ksp, PetscInt it, PetscReal rnorm, KSPConvergedReason *reason, void *ctx) {
+    PetscErrorCode ierr;
+    TuneBudget *budget = (TuneBudget *)ctx;
+    PetscLogDouble now;
+    int over;
+    
+    ierr = KSPConvergedDefault(ksp, it, rnorm, reason, budget->default_ctx); CHKERRQ(ierr);
+    if (*reason != KSP_CONVERGED_ITERATING || budget->limit <= 0.0 || it == 0 || it % SOLVER_TUNE_CHECK_INTERVAL) return 0;
+    ierr = PetscTime(&now); CHKERRQ(ierr);
+    over = (now - budget->start > budget->limit);
+    ierr = MPI_Allreduce(MPI_IN_PLACE, &over, 1, MPI_INT, MPI_LOR, PetscObjectComm((PetscObject)ksp)); CHKERRMPI(ierr);
+    if (over) *reason = KSP_DIVERGED_ITS;
+    return 0;
+}
+
+static PetscErrorCode tune_budget_destroy(void *ctx) {
+    PetscErrorCode ierr;
+    TuneBudget *budget = (TuneBudget *)ctx;
+    
+    ierr = KSPConvergedDefaultDestroy(budget->default_ctx); CHKERRQ(ierr);
+    ierr = PetscFree(budget); CHKERRQ(ierr);
+    return 0;
+}
+
+// Пробное решение: время от создания решателя до ответа (максимум по процессам)
+static PetscErrorCode tune_trial(LinearSolver *solver, const SolverConfig *config, Vec b, Vec x, PetscInt maxits,
+                                 PetscLogDouble limit, PetscLogDouble *time, PetscInt *iterations, PetscBool *converged) {
+    PetscErrorCode ierr;
+    LinearSolver trial;
+    SolverResult result;
+    TuneBudget *budget;
+    PetscReal rtol, atol, dtol;
+    PetscInt its;
+    PetscLogDouble end;
+    
+    ierr = PetscNew(&budget); CHKERRQ(ierr);
+    budget->limit = limit;
+    ierr = PetscTime(&budget->start); CHKERRQ(ierr);
+    
+    // Пробные решения без отчётов, снимков, перестановки (A уже переставлена), выбора формата и бюджета памяти
+    ierr = solver_create_trial(&trial, solver->A); CHKERRQ(ierr);
+    if (solver->dm) { ierr = solver_set_dm(&trial, solver->dm); CHKERRQ(ierr); }
+    ierr = solver_configure(&trial, config); CHKERRQ(ierr);
+    
+    ierr = KSPGetTolerances(solver->ksp, &rtol, &atol, &dtol, &its); CHKERRQ(ierr);
+    ierr = KSPSetTolerances(trial.ksp, rtol, atol, dtol, PetscMin(its, maxits)); CHKERRQ(ierr);
+    ierr = KSPConvergedDefaultCreate(&budget->default_ctx); CHKERRQ(ierr);
+    ierr = KSPSetConvergenceTest(trial.ksp, tune_converged, budget, tune_budget_destroy); CHKERRQ(ierr);
+    
+    ierr = solver_setup(&trial); CHKERRQ(ierr);
+    ierr = VecSet(x, 0.0); CHKERRQ(ierr);
+    ierr = solver_solve_with_result(&trial, b, x, &result); CHKERRQ(ierr);
+    ierr = PetscTime(&end); CHKERRQ(ierr);
+    ierr = solver_destroy(&trial); CHKERRQ(ierr);
+    
+    *time = end - budget->start;
+    ierr = MPI_Allreduce(MPI_IN_PLACE, time, 1, MPI_DOUBLE, MPI_MAX, PetscObjectComm((PetscObject)solver->A)); CHKERRMPI(ierr);
+    *iterations = result.iterations;
+    *converged = result.converged;
+    return 0;
+}
+
+PetscErrorCode solver_set_config_tuning(LinearSolver *solver, PetscBool enable) {
+    solver->tune_config = enable;
+    return 0;
+}
+
+PetscErrorCode solver_tune_config(LinearSolver *solver) {
+    PetscErrorCode ierr;
+    char filename[PETSC_MAX_PATH_LEN] = "solver_tune_cache.csv";
+    MPI_Comm comm = PetscObjectComm((PetscObject)solver->A);
+    TuneFingerprint fp;
+    SolverConfig config;
+    PetscBool is_aij, applies, found = PETSC_FALSE, force = PETSC_FALSE, similar = PETSC_TRUE;
+    PetscInt c, best = -1, maxits = SOLVER_TUNE_MAXITS, iterations, best_iterations = 0;
+    PetscLogDouble start_time, end_time, time, best_time = 0.0;
+    PetscBool converged;
+    PetscLayout map;
+    Vec *work;
+    
+    // Подбор выполняется один раз (solver_setup или первое решение сессии): новые значения
+    // матрицы сессии сохраняют выбранную конфигурацию
+    if (!solver->tune_config || solver->tuned_ksp[0]) return 0;
+    // Смешанная точность строит свой внутренний KSP, проекция начального приближения - свой KSP
+    if (solver->A_single || solver->guess_type == SOLVER_GUESS_FISCHER) return 0;
+    ierr = PetscObjectBaseTypeCompareAny((PetscObject)solver->A, &is_aij, MATSEQAIJ, MATMPIAIJ, ""); CHKERRQ(ierr);
+    if (!is_aij) return 0;
+    
+    ierr = PetscOptionsGetString(NULL, NULL, "-solver_tune_cache", filename, sizeof(filename), NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetBool(NULL, NULL, "-solver_tune_force", &force, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetBool(NULL, NULL, "-solver_tune_similar", &similar, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetInt(NULL, NULL, "-solver_tune_maxits", &maxits, NULL); CHKERRQ(ierr);
+    
+    ierr = PetscTime(&start_time); CHKERRQ(ierr);
+    ierr = tune_fingerprint(solver->A, &fp); CHKERRQ(ierr);
+    
+    if (!force) {
+        ierr = tune_cache_lookup(comm, filename, &fp, similar, solver->tuned_ksp, solver->tuned_pc, &solver->tuned_restart, &found); CHKERRQ(ierr);
+        // Запись от другой программы может требовать сетки или симметрии, которых здесь нет
+        if (found) {
+            ierr = tune_candidate_applies(solver, &fp, solver->tuned_ksp, solver->tuned_pc, &applies); CHKERRQ(ierr);
+            if (!applies) {
+                found = PETSC_FALSE;
+                solver->tuned_ksp[0] = '\0';
+                solver->tuned_pc[0] = '\0';
+            }
+        }
+    }
+    
+    if (!found) {
+        // Система с известным решением из единиц
+        ierr = MatGetLayouts(solver->A, NULL, &map); CHKERRQ(ierr);
+        ierr = workspace_get_vecs(comm, map, 2, &work); CHKERRQ(ierr);
+        ierr = VecSet(work[1], 1.0); CHKERRQ(ierr);
+        ierr = MatMult(solver->A, work[1], work[0]); CHKERRQ(ierr);
+    
+        for (c = 0; c < (PetscInt)(sizeof(tune_candidates) / sizeof(tune_candidates[0])); c++) {
+            ierr = tune_candidate_applies(solver, &fp, tune_candidates[c].ksp_type, tune_candidates[c].pc_type, &applies); CHKERRQ(ierr);
+            if (!applies) continue;
+            // Кандидат, не уложившийся во время лучшего, проиграл бы в любом случае
+            ierr = tune_trial(solver, &tune_candidates[c], work[0], work[1], maxits, best >= 0 ? best_time : 0.0,
+                              &time, &iterations, &converged); CHKERRQ(ierr);
+            ierr = PetscInfo(solver->ksp, "Tuning %s/%s restart %" PetscInt_FMT ": %g seconds, %" PetscInt_FMT " iterations%s\n",
+                             tune_candidates[c].ksp_type, tune_candidates[c].pc_type, tune_candidates[c].restart,
+                             time, iterations, converged ? "" : ", not converged"); CHKERRQ(ierr);
+            if (converged && (best < 0 || time < best_time)) {
+                best = c;
+                best_time = time;
+                best_iterations = iterations;
+            }
+        }
+        ierr = workspace_return_vecs(2, &work); CHKERRQ(ierr);
+    
+        // Ни один кандидат не сошёлся в пределах бюджета: конфигурация остаётся прежней
+        if (best < 0) {
+            ierr = PetscInfo(solver->ksp, "No tuning candidate converged within %" PetscInt_FMT " iterations\n", maxits); CHKERRQ(ierr);
+            solver->tune_config = PETSC_FALSE;
+            return 0;
+        }
+        ierr = PetscStrncpy(solver->tuned_ksp, tune_candidates[best].ksp_type, sizeof(solver->tuned_ksp)); CHKERRQ(ierr);
+        ierr = PetscStrncpy(solver->tuned_pc, tune_candidates[best].pc_type, sizeof(solver->tuned_pc)); CHKERRQ(ierr);
+        solver->tuned_restart = tune_candidates[best].restart;
+        ierr = tune_cache_append(comm, filename, &fp, &tune_candidates[best], best_time, best_iterations); CHKERRQ(ierr);
+    }
+    ierr = PetscTime(&end_time); CHKERRQ(ierr);
+    solver->tune_cache_hit = found;
+    solver->tune_time = end_time - start_time;
+    
+    config.ksp_type = solver->tuned_ksp;
+    config.pc_type = solver->tuned_pc;
+    config.restart = solver->tuned_restart;
+    ierr = solver_configure(solver, &config); CHKERRQ(ierr);
+    return 0;
+}
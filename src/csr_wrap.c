@@ -0,0 +1,180 @@
+#include "solver.h"
+#include "threading.h"
+
+// Безматричный оператор над CSR-массивами вызывающего: значения читаются прямо из
+// них при каждом SpMV. Своя память - только номера ghost-столбцов внедиагональных
+// элементов (off_ptr/off_idx) и буфер ghost-значений x.
+typedef struct {
+    PetscInt nlocal, cstart, cend;
+    const PetscInt *rowptr, *cols;
+    const PetscScalar *vals;
+    PetscInt *off_ptr;          // начало внедиагональных элементов строки в off_idx
+    PetscInt *off_idx;          // позиция столбца в ghost
+    Vec ghost;
+    VecScatter scatter;
+} CSRWrapContext;
+
+static PetscErrorCode csr_wrap_mult(Mat S, Vec xv, Vec yv) {
+    PetscErrorCode ierr;
+    CSRWrapContext *ctx;
+    const PetscScalar *x, *g;
+    PetscScalar *y;
+    PetscInt i;
+    
+    ierr = MatShellGetContext(S, &ctx); CHKERRQ(ierr);
+    ierr = VecScatterBegin(ctx->scatter, xv, ctx->ghost, INSERT_VALUES, SCATTER_FORWARD); CHKERRQ(ierr);
+    ierr = VecScatterEnd(ctx->scatter, xv, ctx->ghost, INSERT_VALUES, SCATTER_FORWARD); CHKERRQ(ierr);
+    
+    ierr = VecGetArrayRead(xv, &x); CHKERRQ(ierr);
+    ierr = VecGetArrayRead(ctx->ghost, &g); CHKERRQ(ierr);
+    ierr = VecGetArray(yv, &y); CHKERRQ(ierr);
+    SOLVER_OMP(parallel for schedule(static))
+    for (i = 0; i < ctx->nlocal; i++) {
+        PetscScalar sum = 0.0;
+        PetscInt k, t = ctx->off_ptr[i];
+        for (k = ctx->rowptr[i]; k < ctx->rowptr[i+1]; k++) {
+            PetscInt c = ctx->cols[k];
+            sum += ctx->vals[k] * ((c >= ctx->cstart && c < ctx->cend) ? x[c - ctx->cstart] : g[ctx->off_idx[t++]]);
+        }
+        y[i] = sum;
+    }
+    ierr = VecRestoreArrayRead(xv, &x); CHKERRQ(ierr);
+    ierr = VecRestoreArrayRead(ctx->ghost, &g); CHKERRQ(ierr);
+    ierr = VecRestoreArray(yv, &y); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode csr_wrap_get_diagonal(Mat S, Vec dv) {
+    PetscErrorCode ierr;
+    CSRWrapContext *ctx;
+    PetscScalar *d;
+    PetscInt i, k;
+    
+    ierr = MatShellGetContext(S, &ctx); CHKERRQ(ierr);
+    ierr = VecGetArray(dv, &d); CHKERRQ(ierr);
+    for (i = 0; i < ctx->nlocal; i++) {
+        d[i] = 0.0;
+        for (k = ctx->rowptr[i]; k < ctx->rowptr[i+1]; k++) {
+            if (ctx->cols[k] == ctx->cstart + i) d[i] += ctx->vals[k];
+        }
+    }
+    ierr = VecRestoreArray(dv, &d); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode csr_wrap_destroy(Mat S) {
+    PetscErrorCode ierr;
+    CSRWrapContext *ctx;
+    
+    ierr = MatShellGetContext(S, &ctx); CHKERRQ(ierr);
+    ierr = PetscFree2(ctx->off_ptr, ctx->off_idx); CHKERRQ(ierr);
+    ierr = VecScatterDestroy(&ctx->scatter); CHKERRQ(ierr);
+    ierr = VecDestroy(&ctx->ghost); CHKERRQ(ierr);
+    ierr = PetscFree(ctx); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode create_csr_wrap_operator(MPI_Comm comm, PetscInt nlocal, PetscInt n, const PetscInt rowptr[],
+                                               const PetscInt cols[], const PetscScalar vals[], Mat *A) {
+    PetscErrorCode ierr;
+    CSRWrapContext *ctx;
+    PetscInt i, k, noff = 0, nghost, *garray;
+    IS is;
+    Vec xtmp;
+    
+    ierr = PetscNew(&ctx); CHKERRQ(ierr);
+    ctx->nlocal = nlocal;
+    ctx->rowptr = rowptr;
+    ctx->cols = cols;
+    ctx->vals = vals;
+    ierr = MPI_Scan(&nlocal, &ctx->cend, 1, MPIU_INT, MPI_SUM, comm); CHKERRMPI(ierr);
+    ctx->cstart = ctx->cend - nlocal;
+    
+    // Внедиагональные столбцы: уникальные номера - ghost, для каждого элемента - позиция в нём
+    for (k = 0; k < rowptr[nlocal]; k++) {
+        if (cols[k] < ctx->cstart || cols[k] >= ctx->cend) noff++;
+    }
+    ierr = PetscMalloc2(nlocal + 1, &ctx->off_ptr, noff, &ctx->off_idx); CHKERRQ(ierr);
+    ierr = PetscMalloc1(noff, &garray); CHKERRQ(ierr);
+    noff = 0;
+    for (i = 0; i < nlocal; i++) {
+        ctx->off_ptr[i] = noff;
+        for (k = rowptr[i]; k < rowptr[i+1]; k++) {
+            if (cols[k] < ctx->cstart || cols[k] >= ctx->cend) garray[noff++] = cols[k];
+        }
+    }
+    ctx->off_ptr[nlocal] = noff;
+    nghost = noff;
+    ierr = PetscSortRemoveDupsInt(&nghost, garray); CHKERRQ(ierr);
+    noff = 0;
+    for (k = 0; k < rowptr[nlocal]; k++) {
+        if (cols[k] < ctx->cstart || cols[k] >= ctx->cend) {
+            ierr = PetscFindInt(cols[k], nghost, garray, &ctx->off_idx[noff++]); CHKERRQ(ierr);
+        }
+    }
+    
+    ierr = ISCreateGeneral(PETSC_COMM_SELF, nghost, garray, PETSC_OWN_POINTER, &is); CHKERRQ(ierr);
+    ierr = VecCreateSeq(PETSC_COMM_SELF, nghost, &ctx->ghost); CHKERRQ(ierr);
+    ierr = VecCreateMPIWithArray(comm, 1, nlocal, n, NULL, &xtmp); CHKERRQ(ierr);
+    ierr = VecScatterCreate(xtmp, is, ctx->ghost, NULL, &ctx->scatter); CHKERRQ(ierr);
+    ierr = VecDestroy(&xtmp); CHKERRQ(ierr);
+    ierr = ISDestroy(&is); CHKERRQ(ierr);
+    
+    ierr = MatCreateShell(comm, nlocal, nlocal, n, n, ctx, A); CHKERRQ(ierr);
+    ierr = MatShellSetOperation(*A, MATOP_MULT, (void (*)(void))csr_wrap_mult); CHKERRQ(ierr);
+    ierr = MatShellSetOperation(*A, MATOP_GET_DIAGONAL, (void (*)(void))csr_wrap_get_diagonal); CHKERRQ(ierr);
+    ierr = MatShellSetOperation(*A, MATOP_DESTROY, (void (*)(void))csr_wrap_destroy); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode solver_create_csr(LinearSolver *solver, MPI_Comm comm, PetscInt nlocal, PetscInt n,
+                                 const PetscInt rowptr[], const PetscInt cols[], PetscScalar vals[],
+                                 PetscScalar rhs[], PetscScalar sol[]) {
+    PetscErrorCode ierr;
+    PetscMPIInt size;
+    Mat A;
+    Vec x, b;
+    
+    if (rowptr[0] != 0) SETERRQ(PETSC_COMM_SELF, PETSC_ERR_ARG_WRONG, "rowptr[0] must be 0");
+    ierr = MPI_Comm_size(comm, &size); CHKERRMPI(ierr);
+    if (size == 1) {
+        // MatSeqAIJ работает прямо на массивах и не освобождает их
+        ierr = MatCreateSeqAIJWithArrays(comm, n, n, (PetscInt *)rowptr, (PetscInt *)cols, vals, &A); CHKERRQ(ierr);
+    } else {
+        // MPIAIJ без копии требует разделения на диагональный и внедиагональный блоки
+        ierr = create_csr_wrap_operator(comm, nlocal, n, rowptr, cols, vals, &A); CHKERRQ(ierr);
+    }
+    ierr = VecCreateMPIWithArray(comm, 1, nlocal, n, sol, &x); CHKERRQ(ierr);
+    ierr = VecCreateMPIWithArray(comm, 1, nlocal, n, rhs, &b); CHKERRQ(ierr);
+    
+    ierr = solver_create_with_vectors(solver, A, x, b); CHKERRQ(ierr);
+    solver->A_csr = A;
+    ierr = VecDestroy(&x); CHKERRQ(ierr);
+    ierr = VecDestroy(&b); CHKERRQ(ierr);
+    
+    // Перестановка и смена формата работают на копии матрицы: изменения vals её не достигнут
+    solver->reorder_type[0] = '\0';
+    solver->tune_format = PETSC_FALSE;
+    return 0;
+}
+
+// Новое состояние матрицы: предобуславливатель перестраивается при следующем решении
+PetscErrorCode solver_csr_values_changed(LinearSolver *solver) {
+    PetscErrorCode ierr;
+    
+    if (!solver->A_csr) SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_ARG_WRONGSTATE, "Solver was not created by solver_create_csr");
+    ierr = MatAssemblyBegin(solver->A_csr, MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+    ierr = MatAssemblyEnd(solver->A_csr, MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode solver_solve_csr(LinearSolver *solver) {
+    PetscErrorCode ierr;
+    
+    if (!solver->A_csr) SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_ARG_WRONGSTATE, "Solver was not created by solver_create_csr");
+    // rhs и sol вызывающий менял мимо PETSc: кэшированные нормы векторов недействительны
+    ierr = PetscObjectStateIncrease((PetscObject)solver->b); CHKERRQ(ierr);
+    ierr = PetscObjectStateIncrease((PetscObject)solver->x); CHKERRQ(ierr);
+    ierr = solver_solve(solver, solver->b, solver->x); CHKERRQ(ierr);
+    return 0;
+}
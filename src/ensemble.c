@@ -0,0 +1,128 @@
+#include "ensemble.h"
+#include <petsctime.h>
+
+PetscErrorCode ensemble_run(PetscInt nsystems, PetscInt group_size, const SolverConfig *config,
+                            EnsembleSystemFunction system_fn, EnsembleResultFunction result_fn, void *ctx,
+                            EnsembleStats *stats) {
+    PetscErrorCode ierr;
+    PetscMPIInt rank, size, group_rank;
+    MPI_Comm group;
+    MPI_Win win;
+    PetscInt *counter, index, one = 1, color, solves = 0, failed = 0, iterations = 0;
+    PetscLogDouble start_time, end_time, busy = 0.0;
+    PetscBool report, checkpoint;
+    
+    // Номера файлов отчёта ведутся на процессе, группы перезаписывали бы файлы друг друга;
+    // снимки разных систем с одним именем - тоже
+    ierr = PetscOptionsHasName(NULL, NULL, "-solver_report", &report); CHKERRQ(ierr);
+    if (report) SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_SUP, "-solver_report is not supported in ensemble mode");
+    ierr = PetscOptionsHasName(NULL, NULL, "-solver_checkpoint", &checkpoint); CHKERRQ(ierr);
+    if (checkpoint) SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_SUP, "-solver_checkpoint is not supported in ensemble mode");
+    
+    ierr = MPI_Comm_rank(PETSC_COMM_WORLD, &rank); CHKERRMPI(ierr);
+    ierr = MPI_Comm_size(PETSC_COMM_WORLD, &size); CHKERRMPI(ierr);
+    if (group_size < 1 || group_size > size) {
+        SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Group size must be between 1 and the number of ranks");
+    }
+    
+    // Группы из соседних процессов (на одном узле); последняя может быть меньше
+    color = rank / group_size;
+    ierr = MPI_Comm_split(PETSC_COMM_WORLD, (PetscMPIInt)color, rank, &group); CHKERRMPI(ierr);
+    ierr = MPI_Comm_rank(group, &group_rank); CHKERRMPI(ierr);
+    
+    ierr = PetscMemzero(stats, sizeof(*stats)); CHKERRQ(ierr);
+    stats->ngroups = (size + group_size - 1) / group_size;
+    stats->group_size = group_size;
+    ierr = PetscCalloc3(stats->ngroups, &stats->group_solves, stats->ngroups, &stats->group_busy,
+                        stats->ngroups, &stats->group_iterations); CHKERRQ(ierr);
+    
+    // Общая очередь - счётчик следующей системы на процессе 0
+    ierr = MPI_Win_allocate(rank == 0 ? sizeof(PetscInt) : 0, sizeof(PetscInt), MPI_INFO_NULL, PETSC_COMM_WORLD,
+                            &counter, &win); CHKERRMPI(ierr);
+    if (rank == 0) {
+        ierr = MPI_Win_lock(MPI_LOCK_EXCLUSIVE, 0, 0, win); CHKERRMPI(ierr);
+        *counter = 0;
+        ierr = MPI_Win_unlock(0, win); CHKERRMPI(ierr);
+    }
+    ierr = MPI_Barrier(PETSC_COMM_WORLD); CHKERRMPI(ierr);
+    ierr = MPI_Win_lock_all(MPI_MODE_NOCHECK, win); CHKERRMPI(ierr);
+    
+    ierr = PetscTime(&start_time); CHKERRQ(ierr);
+    for (;;) {
+        PetscLogDouble t0, t1;
+        LinearSolver solver;
+        SolverResult result;
+        Mat A = NULL;
+        Vec b = NULL;
+    
+        // Номер берёт ведущий процесс группы, остальные получают его от него
+        if (group_rank == 0) {
+            ierr = MPI_Fetch_and_op(&one, &index, MPIU_INT, 0, 0, MPI_SUM, win); CHKERRMPI(ierr);
+            ierr = MPI_Win_flush(0, win); CHKERRMPI(ierr);
+        }
+        ierr = MPI_Bcast(&index, 1, MPIU_INT, 0, group); CHKERRMPI(ierr);
+        if (index >= nsystems) break;
+    
+        ierr = PetscTime(&t0); CHKERRQ(ierr);
+        ierr = system_fn(group, index, &A, &b, ctx); CHKERRQ(ierr);
+        if (!b) {
+            ierr = MatCreateVecs(A, NULL, &b); CHKERRQ(ierr);
+            ierr = VecSet(b, 1.0); CHKERRQ(ierr);
+        }
+        ierr = solver_create(&solver, A); CHKERRQ(ierr);
+        if (config) { ierr = solver_configure(&solver, config); CHKERRQ(ierr); }
+        ierr = solver_setup(&solver); CHKERRQ(ierr);
+        ierr = solver_solve_with_result(&solver, b, solver.x, &result); CHKERRQ(ierr);
+        if (result_fn) { ierr = result_fn(group, index, solver.x, &result, ctx); CHKERRQ(ierr); }
+        ierr = solver_destroy(&solver); CHKERRQ(ierr);
+        ierr = MatDestroy(&A); CHKERRQ(ierr);
+        ierr = VecDestroy(&b); CHKERRQ(ierr);
+        ierr = PetscTime(&t1); CHKERRQ(ierr);
+    
+        busy += t1 - t0;
+        solves++;
+        iterations += result.iterations;
+        if (!result.converged) failed++;
+    }
+    ierr = PetscTime(&end_time); CHKERRQ(ierr);
+    ierr = MPI_Win_unlock_all(win); CHKERRMPI(ierr);
+    ierr = MPI_Win_free(&win); CHKERRMPI(ierr);
+    ierr = MPI_Comm_free(&group); CHKERRMPI(ierr);
+    
+    // Сводка: значения групп - от ведущих процессов
+    if (group_rank == 0) {
+        stats->group_solves[color] = solves;
+        stats->group_busy[color] = busy;
+        stats->group_iterations[color] = iterations;
+        stats->failed = failed;
+    }
+    stats->wall_time = end_time - start_time;
+    ierr = MPI_Allreduce(MPI_IN_PLACE, stats->group_solves, (PetscMPIInt)stats->ngroups, MPIU_INT, MPI_SUM, PETSC_COMM_WORLD); CHKERRMPI(ierr);
+    ierr = MPI_Allreduce(MPI_IN_PLACE, stats->group_busy, (PetscMPIInt)stats->ngroups, MPI_DOUBLE, MPI_SUM, PETSC_COMM_WORLD); CHKERRMPI(ierr);
+    ierr = MPI_Allreduce(MPI_IN_PLACE, stats->group_iterations, (PetscMPIInt)stats->ngroups, MPIU_INT, MPI_SUM, PETSC_COMM_WORLD); CHKERRMPI(ierr);
+    ierr = MPI_Allreduce(MPI_IN_PLACE, &stats->failed, 1, MPIU_INT, MPI_SUM, PETSC_COMM_WORLD); CHKERRMPI(ierr);
+    ierr = MPI_Allreduce(MPI_IN_PLACE, &stats->wall_time, 1, MPI_DOUBLE, MPI_MAX, PETSC_COMM_WORLD); CHKERRMPI(ierr);
+    stats->solves = nsystems;
+    stats->solves_per_second = stats->wall_time > 0.0 ? nsystems / stats->wall_time : 0.0;
+    return 0;
+}
+
+PetscErrorCode ensemble_print_stats(const EnsembleStats *stats) {
+    PetscInt g;
+    
+    PetscPrintf(PETSC_COMM_WORLD, "Ensemble: %" PetscInt_FMT " systems on %" PetscInt_FMT " groups of %" PetscInt_FMT " ranks, %.3f s, %.2f solves/s, %" PetscInt_FMT " not converged\n",
+                stats->solves, stats->ngroups, stats->group_size, stats->wall_time, (double)stats->solves_per_second, stats->failed);
+    PetscPrintf(PETSC_COMM_WORLD, "%6s %8s %10s %10s %12s\n", "group", "solves", "iterations", "busy", "utilization");
+    for (g = 0; g < stats->ngroups; g++) {
+        PetscPrintf(PETSC_COMM_WORLD, "%6" PetscInt_FMT " %8" PetscInt_FMT " %10" PetscInt_FMT " %10.3f %11.1f%%\n",
+                    g, stats->group_solves[g], stats->group_iterations[g], stats->group_busy[g],
+                    stats->wall_time > 0.0 ? 100.0 * stats->group_busy[g] / stats->wall_time : 0.0);
+    }
+    return 0;
+}
+
+PetscErrorCode ensemble_stats_destroy(EnsembleStats *stats) {
+    PetscErrorCode ierr;
+    ierr = PetscFree3(stats->group_solves, stats->group_busy, stats->group_iterations); CHKERRQ(ierr);
+    return 0;
+}
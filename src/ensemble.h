@@ -0,0 +1,36 @@
+#ifndef ENSEMBLE_H
+#define ENSEMBLE_H
+
+#include "solver.h"
+
+// Ансамбль независимых систем: PETSC_COMM_WORLD делится на группы по group_size
+// соседних процессов, каждая группа решает свои системы на своём коммуникаторе.
+// Номер следующей системы группа берёт из общего счётчика (MPI_Fetch_and_op на
+// процессе 0), поэтому группы с быстро сходящимися системами решают больше.
+// Вызов коллективный на PETSC_COMM_WORLD.
+
+// Сборка системы index на коммуникаторе группы; b может остаться NULL - правая часть из единиц
+typedef PetscErrorCode (*EnsembleSystemFunction)(MPI_Comm comm, PetscInt index, Mat *A, Vec *b, void *ctx);
+// Решение системы index (вызывается на всех процессах группы); может быть NULL
+typedef PetscErrorCode (*EnsembleResultFunction)(MPI_Comm comm, PetscInt index, Vec x, const SolverResult *result, void *ctx);
+
+typedef struct {
+    PetscInt ngroups, group_size;
+    PetscInt solves;
+    PetscInt failed;                // не сошлись
+    PetscLogDouble wall_time;       // максимум по процессам
+    PetscReal solves_per_second;
+    PetscInt *group_solves;         // по группам (на всех процессах)
+    PetscLogDouble *group_busy;     // время сборки и решений группы
+    PetscInt *group_iterations;
+} EnsembleStats;
+
+// config == NULL - настройки решателя по умолчанию
+PetscErrorCode ensemble_run(PetscInt nsystems, PetscInt group_size, const SolverConfig *config,
+                            EnsembleSystemFunction system_fn, EnsembleResultFunction result_fn, void *ctx,
+                            EnsembleStats *stats);
+// Загрузка группы - доля wall_time, занятая сборкой и решениями
+PetscErrorCode ensemble_print_stats(const EnsembleStats *stats);
+PetscErrorCode ensemble_stats_destroy(EnsembleStats *stats);
+
+#endif
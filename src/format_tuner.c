@@ -0,0 +1,232 @@
+#include "solver.h"
+
+// Выбор формата на процесс: в памяти, по отпечатку шаблона разреженности
+typedef struct {
+    uint64_t fingerprint;
+    char format[SOLVER_FORMAT_NAME_LEN];
+    PetscInt block_size;
+    PetscReal gbs;
+} FormatCacheEntry;
+
+static FormatCacheEntry format_cache[SOLVER_FORMAT_CACHE_SIZE];
+static PetscInt format_cache_count = 0, format_cache_next = 0;
+
+// Отпечаток: размер, число ненулевых и FNV-1a по длинам строк и глобальным столбцам,
+// объединённые XOR по процессам
+PetscErrorCode solver_pattern_fingerprint(Mat A, uint64_t *fingerprint) {
+    PetscErrorCode ierr;
+    PetscInt rstart, rend, row, ncols, k, N;
+    const PetscInt *cols;
+    uint64_t h = 1469598103934665603ULL;
+    
+    ierr = MatGetSize(A, &N, NULL); CHKERRQ(ierr);
+    ierr = MatGetOwnershipRange(A, &rstart, &rend); CHKERRQ(ierr);
+    for (row = rstart; row < rend; row++) {
+        ierr = MatGetRow(A, row, &ncols, &cols, NULL); CHKERRQ(ierr);
+        h = (h ^ (uint64_t)ncols) * 1099511628211ULL;
+        for (k = 0; k < ncols; k++) h = (h ^ (uint64_t)cols[k]) * 1099511628211ULL;
+        ierr = MatRestoreRow(A, row, &ncols, &cols, NULL); CHKERRQ(ierr);
+    }
+    h ^= (uint64_t)rstart * 0x9e3779b97f4a7c15ULL;
+    ierr = MPI_Allreduce(MPI_IN_PLACE, &h, 1, MPI_UINT64_T, MPI_BXOR, PetscObjectComm((PetscObject)A)); CHKERRMPI(ierr);
+    *fingerprint = h ^ (uint64_t)N;
+    return 0;
+}
+
+// Наибольший размер блока, при котором каждая блочная строка состоит из полных
+// выровненных плотных блоков bs x bs; 1 - блочной структуры нет
+static PetscErrorCode format_detect_block_size(Mat A, PetscInt *block_size) {
+    PetscErrorCode ierr;
+    const PetscInt candidates[] = {8, 6, 5, 4, 3, 2};
+    PetscInt c, rstart, rend, N, *pattern = NULL, capacity = 0;
+    
+    ierr = MatGetSize(A, &N, NULL); CHKERRQ(ierr);
+    ierr = MatGetOwnershipRange(A, &rstart, &rend); CHKERRQ(ierr);
+    *block_size = 1;
+    
+    for (c = 0; c < (PetscInt)(sizeof(candidates) / sizeof(candidates[0])); c++) {
+        PetscInt bs = candidates[c], row, j;
+        int ok = (N % bs == 0 && rstart % bs == 0 && rend % bs == 0);
+    
+        for (row = rstart; ok && row < rend; row += bs) {
+            const PetscInt *cols;
+            PetscInt npattern, ncols, r;
+    
+            // Первая строка блока копируется: MPIAIJ держит открытой только одну строку
+            ierr = MatGetRow(A, row, &ncols, &cols, NULL); CHKERRQ(ierr);
+            if (ncols > capacity) {
+                ierr = PetscFree(pattern); CHKERRQ(ierr);
+                capacity = PetscMax(ncols, 2 * capacity);
+                ierr = PetscMalloc1(capacity, &pattern); CHKERRQ(ierr);
+            }
+            npattern = ncols;
+            ierr = PetscArraycpy(pattern, cols, ncols); CHKERRQ(ierr);
+            ierr = MatRestoreRow(A, row, &ncols, &cols, NULL); CHKERRQ(ierr);
+    
+            for (j = 0; ok && j < npattern; j++) {
+                if (j % bs == 0) ok = (pattern[j] % bs == 0 && j + bs <= npattern);
+                else ok = (pattern[j] == pattern[j - 1] + 1);
+            }
+            // Остальные строки блока с тем же шаблоном
+            for (r = 1; ok && r < bs; r++) {
+                ierr = MatGetRow(A, row + r, &ncols, &cols, NULL); CHKERRQ(ierr);
+                ok = (ncols == npattern);
+                for (j = 0; ok && j < ncols; j++) ok = (cols[j] == pattern[j]);
+                ierr = MatRestoreRow(A, row + r, &ncols, &cols, NULL); CHKERRQ(ierr);
+            }
+        }
+        ierr = MPI_Allreduce(MPI_IN_PLACE, &ok, 1, MPI_INT, MPI_LAND, PetscObjectComm((PetscObject)A)); CHKERRMPI(ierr);
+        if (ok) {
+            *block_size = bs;
+            break;
+        }
+    }
+    ierr = PetscFree(pattern); CHKERRQ(ierr);
+    return 0;
+}
+
+// Копия в BAIJ с заданным размером блока: предаллокация по блочным строкам, затем вставка по строкам
+static PetscErrorCode format_convert_baij(Mat A, PetscInt bs, Mat *B) {
+    PetscErrorCode ierr;
+    PetscInt rstart, rend, cstart, cend, nlocal, N, row, ncols, k, *d_nnz, *o_nnz;
+    const PetscInt *cols;
+    const PetscScalar *vals;
+    
+    ierr = MatGetSize(A, &N, NULL); CHKERRQ(ierr);
+    ierr = MatGetOwnershipRange(A, &rstart, &rend); CHKERRQ(ierr);
+    ierr = MatGetOwnershipRangeColumn(A, &cstart, &cend); CHKERRQ(ierr);
+    nlocal = rend - rstart;
+    
+    ierr = PetscCalloc2(nlocal / bs, &d_nnz, nlocal / bs, &o_nnz); CHKERRQ(ierr);
+    for (row = rstart; row < rend; row += bs) {
+        ierr = MatGetRow(A, row, &ncols, &cols, NULL); CHKERRQ(ierr);
+        for (k = 0; k < ncols; k += bs) {
+            if (cols[k] >= cstart && cols[k] < cend) d_nnz[(row - rstart) / bs]++;
+            else o_nnz[(row - rstart) / bs]++;
+        }
+        ierr = MatRestoreRow(A, row, &ncols, &cols, NULL); CHKERRQ(ierr);
+    }
+    
+    ierr = MatCreate(PetscObjectComm((PetscObject)A), B); CHKERRQ(ierr);
+    ierr = MatSetSizes(*B, nlocal, cend - cstart, N, N); CHKERRQ(ierr);
+    ierr = MatSetType(*B, MATBAIJ); CHKERRQ(ierr);
+    ierr = MatSetBlockSize(*B, bs); CHKERRQ(ierr);
+    ierr = MatXAIJSetPreallocation(*B, bs, d_nnz, o_nnz, NULL, NULL); CHKERRQ(ierr);
+    ierr = PetscFree2(d_nnz, o_nnz); CHKERRQ(ierr);
+    
+    for (row = rstart; row < rend; row++) {
+        ierr = MatGetRow(A, row, &ncols, &cols, &vals); CHKERRQ(ierr);
+        ierr = MatSetValues(*B, 1, &row, ncols, cols, vals, INSERT_VALUES); CHKERRQ(ierr);
+        ierr = MatRestoreRow(A, row, &ncols, &cols, &vals); CHKERRQ(ierr);
+    }
+    ierr = MatAssemblyBegin(*B, MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+    ierr = MatAssemblyEnd(*B, MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+    return 0;
+}
+
+// Матрица в формате format; для "aij" - NULL (используется сама A)
+static PetscErrorCode format_convert(Mat A, const char *format, PetscInt bs, Mat *B) {
+    PetscErrorCode ierr;
+    PetscBool is_sell, is_baij;
+    
+    *B = NULL;
+    ierr = PetscStrcmp(format, "sell", &is_sell); CHKERRQ(ierr);
+    ierr = PetscStrcmp(format, "baij", &is_baij); CHKERRQ(ierr);
+    if (is_sell) {
+        ierr = MatConvert(A, MATSELL, MAT_INITIAL_MATRIX, B); CHKERRQ(ierr);
+    } else if (is_baij) {
+        ierr = format_convert_baij(A, bs, B); CHKERRQ(ierr);
+    }
+    return 0;
+}
+
+// Полезный трафик одного SpMV в модели CSR: значения и столбцы, указатели строк,
+// чтение x и запись y; одинаков для всех форматов, поэтому ГБ/с сравнимы
+PetscErrorCode solver_spmv_bytes(Mat A, PetscLogDouble *bytes) {
+    PetscErrorCode ierr;
+    MatInfo info;
+    PetscInt N;
+    
+    ierr = MatGetSize(A, &N, NULL); CHKERRQ(ierr);
+    ierr = MatGetInfo(A, MAT_GLOBAL_SUM, &info); CHKERRQ(ierr);
+    *bytes = info.nz_used * (sizeof(PetscScalar) + sizeof(PetscInt)) + (PetscLogDouble)(N + 1) * sizeof(PetscInt)
+             + 2.0 * N * sizeof(PetscScalar);
+    return 0;
+}
+
+PetscErrorCode solver_set_format_tuning(LinearSolver *solver, PetscBool enable) {
+    solver->tune_format = enable;
+    return 0;
+}
+
+PetscErrorCode solver_tune_format(LinearSolver *solver) {
+    PetscErrorCode ierr;
+    const char *formats[] = {"aij", "sell", "baij"};
+    PetscBool is_aij;
+    PetscInt f, k, bs, best = 0;
+    PetscLogDouble bytes, time, best_time = 0.0;
+    uint64_t fingerprint;
+    Mat B;
+    
+    if (!solver->tune_format || solver->A_format) return 0;
+    // Смешанная точность держит свою копию в float, PCMG строит грубые операторы по A
+    if (solver->A_single || solver->dm) return 0;
+    ierr = PetscObjectBaseTypeCompareAny((PetscObject)solver->A, &is_aij, MATSEQAIJ, MATMPIAIJ, ""); CHKERRQ(ierr);
+    if (!is_aij) return 0;
+    
+    ierr = solver_pattern_fingerprint(solver->A, &fingerprint); CHKERRQ(ierr);
+    ierr = solver_spmv_bytes(solver->A, &bytes); CHKERRQ(ierr);
+    
+    for (k = 0; k < format_cache_count; k++) {
+        if (format_cache[k].fingerprint == fingerprint) break;
+    }
+    
+    if (k < format_cache_count) {
+        ierr = PetscStrncpy(solver->spmv_format, format_cache[k].format, sizeof(solver->spmv_format)); CHKERRQ(ierr);
+        solver->spmv_block_size = format_cache[k].block_size;
+        solver->spmv_gbs = format_cache[k].gbs;
+    } else {
+        ierr = format_detect_block_size(solver->A, &bs); CHKERRQ(ierr);
+        for (f = 0; f < 3; f++) {
+            if (f == 2 && bs == 1) continue;
+            ierr = format_convert(solver->A, formats[f], bs, &B); CHKERRQ(ierr);
+            ierr = solver_time_spmv(B ? B : solver->A, &time); CHKERRQ(ierr);
+            ierr = MatDestroy(&B); CHKERRQ(ierr);
+            ierr = PetscInfo(solver->ksp, "SpMV format %s: %g seconds\n", formats[f], time); CHKERRQ(ierr);
+            // Время - максимум по процессам, выбор одинаков на всех процессах
+            if (f == 0 || time < best_time) {
+                best = f;
+                best_time = time;
+            }
+        }
+        ierr = PetscStrncpy(solver->spmv_format, formats[best], sizeof(solver->spmv_format)); CHKERRQ(ierr);
+        solver->spmv_block_size = (best == 2) ? bs : 1;
+        solver->spmv_gbs = best_time > 0.0 ? bytes / best_time / 1e9 : 0.0;
+    
+        // Кэш по кругу: новые шаблоны вытесняют самые старые
+        k = format_cache_next;
+        format_cache_next = (format_cache_next + 1) % SOLVER_FORMAT_CACHE_SIZE;
+        format_cache_count = PetscMin(format_cache_count + 1, SOLVER_FORMAT_CACHE_SIZE);
+        format_cache[k].fingerprint = fingerprint;
+        ierr = PetscStrncpy(format_cache[k].format, solver->spmv_format, SOLVER_FORMAT_NAME_LEN); CHKERRQ(ierr);
+        format_cache[k].block_size = solver->spmv_block_size;
+        format_cache[k].gbs = solver->spmv_gbs;
+    }
+    
+    // SpMV в KSP - в выбранном формате, предобуславливатель строится по исходной AIJ
+    ierr = format_convert(solver->A, solver->spmv_format, solver->spmv_block_size, &solver->A_format); CHKERRQ(ierr);
+    if (solver->A_format) {
+        ierr = KSPSetOperators(solver->ksp, solver->A_format, solver->A); CHKERRQ(ierr);
+    }
+    return 0;
+}
+
+PetscErrorCode solver_refresh_format(LinearSolver *solver) {
+    PetscErrorCode ierr;
+    
+    if (!solver->A_format) return 0;
+    // Новые значения с тем же шаблоном: формат остаётся, копия строится заново
+    ierr = MatDestroy(&solver->A_format); CHKERRQ(ierr);
+    ierr = format_convert(solver->A, solver->spmv_format, solver->spmv_block_size, &solver->A_format); CHKERRQ(ierr);
+    return 0;
+}
@@ -1,15 +1,24 @@
 #include <petscksp.h>
 #include "solver.h"
 #include "matrix_utils.h"
+#include "stencil_operator.h"
+#include "benchmark.h"
+#include "repartition.h"
 
 int main(int argc, char **argv) {
     PetscErrorCode ierr;
     LinearSolver solver;
-    Mat A;
-    Vec b;
+    Mat A, A_solve;
+    Vec b, b_solve;
+    Repartition rp;
     PetscInt matrix_size = 1000;
+    PetscReal random_density = 0.0;
+    PetscLogDouble assembly_time;
     char preconditioner[PETSC_MAX_PATH_LEN] = "jacobi";
-    PetscBool test_mode = PETSC_FALSE, benchmark_mode = PETSC_FALSE;
+    char gmres_variant[PETSC_MAX_PATH_LEN] = "";
+    char mat_file[PETSC_MAX_PATH_LEN] = "", rhs_file[PETSC_MAX_PATH_LEN] = "";
+    PetscBool test_mode = PETSC_FALSE, benchmark_mode = PETSC_FALSE, matrix_free = PETSC_FALSE;
+    PetscBool mixed_precision = PETSC_FALSE, repartition = PETSC_FALSE;
     
     // Инициализация
     ierr = solver_initialize(argc, argv); CHKERRQ(ierr);
@@ -19,32 +28,108 @@ int main(int argc, char **argv) {
     ierr = PetscOptionsGetString(NULL, NULL, "-pc_type", preconditioner, PETSC_MAX_PATH_LEN, NULL); CHKERRQ(ierr);
     ierr = PetscOptionsGetBool(NULL, NULL, "-test", &test_mode, NULL); CHKERRQ(ierr);
     ierr = PetscOptionsGetBool(NULL, NULL, "-benchmark", &benchmark_mode, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetBool(NULL, NULL, "-matrix_free", &matrix_free, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetString(NULL, NULL, "-mat_file", mat_file, PETSC_MAX_PATH_LEN, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetString(NULL, NULL, "-rhs_file", rhs_file, PETSC_MAX_PATH_LEN, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetBool(NULL, NULL, "-mixed_precision", &mixed_precision, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetString(NULL, NULL, "-gmres_variant", gmres_variant, PETSC_MAX_PATH_LEN, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetReal(NULL, NULL, "-random_density", &random_density, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetBool(NULL, NULL, "-repartition", &repartition, NULL); CHKERRQ(ierr);
     
     if (test_mode) {
         PetscPrintf(PETSC_COMM_WORLD, "Running in test mode...\n");
         // Здесь можно запустить тесты
     } else if (benchmark_mode) {
         PetscPrintf(PETSC_COMM_WORLD, "Running benchmarks...\n");
-        // TODO: Implement run_benchmarks function
+        ierr = run_benchmarks(); CHKERRQ(ierr);
     } else {
         // Основной режим работы
-        PetscPrintf(PETSC_COMM_WORLD, "Creating Laplace matrix of size %" PetscInt_FMT "...\n", matrix_size);
-        ierr = create_laplace_matrix(matrix_size, &A); CHKERRQ(ierr);
-        ierr = create_rhs_vector(matrix_size, &b); CHKERRQ(ierr);
+        if (mat_file[0]) {
+            MatrixLoadStats stats;
+            PetscPrintf(PETSC_COMM_WORLD, "Loading matrix from %s...\n", mat_file);
+            ierr = read_matrix_from_file(mat_file, &A); CHKERRQ(ierr);
+            ierr = MatGetSize(A, &matrix_size, NULL); CHKERRQ(ierr);
+            ierr = get_last_load_stats(&stats); CHKERRQ(ierr);
+            PetscPrintf(PETSC_COMM_WORLD, "Load time: %g seconds (%g GB/s), peak memory per rank: %.1f-%.1f MB\n",
+                        stats.time, stats.throughput, stats.peak_rss_min / 1048576.0, stats.peak_rss_max / 1048576.0);
+        } else if (matrix_free) {
+            // Безматричный оператор: только Jacobi или none в качестве предобуславливателя
+            PetscPrintf(PETSC_COMM_WORLD, "Creating matrix-free Laplace operator of size %" PetscInt_FMT "...\n", matrix_size);
+            ierr = create_laplace_operator(matrix_size, &A); CHKERRQ(ierr);
+        } else if (random_density > 0.0) {
+            PetscPrintf(PETSC_COMM_WORLD, "Creating random sparse matrix of size %" PetscInt_FMT " (density %g)...\n",
+                        matrix_size, (double)random_density);
+            ierr = create_random_sparse_matrix(matrix_size, random_density, &A); CHKERRQ(ierr);
+            ierr = get_last_assembly_time(&assembly_time); CHKERRQ(ierr);
+            PetscPrintf(PETSC_COMM_WORLD, "Assembly time: %g seconds\n", assembly_time);
+        } else {
+            PetscPrintf(PETSC_COMM_WORLD, "Creating Laplace matrix of size %" PetscInt_FMT "...\n", matrix_size);
+            ierr = create_laplace_matrix(matrix_size, &A); CHKERRQ(ierr);
+            ierr = get_last_assembly_time(&assembly_time); CHKERRQ(ierr);
+            PetscPrintf(PETSC_COMM_WORLD, "Assembly time: %g seconds\n", assembly_time);
+        }
+        if (rhs_file[0]) {
+            MatrixLoadStats stats;
+            ierr = read_vector_from_file(rhs_file, &b); CHKERRQ(ierr);
+            ierr = get_last_load_stats(&stats); CHKERRQ(ierr);
+            PetscPrintf(PETSC_COMM_WORLD, "Loaded right-hand side from %s in %g seconds (%g GB/s)\n",
+                        rhs_file, stats.time, stats.throughput);
+        } else {
+            ierr = create_rhs_vector(matrix_size, &b); CHKERRQ(ierr);
+        }
+        
+        // Переразбиение строк: решатель работает с rp.A, решение возвращается в исходное разбиение
+        A_solve = A;
+        b_solve = b;
+        if (repartition) {
+            ierr = repartition_create(A, &rp); CHKERRQ(ierr);
+            ierr = repartition_print_stats(&rp); CHKERRQ(ierr);
+            ierr = MatCreateVecs(rp.A, NULL, &b_solve); CHKERRQ(ierr);
+            ierr = repartition_forward(&rp, b, b_solve); CHKERRQ(ierr);
+            A_solve = rp.A;
+        }
         
         // Создание решателя
-        ierr = solver_create(&solver, A); CHKERRQ(ierr);
+        ierr = solver_create(&solver, A_solve); CHKERRQ(ierr);
         ierr = solver_set_preconditioner(&solver, preconditioner); CHKERRQ(ierr);
+        if (gmres_variant[0]) {
+            SolverGMRESVariant variant;
+            PetscBool found;
+            ierr = solver_gmres_variant_from_string(gmres_variant, &variant, &found); CHKERRQ(ierr);
+            if (!found) SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_ARG_WRONG, "Unknown -gmres_variant %s", gmres_variant);
+            ierr = solver_set_gmres_variant(&solver, variant); CHKERRQ(ierr);
+        }
+        if (mixed_precision) {
+            ierr = solver_set_mixed_precision(&solver, PETSC_TRUE); CHKERRQ(ierr);
+        }
         ierr = solver_setup(&solver); CHKERRQ(ierr);
         
         // Решение системы
-        ierr = solver_solve(&solver, b, solver.x); CHKERRQ(ierr);
+        ierr = solver_solve(&solver, b_solve, solver.x); CHKERRQ(ierr);
+        if (repartition) {
+            // Решение в исходном разбиении и невязка по исходной матрице
+            Vec x, r;
+            PetscReal rnorm;
+            ierr = VecDuplicate(b, &x); CHKERRQ(ierr);
+            ierr = VecDuplicate(b, &r); CHKERRQ(ierr);
+            ierr = repartition_backward(&rp, solver.x, x); CHKERRQ(ierr);
+            ierr = MatMult(A, x, r); CHKERRQ(ierr);
+            ierr = VecAYPX(r, -1.0, b); CHKERRQ(ierr);
+            ierr = VecNorm(r, NORM_2, &rnorm); CHKERRQ(ierr);
+            PetscPrintf(PETSC_COMM_WORLD, "Residual in the original layout: %g\n", (double)rnorm);
+            ierr = VecDestroy(&x); CHKERRQ(ierr);
+            ierr = VecDestroy(&r); CHKERRQ(ierr);
+        }
         
         // Вывод информации
         ierr = solver_print_info(&solver); CHKERRQ(ierr);
         
         // Очистка
         ierr = solver_destroy(&solver); CHKERRQ(ierr);
+        if (repartition) {
+            ierr = VecDestroy(&b_solve); CHKERRQ(ierr);
+            ierr = repartition_destroy(&rp); CHKERRQ(ierr);
+        }
         ierr = MatDestroy(&A); CHKERRQ(ierr);
         ierr = VecDestroy(&b); CHKERRQ(ierr);
     }
@@ -0,0 +1,511 @@
+#include "matrix_utils.h"
+#include <petscmat.h>
+#include <petscviewer.h>
+#include <petsctime.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <stdlib.h>
+
+// Запас на дочитывание последней строки своего байтового диапазона
+#define MM_LINE_MAX 1024
+
+// Статистика последней загрузки матрицы или вектора
+static MatrixLoadStats last_load_stats;
+
+typedef struct {
+    PetscBool coordinate;       // coordinate - разреженный формат, array - плотный
+    PetscBool pattern;          // значения не хранятся, элемент равен 1
+    PetscBool symmetric, skew;  // хранится только нижний треугольник
+    PetscInt M, N, nnz;
+    long data_offset;           // смещение первой строки данных
+} MMHeader;
+
+// Элементы (строка, столбец, значение) в порядке чтения
+typedef struct {
+    PetscInt count, capacity;
+    PetscInt *rows, *cols;
+    PetscScalar *vals;
+} MMEntries;
+
+static PetscErrorCode is_matrix_market(const char *filename, PetscBool *flg) {
+    PetscErrorCode ierr;
+    PetscBool mm;
+    
+    ierr = PetscStrendswith(filename, ".mtx", flg); CHKERRQ(ierr);
+    ierr = PetscStrendswith(filename, ".mm", &mm); CHKERRQ(ierr);
+    *flg = (PetscBool)(*flg || mm);
+    return 0;
+}
+
+static PetscErrorCode entries_add(MMEntries *e, PetscInt row, PetscInt col, PetscScalar val) {
+    PetscErrorCode ierr;
+    
+    if (e->count == e->capacity) {
+        e->capacity = PetscMax(2 * e->capacity, 1024);
+        ierr = PetscRealloc(sizeof(PetscInt) * e->capacity, &e->rows); CHKERRQ(ierr);
+        ierr = PetscRealloc(sizeof(PetscInt) * e->capacity, &e->cols); CHKERRQ(ierr);
+        ierr = PetscRealloc(sizeof(PetscScalar) * e->capacity, &e->vals); CHKERRQ(ierr);
+    }
+    e->rows[e->count] = row;
+    e->cols[e->count] = col;
+    e->vals[e->count] = val;
+    e->count++;
+    return 0;
+}
+
+static PetscErrorCode entries_destroy(MMEntries *e) {
+    PetscErrorCode ierr;
+    ierr = PetscFree(e->rows); CHKERRQ(ierr);
+    ierr = PetscFree(e->cols); CHKERRQ(ierr);
+    ierr = PetscFree(e->vals); CHKERRQ(ierr);
+    e->count = e->capacity = 0;
+    return 0;
+}
+
+// Заголовок небольшой и читается каждым процессом самостоятельно
+static PetscErrorCode mm_read_header(const char *filename, MMHeader *h) {
+    PetscErrorCode ierr;
+    FILE *fp;
+    char line[MM_LINE_MAX], object[64], format[64], field[64], symmetry[64];
+    long long M = 0, N = 0, nnz = 0;
+    PetscBool flg;
+    
+    fp = fopen(filename, "r");
+    if (!fp) SETERRQ(PETSC_COMM_SELF, PETSC_ERR_FILE_OPEN, "Cannot open MatrixMarket file %s", filename);
+    if (!fgets(line, sizeof(line), fp) ||
+        sscanf(line, "%%%%MatrixMarket %63s %63s %63s %63s", object, format, field, symmetry) != 4) {
+        fclose(fp);
+        SETERRQ(PETSC_COMM_SELF, PETSC_ERR_FILE_UNEXPECTED, "Invalid MatrixMarket banner in %s", filename);
+    }
+    
+    ierr = PetscStrcasecmp(format, "coordinate", &h->coordinate); CHKERRQ(ierr);
+    ierr = PetscStrcasecmp(field, "pattern", &h->pattern); CHKERRQ(ierr);
+    ierr = PetscStrcasecmp(field, "complex", &flg); CHKERRQ(ierr);
+    if (flg) {
+        fclose(fp);
+        SETERRQ(PETSC_COMM_SELF, PETSC_ERR_SUP, "Complex MatrixMarket files are not supported");
+    }
+    ierr = PetscStrcasecmp(symmetry, "skew-symmetric", &h->skew); CHKERRQ(ierr);
+    ierr = PetscStrcasecmp(symmetry, "general", &flg); CHKERRQ(ierr);
+    h->symmetric = (PetscBool)!flg;
+    
+    // Комментарии и пустые строки до строки размеров
+    do {
+        if (!fgets(line, sizeof(line), fp)) {
+            fclose(fp);
+            SETERRQ(PETSC_COMM_SELF, PETSC_ERR_FILE_UNEXPECTED, "Missing size line in %s", filename);
+        }
+    } while (line[0] == '%' || line[0] == '\n' || line[0] == '\r');
+    
+    if ((h->coordinate && sscanf(line, "%lld %lld %lld", &M, &N, &nnz) != 3) ||
+        (!h->coordinate && sscanf(line, "%lld %lld", &M, &N) != 2)) {
+        fclose(fp);
+        SETERRQ(PETSC_COMM_SELF, PETSC_ERR_FILE_UNEXPECTED, "Invalid size line in %s", filename);
+    }
+    h->M = (PetscInt)M;
+    h->N = (PetscInt)N;
+    h->nnz = h->coordinate ? (PetscInt)nnz : (PetscInt)(M * N);
+    h->data_offset = ftell(fp);
+    fclose(fp);
+    return 0;
+}
+
+// Каждый процесс читает свою долю секции данных через MPI-IO. Строки,
+// начинающиеся внутри [start, end), принадлежат процессу; хвост последней
+// строки дочитывается из следующего диапазона.
+static PetscErrorCode mm_read_chunk(MPI_Comm comm, const char *filename, long data_offset, char **buf, size_t *first, size_t *stop) {
+    PetscErrorCode ierr;
+    MPI_File fh;
+    MPI_Offset file_size, data_len, start, end, begin, read_end;
+    PetscMPIInt rank, size;
+    size_t len, pos, skip = 0;
+    
+    ierr = MPI_Comm_rank(comm, &rank); CHKERRMPI(ierr);
+    ierr = MPI_Comm_size(comm, &size); CHKERRMPI(ierr);
+    ierr = MPI_File_open(comm, (char *)filename, MPI_MODE_RDONLY, MPI_INFO_NULL, &fh); CHKERRMPI(ierr);
+    ierr = MPI_File_get_size(fh, &file_size); CHKERRMPI(ierr);
+    
+    data_len = file_size - data_offset;
+    start = data_offset + data_len * rank / size;
+    end = data_offset + data_len * (rank + 1) / size;
+    // Байт перед диапазоном показывает, начинается ли в start новая строка
+    begin = (start > data_offset) ? start - 1 : start;
+    read_end = PetscMin(file_size, end + MM_LINE_MAX);
+    len = (size_t)(read_end - begin);
+    
+    ierr = PetscMalloc1(len + 1, buf); CHKERRQ(ierr);
+    for (pos = 0; pos < len; ) {
+        int count = (int)PetscMin(len - pos, (size_t)1 << 30);
+        MPI_Status status;
+        ierr = MPI_File_read_at(fh, begin + (MPI_Offset)pos, *buf + pos, count, MPI_BYTE, &status); CHKERRMPI(ierr);
+        pos += (size_t)count;
+    }
+    (*buf)[len] = '\0';
+    ierr = MPI_File_close(&fh); CHKERRMPI(ierr);
+    
+    if (start > data_offset) {
+        while (skip < len && (*buf)[skip] != '\n') skip++;
+        skip++;
+    }
+    *first = skip;
+    *stop = (size_t)(end - begin);
+    return 0;
+}
+
+// Разбор своих строк; для array-формата индекс - номер строки данных (по столбцам)
+static PetscErrorCode mm_parse_chunk(const MMHeader *h, const char *buf, size_t first, size_t stop, PetscInt64 index_offset, MMEntries *e) {
+    PetscErrorCode ierr;
+    const char *p = buf + first;
+    char *q;
+    PetscInt64 index = index_offset;
+    
+    while ((size_t)(p - buf) < stop && *p) {
+        long long i, j;
+        double v = 1.0;
+    
+        while (*p == ' ' || *p == '\t') p++;
+        if (*p == '\n' || *p == '\r' || *p == '%' || *p == '\0') goto next;
+    
+        if (h->coordinate) {
+            i = strtoll(p, &q, 10);
+            j = strtoll(q, &q, 10);
+            if (!h->pattern) v = strtod(q, &q);
+            if (i < 1 || i > h->M || j < 1 || j > h->N) SETERRQ(PETSC_COMM_SELF, PETSC_ERR_FILE_UNEXPECTED, "MatrixMarket entry out of range");
+            ierr = entries_add(e, (PetscInt)(i - 1), (PetscInt)(j - 1), (PetscScalar)v); CHKERRQ(ierr);
+            if (h->symmetric && i != j) {
+                ierr = entries_add(e, (PetscInt)(j - 1), (PetscInt)(i - 1), (PetscScalar)(h->skew ? -v : v)); CHKERRQ(ierr);
+            }
+        } else {
+            v = strtod(p, &q);
+            ierr = entries_add(e, (PetscInt)(index % h->M), (PetscInt)(index / h->M), (PetscScalar)v); CHKERRQ(ierr);
+            index++;
+        }
+    next:
+        while (*p && *p != '\n') p++;
+        if (*p) p++;
+    }
+    return 0;
+}
+
+// Число строк данных array-формата в своём диапазоне (для глобальной нумерации)
+static PetscInt64 mm_count_lines(const char *buf, size_t first, size_t stop) {
+    const char *p = buf + first;
+    PetscInt64 count = 0;
+    
+    while ((size_t)(p - buf) < stop && *p) {
+        const char *s = p;
+        while (*s == ' ' || *s == '\t') s++;
+        if (*s != '\n' && *s != '\r' && *s != '%' && *s != '\0') count++;
+        while (*p && *p != '\n') p++;
+        if (*p) p++;
+    }
+    return count;
+}
+
+// Пересылка элементов процессам-владельцам строк (Alltoallv), минуя rank 0
+static PetscErrorCode mm_route(MPI_Comm comm, PetscInt M, PetscInt *nlocal, PetscInt *rstart, MMEntries *e) {
+    PetscErrorCode ierr;
+    PetscMPIInt rank, size, p, *scounts, *rcounts, *sdispls, *rdispls;
+    PetscInt *ranges, *owner, *srows, *scols, *pos, k, nrecv, rend;
+    PetscScalar *svals;
+    MMEntries recv = {0, 0, NULL, NULL, NULL};
+    
+    ierr = MPI_Comm_rank(comm, &rank); CHKERRMPI(ierr);
+    ierr = MPI_Comm_size(comm, &size); CHKERRMPI(ierr);
+    
+    // То же разбиение строк, что и PETSC_DECIDE в MatSetSizes/VecSetSizes
+    *nlocal = PETSC_DECIDE;
+    ierr = PetscSplitOwnership(comm, nlocal, &M); CHKERRQ(ierr);
+    ierr = MPI_Scan(nlocal, &rend, 1, MPIU_INT, MPI_SUM, comm); CHKERRMPI(ierr);
+    *rstart = rend - *nlocal;
+    ierr = PetscMalloc1(size + 1, &ranges); CHKERRQ(ierr);
+    ranges[0] = 0;
+    ierr = MPI_Allgather(&rend, 1, MPIU_INT, ranges + 1, 1, MPIU_INT, comm); CHKERRMPI(ierr);
+    
+    ierr = PetscCalloc4(size, &scounts, size, &rcounts, size + 1, &sdispls, size + 1, &rdispls); CHKERRQ(ierr);
+    ierr = PetscMalloc2(e->count, &owner, size, &pos); CHKERRQ(ierr);
+    for (k = 0; k < e->count; k++) {
+        PetscInt lo = 0, hi = size;
+        while (hi - lo > 1) {
+            PetscInt mid = (lo + hi) / 2;
+            if (e->rows[k] >= ranges[mid]) lo = mid;
+            else hi = mid;
+        }
+        owner[k] = lo;
+        scounts[lo]++;
+    }
+    ierr = MPI_Alltoall(scounts, 1, MPI_INT, rcounts, 1, MPI_INT, comm); CHKERRMPI(ierr);
+    for (p = 0; p < size; p++) {
+        sdispls[p + 1] = sdispls[p] + scounts[p];
+        rdispls[p + 1] = rdispls[p] + rcounts[p];
+        pos[p] = sdispls[p];
+    }
+    nrecv = rdispls[size];
+    
+    ierr = PetscMalloc3(e->count, &srows, e->count, &scols, e->count, &svals); CHKERRQ(ierr);
+    for (k = 0; k < e->count; k++) {
+        PetscInt d = pos[owner[k]]++;
+        srows[d] = e->rows[k];
+        scols[d] = e->cols[k];
+        svals[d] = e->vals[k];
+    }
+    ierr = entries_destroy(e); CHKERRQ(ierr);
+    
+    ierr = PetscMalloc1(nrecv, &recv.rows); CHKERRQ(ierr);
+    ierr = PetscMalloc1(nrecv, &recv.cols); CHKERRQ(ierr);
+    ierr = PetscMalloc1(nrecv, &recv.vals); CHKERRQ(ierr);
+    ierr = MPI_Alltoallv(srows, scounts, sdispls, MPIU_INT, recv.rows, rcounts, rdispls, MPIU_INT, comm); CHKERRMPI(ierr);
+    ierr = MPI_Alltoallv(scols, scounts, sdispls, MPIU_INT, recv.cols, rcounts, rdispls, MPIU_INT, comm); CHKERRMPI(ierr);
+    ierr = MPI_Alltoallv(svals, scounts, sdispls, MPIU_SCALAR, recv.vals, rcounts, rdispls, MPIU_SCALAR, comm); CHKERRMPI(ierr);
+    recv.count = recv.capacity = nrecv;
+    *e = recv;
+    
+    ierr = PetscFree3(srows, scols, svals); CHKERRQ(ierr);
+    ierr = PetscFree2(owner, pos); CHKERRQ(ierr);
+    ierr = PetscFree4(scounts, rcounts, sdispls, rdispls); CHKERRQ(ierr);
+    ierr = PetscFree(ranges); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode load_stats_finish(MPI_Comm comm, const char *filename, PetscLogDouble start_time) {
+    PetscErrorCode ierr;
+    PetscLogDouble end_time, elapsed, rss[2];
+    struct rusage usage;
+    struct stat st;
+    
+    ierr = PetscTime(&end_time); CHKERRQ(ierr);
+    elapsed = end_time - start_time;
+    ierr = MPI_Allreduce(MPI_IN_PLACE, &elapsed, 1, MPI_DOUBLE, MPI_MAX, comm); CHKERRMPI(ierr);
+    
+    // ru_maxrss в Linux - в килобайтах
+    getrusage(RUSAGE_SELF, &usage);
+    rss[0] = (PetscLogDouble)usage.ru_maxrss * 1024.0;
+    rss[1] = -rss[0];
+    ierr = MPI_Allreduce(MPI_IN_PLACE, rss, 2, MPI_DOUBLE, MPI_MAX, comm); CHKERRMPI(ierr);
+    
+    last_load_stats.bytes = (stat(filename, &st) == 0) ? (PetscLogDouble)st.st_size : 0.0;
+    last_load_stats.time = elapsed;
+    last_load_stats.throughput = elapsed > 0.0 ? last_load_stats.bytes / elapsed / 1e9 : 0.0;
+    last_load_stats.peak_rss_max = rss[0];
+    last_load_stats.peak_rss_min = -rss[1];
+    return 0;
+}
+
+static PetscErrorCode read_matrix_market(MPI_Comm comm, const char *filename, Mat *A) {
+    PetscErrorCode ierr;
+    MMHeader h;
+    MMEntries e = {0, 0, NULL, NULL, NULL};
+    char *buf;
+    size_t first, stop;
+    PetscInt nlocal, rstart, *rowptr, *cols, *next, i, k, d;
+    PetscScalar *vals;
+    
+    ierr = mm_read_header(filename, &h); CHKERRQ(ierr);
+    if (!h.coordinate) SETERRQ(comm, PETSC_ERR_SUP, "Dense MatrixMarket matrices are not supported: %s", filename);
+    if (h.M != h.N) SETERRQ(comm, PETSC_ERR_SUP, "Matrix in %s is not square", filename);
+    
+    ierr = mm_read_chunk(comm, filename, h.data_offset, &buf, &first, &stop); CHKERRQ(ierr);
+    ierr = mm_parse_chunk(&h, buf, first, stop, 0, &e); CHKERRQ(ierr);
+    ierr = PetscFree(buf); CHKERRQ(ierr);
+    ierr = mm_route(comm, h.M, &nlocal, &rstart, &e); CHKERRQ(ierr);
+    
+    // Локальный CSR: сортировка подсчётом по строкам, затем по столбцам внутри строки
+    ierr = PetscCalloc1(nlocal + 1, &rowptr); CHKERRQ(ierr);
+    for (k = 0; k < e.count; k++) rowptr[e.rows[k] - rstart + 1]++;
+    for (i = 0; i < nlocal; i++) rowptr[i + 1] += rowptr[i];
+    ierr = PetscMalloc3(e.count, &cols, e.count, &vals, nlocal, &next); CHKERRQ(ierr);
+    for (i = 0; i < nlocal; i++) next[i] = rowptr[i];
+    for (k = 0; k < e.count; k++) {
+        d = next[e.rows[k] - rstart]++;
+        cols[d] = e.cols[k];
+        vals[d] = e.vals[k];
+    }
+    ierr = entries_destroy(&e); CHKERRQ(ierr);
+    
+    // Повторяющиеся элементы складываются, строки уплотняются на месте
+    d = 0;
+    for (i = 0; i < nlocal; i++) {
+        PetscInt row_start = d;
+        ierr = PetscSortIntWithScalarArray(rowptr[i + 1] - rowptr[i], cols + rowptr[i], vals + rowptr[i]); CHKERRQ(ierr);
+        for (k = rowptr[i]; k < rowptr[i + 1]; k++) {
+            if (d > row_start && cols[d - 1] == cols[k]) {
+                vals[d - 1] += vals[k];
+            } else {
+                cols[d] = cols[k];
+                vals[d] = vals[k];
+                d++;
+            }
+        }
+        rowptr[i] = row_start;
+    }
+    rowptr[nlocal] = d;
+    
+    ierr = create_matrix_from_csr(comm, nlocal, h.M, rowptr, cols, vals, A); CHKERRQ(ierr);
+    
+    ierr = PetscFree(rowptr); CHKERRQ(ierr);
+    ierr = PetscFree3(cols, vals, next); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode read_vector_market(MPI_Comm comm, const char *filename, Vec *b) {
+    PetscErrorCode ierr;
+    MMHeader h;
+    MMEntries e = {0, 0, NULL, NULL, NULL};
+    char *buf;
+    size_t first, stop;
+    PetscInt64 nlines, offset = 0;
+    PetscInt nlocal, rstart, k;
+    PetscMPIInt rank;
+    PetscScalar *array;
+    
+    ierr = mm_read_header(filename, &h); CHKERRQ(ierr);
+    if (h.N != 1) SETERRQ(comm, PETSC_ERR_FILE_UNEXPECTED, "Vector file %s must have a single column", filename);
+    
+    ierr = mm_read_chunk(comm, filename, h.data_offset, &buf, &first, &stop); CHKERRQ(ierr);
+    if (!h.coordinate) {
+        // Номер первого значения - число строк данных у процессов с меньшим рангом
+        nlines = mm_count_lines(buf, first, stop);
+        ierr = MPI_Exscan(&nlines, &offset, 1, MPIU_INT64, MPI_SUM, comm); CHKERRMPI(ierr);
+        ierr = MPI_Comm_rank(comm, &rank); CHKERRMPI(ierr);
+        if (rank == 0) offset = 0;
+    }
+    ierr = mm_parse_chunk(&h, buf, first, stop, offset, &e); CHKERRQ(ierr);
+    ierr = PetscFree(buf); CHKERRQ(ierr);
+    ierr = mm_route(comm, h.M, &nlocal, &rstart, &e); CHKERRQ(ierr);
+    
+    ierr = VecCreateMPI(comm, nlocal, h.M, b); CHKERRQ(ierr);
+    ierr = VecSet(*b, 0.0); CHKERRQ(ierr);
+    ierr = VecGetArray(*b, &array); CHKERRQ(ierr);
+    for (k = 0; k < e.count; k++) array[e.rows[k] - rstart] += e.vals[k];
+    ierr = VecRestoreArray(*b, &array); CHKERRQ(ierr);
+    ierr = entries_destroy(&e); CHKERRQ(ierr);
+    return 0;
+}
+
+// Бинарный формат PETSc: MatLoad/VecLoad через MPI-IO, каждый процесс читает
+// свои строки, AIJ-матрица предаллоцируется по длинам строк из файла
+static PetscErrorCode open_binary_viewer(MPI_Comm comm, const char *filename, PetscFileMode mode, PetscViewer *viewer) {
+    PetscErrorCode ierr;
+    ierr = PetscViewerCreate(comm, viewer); CHKERRQ(ierr);
+    ierr = PetscViewerSetType(*viewer, PETSCVIEWERBINARY); CHKERRQ(ierr);
+    ierr = PetscViewerFileSetMode(*viewer, mode); CHKERRQ(ierr);
+    ierr = PetscViewerBinarySetUseMPIIO(*viewer, PETSC_TRUE); CHKERRQ(ierr);
+    ierr = PetscViewerFileSetName(*viewer, filename); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode read_matrix_from_file(const char *filename, Mat *A) {
+    PetscErrorCode ierr;
+    PetscViewer viewer;
+    PetscBool mm;
+    PetscLogDouble start_time;
+    
+    ierr = PetscTime(&start_time); CHKERRQ(ierr);
+    ierr = is_matrix_market(filename, &mm); CHKERRQ(ierr);
+    if (mm) {
+        ierr = read_matrix_market(PETSC_COMM_WORLD, filename, A); CHKERRQ(ierr);
+    } else {
+        ierr = open_binary_viewer(PETSC_COMM_WORLD, filename, FILE_MODE_READ, &viewer); CHKERRQ(ierr);
+        ierr = MatCreate(PETSC_COMM_WORLD, A); CHKERRQ(ierr);
+        ierr = MatSetFromOptions(*A); CHKERRQ(ierr);
+        ierr = MatLoad(*A, viewer); CHKERRQ(ierr);
+        ierr = PetscViewerDestroy(&viewer); CHKERRQ(ierr);
+    }
+    ierr = load_stats_finish(PETSC_COMM_WORLD, filename, start_time); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode read_vector_from_file(const char *filename, Vec *b) {
+    PetscErrorCode ierr;
+    PetscViewer viewer;
+    PetscBool mm;
+    PetscLogDouble start_time;
+    
+    ierr = PetscTime(&start_time); CHKERRQ(ierr);
+    ierr = is_matrix_market(filename, &mm); CHKERRQ(ierr);
+    if (mm) {
+        ierr = read_vector_market(PETSC_COMM_WORLD, filename, b); CHKERRQ(ierr);
+    } else {
+        ierr = open_binary_viewer(PETSC_COMM_WORLD, filename, FILE_MODE_READ, &viewer); CHKERRQ(ierr);
+        ierr = VecCreate(PETSC_COMM_WORLD, b); CHKERRQ(ierr);
+        ierr = VecLoad(*b, viewer); CHKERRQ(ierr);
+        ierr = PetscViewerDestroy(&viewer); CHKERRQ(ierr);
+    }
+    ierr = load_stats_finish(PETSC_COMM_WORLD, filename, start_time); CHKERRQ(ierr);
+    return 0;
+}
+
+// Запись в MatrixMarket идёт по процессам в порядке рангов; для больших
+// матриц предпочтителен бинарный формат
+PetscErrorCode write_matrix_to_file(const char *filename, Mat A) {
+    PetscErrorCode ierr;
+    PetscViewer viewer;
+    PetscBool mm;
+    
+    ierr = is_matrix_market(filename, &mm); CHKERRQ(ierr);
+    if (mm) {
+        FILE *fd;
+        MatInfo info;
+        PetscInt M, N, row, rstart, rend, ncols, k;
+        const PetscInt *cols;
+        const PetscScalar *vals;
+    
+        ierr = MatGetSize(A, &M, &N); CHKERRQ(ierr);
+        ierr = MatGetOwnershipRange(A, &rstart, &rend); CHKERRQ(ierr);
+        ierr = MatGetInfo(A, MAT_GLOBAL_SUM, &info); CHKERRQ(ierr);
+        ierr = PetscFOpen(PETSC_COMM_WORLD, filename, "w", &fd); CHKERRQ(ierr);
+        ierr = PetscFPrintf(PETSC_COMM_WORLD, fd, "%%%%MatrixMarket matrix coordinate real general\n"); CHKERRQ(ierr);
+        ierr = PetscFPrintf(PETSC_COMM_WORLD, fd, "%" PetscInt_FMT " %" PetscInt_FMT " %.0f\n", M, N, info.nz_used); CHKERRQ(ierr);
+        for (row = rstart; row < rend; row++) {
+            ierr = MatGetRow(A, row, &ncols, &cols, &vals); CHKERRQ(ierr);
+            for (k = 0; k < ncols; k++) {
+                ierr = PetscSynchronizedFPrintf(PETSC_COMM_WORLD, fd, "%" PetscInt_FMT " %" PetscInt_FMT " %.17g\n",
+                                                row + 1, cols[k] + 1, (double)PetscRealPart(vals[k])); CHKERRQ(ierr);
+            }
+            ierr = MatRestoreRow(A, row, &ncols, &cols, &vals); CHKERRQ(ierr);
+        }
+        ierr = PetscSynchronizedFlush(PETSC_COMM_WORLD, fd); CHKERRQ(ierr);
+        ierr = PetscFClose(PETSC_COMM_WORLD, fd); CHKERRQ(ierr);
+    } else {
+        ierr = open_binary_viewer(PETSC_COMM_WORLD, filename, FILE_MODE_WRITE, &viewer); CHKERRQ(ierr);
+        ierr = MatView(A, viewer); CHKERRQ(ierr);
+        ierr = PetscViewerDestroy(&viewer); CHKERRQ(ierr);
+    }
+    return 0;
+}
+
+PetscErrorCode write_vector_to_file(const char *filename, Vec b) {
+    PetscErrorCode ierr;
+    PetscViewer viewer;
+    PetscBool mm;
+    
+    ierr = is_matrix_market(filename, &mm); CHKERRQ(ierr);
+    if (mm) {
+        FILE *fd;
+        PetscInt M, nlocal, k;
+        const PetscScalar *array;
+    
+        ierr = VecGetSize(b, &M); CHKERRQ(ierr);
+        ierr = VecGetLocalSize(b, &nlocal); CHKERRQ(ierr);
+        ierr = PetscFOpen(PETSC_COMM_WORLD, filename, "w", &fd); CHKERRQ(ierr);
+        ierr = PetscFPrintf(PETSC_COMM_WORLD, fd, "%%%%MatrixMarket matrix array real general\n"); CHKERRQ(ierr);
+        ierr = PetscFPrintf(PETSC_COMM_WORLD, fd, "%" PetscInt_FMT " 1\n", M); CHKERRQ(ierr);
+        ierr = VecGetArrayRead(b, &array); CHKERRQ(ierr);
+        for (k = 0; k < nlocal; k++) {
+            ierr = PetscSynchronizedFPrintf(PETSC_COMM_WORLD, fd, "%.17g\n", (double)PetscRealPart(array[k])); CHKERRQ(ierr);
+        }
+        ierr = VecRestoreArrayRead(b, &array); CHKERRQ(ierr);
+        ierr = PetscSynchronizedFlush(PETSC_COMM_WORLD, fd); CHKERRQ(ierr);
+        ierr = PetscFClose(PETSC_COMM_WORLD, fd); CHKERRQ(ierr);
+    } else {
+        ierr = open_binary_viewer(PETSC_COMM_WORLD, filename, FILE_MODE_WRITE, &viewer); CHKERRQ(ierr);
+        ierr = VecView(b, viewer); CHKERRQ(ierr);
+        ierr = PetscViewerDestroy(&viewer); CHKERRQ(ierr);
+    }
+    return 0;
+}
+
+PetscErrorCode get_last_load_stats(MatrixLoadStats *stats) {
+    *stats = last_load_stats;
+    return 0;
+}
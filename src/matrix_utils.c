@@ -1,117 +1,636 @@
 #include "matrix_utils.h"
+#include "solver_log.h"
+#include "threading.h"
 #include <petscmat.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
 
-PetscErrorCode create_laplace_matrix(PetscInt n, Mat *A) {
+// Время последней сборки матрицы (генерация строк + вставка + MatAssembly)
+static PetscLogDouble last_assembly_time = 0.0;
+
+PetscErrorCode create_matrix_from_csr(MPI_Comm comm, PetscInt nlocal, PetscInt n, const PetscInt rowptr[], const PetscInt cols[], const PetscScalar vals[], Mat *A) {
     PetscErrorCode ierr;
-    PetscInt i, Istart, Iend;
-    PetscScalar v[3];
-    PetscInt col[3];
+    PetscInt i, k, row, rstart, rend;
+    PetscBool legacy = PETSC_FALSE, is_aij;
+    PetscLogDouble start_time, end_time;
+    
+    ierr = solver_log_assembly_begin(); CHKERRQ(ierr);
+    ierr = PetscTime(&start_time); CHKERRQ(ierr);
+    ierr = PetscOptionsGetBool(NULL, NULL, "-assembly_legacy", &legacy, NULL); CHKERRQ(ierr);
     
-    ierr = MatCreate(PETSC_COMM_WORLD, A); CHKERRQ(ierr);
-    ierr = MatSetSizes(*A, PETSC_DECIDE, PETSC_DECIDE, n, n); CHKERRQ(ierr);
+    ierr = MPI_Scan(&nlocal, &rend, 1, MPIU_INT, MPI_SUM, comm); CHKERRMPI(ierr);
+    rstart = rend - nlocal;
+    
+    ierr = MatCreate(comm, A); CHKERRQ(ierr);
+    ierr = MatSetSizes(*A, nlocal, nlocal, n, n); CHKERRQ(ierr);
     ierr = MatSetFromOptions(*A); CHKERRQ(ierr);
-    ierr = MatSetUp(*A); CHKERRQ(ierr);
-    
-    ierr = MatGetOwnershipRange(*A, &Istart, &Iend); CHKERRQ(ierr);
-    
-    for (i = Istart; i < Iend; i++) {
-        if (i == 0) {
-            v[0] = 2.0; col[0] = 0;
-            v[1] = -1.0; col[1] = 1;
-            ierr = MatSetValues(*A, 1, &i, 2, col, v, INSERT_VALUES); CHKERRQ(ierr);
-        } else if (i == n-1) {
-            v[0] = -1.0; col[0] = n-2;
-            v[1] = 2.0; col[1] = n-1;
-            ierr = MatSetValues(*A, 1, &i, 2, col, v, INSERT_VALUES); CHKERRQ(ierr);
+    
+    if (legacy) {
+        // Прежний путь для сравнения: без предаллокации, по одной строке
+        ierr = MatSetUp(*A); CHKERRQ(ierr);
+        for (i = 0; i < nlocal; i++) {
+            row = rstart + i;
+            ierr = MatSetValues(*A, 1, &row, rowptr[i+1] - rowptr[i], cols + rowptr[i], vals + rowptr[i], INSERT_VALUES); CHKERRQ(ierr);
+        }
+    } else {
+        ierr = PetscObjectTypeCompareAny((PetscObject)*A, &is_aij, MATSEQAIJ, MATMPIAIJ, ""); CHKERRQ(ierr);
+        if (is_aij) {
+            // Точные счётчики diag/off-diag и передача всех строк одним вызовом
+            ierr = MatSeqAIJSetPreallocationCSR(*A, rowptr, cols, vals); CHKERRQ(ierr);
+            ierr = MatMPIAIJSetPreallocationCSR(*A, rowptr, cols, vals); CHKERRQ(ierr);
         } else {
-            v[0] = -1.0; col[0] = i-1;
-            v[1] = 2.0; col[1] = i;
-            v[2] = -1.0; col[2] = i+1;
-            ierr = MatSetValues(*A, 1, &i, 3, col, v, INSERT_VALUES); CHKERRQ(ierr);
+            // Другие форматы (-mat_type): точная предаллокация, затем вставка по строкам
+            PetscInt *d_nnz, *o_nnz;
+            ierr = PetscMalloc2(nlocal, &d_nnz, nlocal, &o_nnz); CHKERRQ(ierr);
+            for (i = 0; i < nlocal; i++) {
+                d_nnz[i] = 0;
+                o_nnz[i] = 0;
+                for (k = rowptr[i]; k < rowptr[i+1]; k++) {
+                    if (cols[k] >= rstart && cols[k] < rend) d_nnz[i]++;
+                    else o_nnz[i]++;
+                }
+            }
+            ierr = MatXAIJSetPreallocation(*A, 1, d_nnz, o_nnz, NULL, NULL); CHKERRQ(ierr);
+            ierr = PetscFree2(d_nnz, o_nnz); CHKERRQ(ierr);
+            for (i = 0; i < nlocal; i++) {
+                row = rstart + i;
+                ierr = MatSetValues(*A, 1, &row, rowptr[i+1] - rowptr[i], cols + rowptr[i], vals + rowptr[i], INSERT_VALUES); CHKERRQ(ierr);
+            }
         }
     }
     
     ierr = MatAssemblyBegin(*A, MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
     ierr = MatAssemblyEnd(*A, MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
     
+    ierr = PetscTime(&end_time); CHKERRQ(ierr);
+    last_assembly_time = end_time - start_time;
+    ierr = solver_log_assembly_end(); CHKERRQ(ierr);
+    
+    return 0;
+}
+
+PetscErrorCode row_chunk_generate(RowChunk *chunk, PetscInt rstart, PetscInt max_row_nnz, MatRowFunction row_fn, void *ctx) {
+    PetscErrorCode ierr;
+    PetscInt i, ncols, nrows = chunk->hi - chunk->lo;
+    
+    chunk->capacity = PetscMax(nrows * PetscMin(max_row_nnz, 16), max_row_nnz);
+    chunk->rowptr = (PetscInt *)malloc(sizeof(PetscInt) * (nrows + 1));
+    chunk->cols = (PetscInt *)malloc(sizeof(PetscInt) * chunk->capacity);
+    chunk->vals = (PetscScalar *)malloc(sizeof(PetscScalar) * chunk->capacity);
+    if (!chunk->rowptr || !chunk->cols || !chunk->vals) return PETSC_ERR_MEM;
+    
+    chunk->rowptr[0] = 0;
+    for (i = 0; i < nrows; i++) {
+        if (chunk->rowptr[i] + max_row_nnz > chunk->capacity) {
+            PetscInt *cols;
+            PetscScalar *vals;
+            chunk->capacity = PetscMax(2 * chunk->capacity, chunk->rowptr[i] + max_row_nnz);
+            cols = (PetscInt *)realloc(chunk->cols, sizeof(PetscInt) * chunk->capacity);
+            if (cols) chunk->cols = cols;
+            vals = (PetscScalar *)realloc(chunk->vals, sizeof(PetscScalar) * chunk->capacity);
+            if (vals) chunk->vals = vals;
+            if (!cols || !vals) return PETSC_ERR_MEM;
+        }
+        ierr = row_fn(rstart + chunk->lo + i, &ncols, chunk->cols + chunk->rowptr[i], chunk->vals + chunk->rowptr[i], ctx);
+        if (ierr) return ierr;
+        chunk->rowptr[i+1] = chunk->rowptr[i] + ncols;
+    }
+    return 0;
+}
+
+void row_chunk_free(RowChunk *chunk) {
+    free(chunk->rowptr);
+    free(chunk->cols);
+    free(chunk->vals);
+    chunk->rowptr = NULL;
+    chunk->cols = NULL;
+    chunk->vals = NULL;
+}
+
+// Многопоточная генерация: потоки строят свои участки независимо, затем каждый
+// копирует участок в общие CSR-массивы по смещению из префиксной суммы.
+// При ошибке все массивы, включая выходные, освобождаются
+static PetscErrorCode rows_generate_threaded(PetscInt nlocal, PetscInt rstart, PetscInt nthreads, PetscInt max_row_nnz, MatRowFunction row_fn, void *ctx,
+                                             PetscInt **rowptr, PetscInt **cols, PetscScalar **vals) {
+    PetscErrorCode ierr;
+    RowChunk *chunks = NULL;
+    PetscInt *offsets = NULL, t;
+    
+    *rowptr = NULL;
+    *cols = NULL;
+    *vals = NULL;
+    ierr = PetscCalloc1(nthreads, &chunks); if (ierr) goto cleanup;
+    ierr = PetscMalloc1(nthreads + 1, &offsets); if (ierr) goto cleanup;
+    
+    SOLVER_OMP(parallel for schedule(static, 1) num_threads(nthreads))
+    for (t = 0; t < nthreads; t++) {
+        solver_thread_range(nlocal, t, nthreads, &chunks[t].lo, &chunks[t].hi);
+        chunks[t].ierr = row_chunk_generate(&chunks[t], rstart, max_row_nnz, row_fn, ctx);
+    }
+    
+    offsets[0] = 0;
+    for (t = 0; t < nthreads; t++) {
+        ierr = chunks[t].ierr; if (ierr) goto cleanup;
+        offsets[t+1] = offsets[t] + chunks[t].rowptr[chunks[t].hi - chunks[t].lo];
+    }
+    
+    ierr = PetscMalloc1(nlocal + 1, rowptr); if (ierr) goto cleanup;
+    ierr = PetscMalloc1(PetscMax(offsets[nthreads], 1), cols); if (ierr) goto cleanup;
+    ierr = PetscMalloc1(PetscMax(offsets[nthreads], 1), vals); if (ierr) goto cleanup;
+    
+    // Итоговые массивы первым трогает поток, который дальше работает с этими строками
+    SOLVER_OMP(parallel for schedule(static, 1) num_threads(nthreads))
+    for (t = 0; t < nthreads; t++) {
+        const RowChunk *c = &chunks[t];
+        PetscInt i, nnz = c->rowptr[c->hi - c->lo];
+        for (i = c->lo; i < c->hi; i++) (*rowptr)[i] = offsets[t] + c->rowptr[i - c->lo];
+        memcpy(*cols + offsets[t], c->cols, sizeof(PetscInt) * nnz);
+        memcpy(*vals + offsets[t], c->vals, sizeof(PetscScalar) * nnz);
+    }
+    (*rowptr)[nlocal] = offsets[nthreads];
+    
+cleanup:
+    if (chunks) {
+        for (t = 0; t < nthreads; t++) row_chunk_free(&chunks[t]);
+    }
+    (void)PetscFree(chunks);
+    (void)PetscFree(offsets);
+    if (ierr) {
+        (void)PetscFree(*rowptr);
+        (void)PetscFree(*cols);
+        (void)PetscFree(*vals);
+    }
+    CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode create_matrix_from_rows(MPI_Comm comm, PetscInt n, PetscInt max_row_nnz, MatRowFunction row_fn, void *ctx, Mat *A) {
+    PetscErrorCode ierr;
+    PetscInt i, ncols, nlocal = PETSC_DECIDE, rstart, rend, capacity, nthreads;
+    PetscInt *rowptr = NULL, *cols = NULL;
+    PetscScalar *vals = NULL;
+    PetscLogDouble start_time, end_time;
+    
+    ierr = PetscTime(&start_time); CHKERRQ(ierr);
+    
+    // То же разбиение строк, что и PETSC_DECIDE в MatSetSizes
+    ierr = PetscSplitOwnership(comm, &nlocal, &n); CHKERRQ(ierr);
+    ierr = MPI_Scan(&nlocal, &rend, 1, MPIU_INT, MPI_SUM, comm); CHKERRMPI(ierr);
+    rstart = rend - nlocal;
+    
+    // Дальше ошибки идут через cleanup: CSR-массивы освобождаются на любом пути
+    // row_fn вызывается из нескольких потоков и не должна менять общее состояние
+    // (для контекста с рабочими буферами - буфер на поток по solver_thread_id)
+    nthreads = PetscMin(solver_threads_count(), PetscMax(nlocal, 1));
+    if (nthreads > 1) {
+        ierr = rows_generate_threaded(nlocal, rstart, nthreads, max_row_nnz, row_fn, ctx, &rowptr, &cols, &vals); if (ierr) goto cleanup;
+    } else {
+        // Для коротких строк ёмкость точная, для длинных массивы растут удвоением
+        capacity = PetscMax(nlocal * PetscMin(max_row_nnz, 16), max_row_nnz);
+        ierr = PetscMalloc1(nlocal + 1, &rowptr); if (ierr) goto cleanup;
+        ierr = PetscMalloc1(capacity, &cols); if (ierr) goto cleanup;
+        ierr = PetscMalloc1(capacity, &vals); if (ierr) goto cleanup;
+    
+        rowptr[0] = 0;
+        for (i = 0; i < nlocal; i++) {
+            if (rowptr[i] + max_row_nnz > capacity) {
+                capacity = PetscMax(2 * capacity, rowptr[i] + max_row_nnz);
+                ierr = PetscRealloc(sizeof(PetscInt) * capacity, &cols); if (ierr) goto cleanup;
+                ierr = PetscRealloc(sizeof(PetscScalar) * capacity, &vals); if (ierr) goto cleanup;
+            }
+            // Строка пишется сразу на своё место в CSR-массивах
+            ierr = row_fn(rstart + i, &ncols, cols + rowptr[i], vals + rowptr[i], ctx); if (ierr) goto cleanup;
+            rowptr[i+1] = rowptr[i] + ncols;
+        }
+    }
+    
+    ierr = create_matrix_from_csr(comm, nlocal, n, rowptr, cols, vals, A);
+    
+cleanup:
+    (void)PetscFree(rowptr);
+    (void)PetscFree(cols);
+    (void)PetscFree(vals);
+    CHKERRQ(ierr);
+    
+    ierr = PetscTime(&end_time); CHKERRQ(ierr);
+    last_assembly_time = end_time - start_time;
+    
+    return 0;
+}
+
+PetscErrorCode get_last_assembly_time(PetscLogDouble *time) {
+    *time = last_assembly_time;
+    return 0;
+}
+
+static PetscErrorCode laplace_row(PetscInt i, PetscInt *ncols, PetscInt cols[], PetscScalar vals[], void *ctx) {
+    PetscInt n = *(PetscInt *)ctx;
+    PetscInt count = 0;
+    
+    if (i > 0) {
+        cols[count] = i - 1; vals[count] = -1.0; count++;
+    }
+    cols[count] = i; vals[count] = 2.0; count++;
+    if (i < n - 1) {
+        cols[count] = i + 1; vals[count] = -1.0; count++;
+    }
+    
+    *ncols = count;
+    return 0;
+}
+
+PetscErrorCode create_laplace_matrix(PetscInt n, Mat *A) {
+    PetscErrorCode ierr;
+    ierr = create_laplace_matrix_comm(PETSC_COMM_WORLD, n, A); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode create_laplace_matrix_comm(MPI_Comm comm, PetscInt n, Mat *A) {
+    PetscErrorCode ierr;
+    ierr = create_matrix_from_rows(comm, n, 3, laplace_row, &n, A); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode diagonal_row(PetscInt i, PetscInt *ncols, PetscInt cols[], PetscScalar vals[], void *ctx) {
+    cols[0] = i;
+    vals[0] = *(PetscScalar *)ctx;
+    *ncols = 1;
     return 0;
 }
 
 PetscErrorCode create_diagonal_dominant_matrix(PetscInt n, PetscReal diagonal_value, Mat *A) {
     PetscErrorCode ierr;
-    PetscInt i, Istart, Iend;
+    PetscScalar value = diagonal_value;
+    ierr = create_matrix_from_rows(PETSC_COMM_WORLD, n, 1, diagonal_row, &value, A); CHKERRQ(ierr);
+    return 0;
+}
+
+typedef struct {
+    PetscInt nx, ny;
+} Poisson2DContext;
+
+static PetscErrorCode poisson2d_row(PetscInt i, PetscInt *ncols, PetscInt cols[], PetscScalar vals[], void *ctx) {
+    Poisson2DContext *grid = (Poisson2DContext *)ctx;
+    PetscInt nx = grid->nx, ny = grid->ny;
+    PetscInt ix = i % nx;
+    PetscInt iy = i / nx;
+    PetscInt count = 0;
     
-    ierr = MatCreate(PETSC_COMM_WORLD, A); CHKERRQ(ierr);
-    ierr = MatSetSizes(*A, PETSC_DECIDE, PETSC_DECIDE, n, n); CHKERRQ(ierr);
-    ierr = MatSetFromOptions(*A); CHKERRQ(ierr);
-    ierr = MatSetUp(*A); CHKERRQ(ierr);
+    // Столбцы по возрастанию: bottom, left, center, right, top
+    if (iy > 0) {
+        cols[count] = i - nx; vals[count] = -1.0; count++;
+    }
+    if (ix > 0) {
+        cols[count] = i - 1; vals[count] = -1.0; count++;
+    }
+    cols[count] = i; vals[count] = 4.0; count++;
+    if (ix < nx - 1) {
+        cols[count] = i + 1; vals[count] = -1.0; count++;
+    }
+    if (iy < ny - 1) {
+        cols[count] = i + nx; vals[count] = -1.0; count++;
+    }
     
-    ierr = MatGetOwnershipRange(*A, &Istart, &Iend); CHKERRQ(ierr);
+    *ncols = count;
+    return 0;
+}
+
+PetscErrorCode create_poisson2d_matrix(PetscInt nx, PetscInt ny, Mat *A) {
+    PetscErrorCode ierr;
+    ierr = create_poisson2d_matrix_comm(PETSC_COMM_WORLD, nx, ny, A); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode create_poisson2d_matrix_comm(MPI_Comm comm, PetscInt nx, PetscInt ny, Mat *A) {
+    PetscErrorCode ierr;
+    Poisson2DContext grid;
+    
+    grid.nx = nx;
+    grid.ny = ny;
+    ierr = create_matrix_from_rows(comm, nx * ny, 5, poisson2d_row, &grid, A); CHKERRQ(ierr);
+    
+    return 0;
+}
+
+PetscErrorCode create_poisson_grid(PetscInt dim, PetscInt nx, PetscInt ny, PetscInt nz, DM *da) {
+    PetscErrorCode ierr;
+    
+    // Разбиение по процессам в 2D/3D выбирает DMDA; звёздный шаблон ширины 1
+    if (dim == 2) {
+        ierr = DMDACreate2d(PETSC_COMM_WORLD, DM_BOUNDARY_NONE, DM_BOUNDARY_NONE, DMDA_STENCIL_STAR,
+                            nx, ny, PETSC_DECIDE, PETSC_DECIDE, 1, 1, NULL, NULL, da); CHKERRQ(ierr);
+    } else if (dim == 3) {
+        ierr = DMDACreate3d(PETSC_COMM_WORLD, DM_BOUNDARY_NONE, DM_BOUNDARY_NONE, DM_BOUNDARY_NONE, DMDA_STENCIL_STAR,
+                            nx, ny, nz, PETSC_DECIDE, PETSC_DECIDE, PETSC_DECIDE, 1, 1, NULL, NULL, NULL, da); CHKERRQ(ierr);
+    } else {
+        SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Structured grid dimension must be 2 or 3");
+    }
+    ierr = DMSetFromOptions(*da); CHKERRQ(ierr);
+    ierr = DMSetUp(*da); CHKERRQ(ierr);
+    
+    return 0;
+}
+
+PetscErrorCode create_poisson_grid_matrix(DM da, Mat *A) {
+    PetscErrorCode ierr;
+    DMDALocalInfo info;
+    MatStencil row, cols[7];
+    PetscScalar vals[7];
+    PetscInt i, j, k, count;
+    PetscLogDouble start_time, end_time;
+    
+    ierr = solver_log_assembly_begin(); CHKERRQ(ierr);
+    ierr = PetscTime(&start_time); CHKERRQ(ierr);
+    
+    // Предаллокация по шаблону сетки; матрица хранит ссылку на DM (MatGetDM)
+    ierr = DMCreateMatrix(da, A); CHKERRQ(ierr);
+    ierr = DMDAGetLocalInfo(da, &info); CHKERRQ(ierr);
     
-    for (i = Istart; i < Iend; i++) {
-        PetscScalar value = diagonal_value;
-        ierr = MatSetValue(*A, i, i, value, INSERT_VALUES); CHKERRQ(ierr);
+    // 5-точечный (2D) или 7-точечный (3D) шаблон, Дирихле на границе исключено;
+    // в 2D mz = 1, и соседи по k не появляются
+    for (k = info.zs; k < info.zs + info.zm; k++) {
+        for (j = info.ys; j < info.ys + info.ym; j++) {
+            for (i = info.xs; i < info.xs + info.xm; i++) {
+                row.i = i; row.j = j; row.k = k; row.c = 0;
+                count = 0;
+                if (k > 0) {
+                    cols[count].i = i; cols[count].j = j; cols[count].k = k - 1; vals[count] = -1.0; count++;
+                }
+                if (j > 0) {
+                    cols[count].i = i; cols[count].j = j - 1; cols[count].k = k; vals[count] = -1.0; count++;
+                }
+                if (i > 0) {
+                    cols[count].i = i - 1; cols[count].j = j; cols[count].k = k; vals[count] = -1.0; count++;
+                }
+                cols[count].i = i; cols[count].j = j; cols[count].k = k; vals[count] = 2.0 * info.dim; count++;
+                if (i < info.mx - 1) {
+                    cols[count].i = i + 1; cols[count].j = j; cols[count].k = k; vals[count] = -1.0; count++;
+                }
+                if (j < info.my - 1) {
+                    cols[count].i = i; cols[count].j = j + 1; cols[count].k = k; vals[count] = -1.0; count++;
+                }
+                if (k < info.mz - 1) {
+                    cols[count].i = i; cols[count].j = j; cols[count].k = k + 1; vals[count] = -1.0; count++;
+                }
+                ierr = MatSetValuesStencil(*A, 1, &row, count, cols, vals, INSERT_VALUES); CHKERRQ(ierr);
+            }
+        }
     }
     
     ierr = MatAssemblyBegin(*A, MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
     ierr = MatAssemblyEnd(*A, MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
     
+    ierr = PetscTime(&end_time); CHKERRQ(ierr);
+    last_assembly_time = end_time - start_time;
+    ierr = solver_log_assembly_end(); CHKERRQ(ierr);
+    
     return 0;
 }
 
-PetscErrorCode create_random_sparse_matrix(PetscInt n, PetscReal density, Mat *A) {
+PetscErrorCode create_grid_rhs_vector(DM da, Vec *b) {
     PetscErrorCode ierr;
-    PetscInt i, j, Istart, Iend;
-    PetscRandom rctx;
     
-    ierr = MatCreate(PETSC_COMM_WORLD, A); CHKERRQ(ierr);
-    ierr = MatSetSizes(*A, PETSC_DECIDE, PETSC_DECIDE, n, n); CHKERRQ(ierr);
-    ierr = MatSetFromOptions(*A); CHKERRQ(ierr);
-    ierr = MatSetUp(*A); CHKERRQ(ierr);
+    ierr = DMCreateGlobalVector(da, b); CHKERRQ(ierr);
+    ierr = VecSet(*b, 1.0); CHKERRQ(ierr);
     
-    ierr = PetscRandomCreate(PETSC_COMM_WORLD, &rctx); CHKERRQ(ierr);
-    ierr = PetscRandomSetFromOptions(rctx); CHKERRQ(ierr);
+    return 0;
+}
+
+// Счётчиковый генератор: значение зависит только от (seed, row, counter),
+// поэтому строка матрицы одинакова при любом числе MPI-процессов
+static inline uint64_t random_mix(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline PetscReal random_uniform(uint64_t seed, PetscInt row, uint64_t counter) {
+    uint64_t h = random_mix(seed ^ random_mix((uint64_t)row * 0x9E3779B97F4A7C15ULL + counter));
+    return (PetscReal)(h >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Номера потоков внутри строки: длина строки, выбор столбцов, значения
+#define RANDOM_STREAM_LENGTH  0ULL
+#define RANDOM_STREAM_COLUMNS (1ULL << 20)
+#define RANDOM_STREAM_VALUES  (1ULL << 40)
+
+typedef struct {
+    PetscInt n;
+    RandomMatrixOptions opts;
+    PetscInt max_offdiag;       // верхняя граница внедиагональных элементов строки
+    PetscInt hash_size;         // размер хеш-множества для алгоритма Флойда (степень двойки)
+    PetscInt *hash;             // по hash_size элементов на каждый поток
+} RandomRowContext;
+
+static PetscInt random_row_length(const RandomRowContext *rc, PetscInt i) {
+    PetscReal u = random_uniform(rc->opts.seed, i, RANDOM_STREAM_LENGTH);
+    PetscReal mean = rc->opts.mean_row_nnz, len;
     
-    ierr = MatGetOwnershipRange(*A, &Istart, &Iend); CHKERRQ(ierr);
+    switch (rc->opts.row_dist) {
+    case ROW_LENGTH_UNIFORM:
+        len = PetscFloorReal(u * (2.0 * mean + 1.0));
+        break;
+    case ROW_LENGTH_POWERLAW: {
+        // Парето с показателем alpha и тем же средним (xm * alpha / (alpha - 1) = mean):
+        // редкие очень длинные строки; округление не сдвигает среднее
+        PetscReal alpha = rc->opts.powerlaw_alpha;
+        PetscReal xm = mean * (alpha - 1.0) / alpha;
+        len = PetscFloorReal(xm * PetscPowReal(1.0 - u, -1.0 / alpha) + 0.5);
+        break;
+    }
+    default:
+        len = PetscFloorReal(mean + 0.5);
+        break;
+    }
+    return (PetscInt)PetscMin(len, (PetscReal)rc->max_offdiag);
+}
+
+// Вставка в хеш-множество; возвращает PETSC_FALSE, если значение уже было
+static inline PetscBool random_hash_insert(PetscInt *hash, PetscInt mask, PetscInt value) {
+    PetscInt h = (PetscInt)(random_mix((uint64_t)value) & (uint64_t)mask);
+    while (hash[h] >= 0) {
+        if (hash[h] == value) return PETSC_FALSE;
+        h = (h + 1) & mask;
+    }
+    hash[h] = value;
+    return PETSC_TRUE;
+}
+
+static inline void random_hash_clear(PetscInt *hash, PetscInt mask, PetscInt value) {
+    PetscInt h = (PetscInt)(random_mix((uint64_t)value) & (uint64_t)mask);
+    while (hash[h] != value) h = (h + 1) & mask;
+    hash[h] = -1;
+}
+
+static PetscErrorCode random_row(PetscInt i, PetscInt *ncols, PetscInt cols[], PetscScalar vals[], void *ctx) {
+    PetscErrorCode ierr;
+    RandomRowContext *rc = (RandomRowContext *)ctx;
+    const uint64_t seed = rc->opts.seed;
+    PetscInt bw = rc->opts.bandwidth > 0 ? rc->opts.bandwidth : rc->n;
+    PetscInt lo = PetscMax(0, i - bw), hi = PetscMin(rc->n - 1, i + bw);
+    PetscInt m = hi - lo;       // кандидаты в окне без диагонали
+    PetscInt k = PetscMin(random_row_length(rc, i), m);
+    PetscInt j, t, count = 0;
+    PetscInt *hash = rc->hash + solver_thread_id() * rc->hash_size;
+    PetscReal row_sum = 0.0;
     
-    for (i = Istart; i < Iend; i++) {
-        for (j = 0; j < n; j++) {
-            if ((PetscReal)rand() / RAND_MAX < density) {
-                PetscScalar value;
-                ierr = PetscRandomGetValue(rctx, &value); CHKERRQ(ierr);
-                ierr = MatSetValue(*A, i, j, value, INSERT_VALUES); CHKERRQ(ierr);
+    if (2 * k > m) {
+        // Плотная строка: последовательный отбор (Кнут, алгоритм S), O(m) = O(k)
+        for (t = 0; t < m && count < k; t++) {
+            if ((PetscReal)(m - t) * random_uniform(seed, i, RANDOM_STREAM_COLUMNS + t) < (PetscReal)(k - count)) {
+                cols[count++] = t;
+            }
+        }
+    } else {
+        // Разреженная строка: алгоритм Флойда, k различных смещений за O(k)
+        for (j = m - k; j < m; j++) {
+            t = (PetscInt)(random_uniform(seed, i, RANDOM_STREAM_COLUMNS + j) * (PetscReal)(j + 1));
+            if (t > j) t = j;
+            if (!random_hash_insert(hash, rc->hash_size - 1, t)) {
+                t = j;
+                random_hash_insert(hash, rc->hash_size - 1, t);
             }
+            cols[count++] = t;
         }
-        // Ensure diagonal dominance
-        PetscScalar diag_value;
-        ierr = PetscRandomGetValue(rctx, &diag_value); CHKERRQ(ierr);
-        ierr = MatSetValue(*A, i, i, diag_value + n, INSERT_VALUES); CHKERRQ(ierr);
+        for (j = 0; j < count; j++) random_hash_clear(hash, rc->hash_size - 1, cols[j]);
+        ierr = PetscSortInt(count, cols); CHKERRQ(ierr);
     }
     
-    ierr = MatAssemblyBegin(*A, MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
-    ierr = MatAssemblyEnd(*A, MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+    // Смещения в окне -> номера столбцов, диагональ вставляется на своё место
+    for (j = 0; j < count; j++) {
+        cols[j] += lo;
+        if (cols[j] >= i) cols[j]++;
+    }
+    for (j = count; j > 0 && cols[j-1] > i; j--) {
+        cols[j] = cols[j-1];
+    }
+    cols[j] = i;
+    count++;
+    
+    for (t = 0; t < count; t++) {
+        if (cols[t] == i) continue;
+        vals[t] = random_uniform(seed, i, RANDOM_STREAM_VALUES + t);
+        row_sum += PetscAbsScalar(vals[t]);
+    }
+    // Ensure diagonal dominance
+    vals[j] = row_sum + 1.0 + random_uniform(seed, i, RANDOM_STREAM_VALUES + count);
+    
+    *ncols = count;
+    return 0;
+}
+
+PetscErrorCode random_matrix_options_default(PetscInt n, PetscReal density, RandomMatrixOptions *opts) {
+    PetscErrorCode ierr;
+    PetscInt seed = 0, dist = ROW_LENGTH_FIXED;
+    const char *dist_names[] = {"fixed", "uniform", "powerlaw"};
+    
+    opts->mean_row_nnz = density * (n - 1);
+    opts->row_dist = ROW_LENGTH_FIXED;
+    opts->powerlaw_alpha = 2.5;
+    opts->bandwidth = 0;
+    
+    ierr = PetscOptionsGetInt(NULL, NULL, "-random_seed", &seed, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetReal(NULL, NULL, "-random_row_nnz", &opts->mean_row_nnz, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetEList(NULL, NULL, "-random_row_dist", dist_names, 3, &dist, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetReal(NULL, NULL, "-random_powerlaw_alpha", &opts->powerlaw_alpha, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetInt(NULL, NULL, "-random_bandwidth", &opts->bandwidth, NULL); CHKERRQ(ierr);
+    
+    opts->seed = (PetscInt64)seed;
+    opts->row_dist = (RowLengthDistribution)dist;
+    if (opts->row_dist == ROW_LENGTH_POWERLAW && opts->powerlaw_alpha <= 1.0) {
+        SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "-random_powerlaw_alpha must be greater than 1");
+    }
+    return 0;
+}
+
+PetscErrorCode create_random_sparse_matrix_ex(PetscInt n, const RandomMatrixOptions *opts, Mat *A) {
+    PetscErrorCode ierr;
+    ierr = create_random_sparse_matrix_comm(PETSC_COMM_WORLD, n, opts, A); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode create_random_sparse_matrix_comm(MPI_Comm comm, PetscInt n, const RandomMatrixOptions *opts, Mat *A) {
+    PetscErrorCode ierr;
+    RandomRowContext rc;
+    PetscInt i, window;
+    PetscReal cap;
+    
+    rc.n = n;
+    rc.opts = *opts;
+    
+    // Граница длины строки нужна для буфера строки в create_matrix_from_rows
+    window = (opts->bandwidth > 0) ? PetscMin(2 * opts->bandwidth, n - 1) : n - 1;
+    switch (opts->row_dist) {
+    case ROW_LENGTH_UNIFORM:  cap = 2.0 * opts->mean_row_nnz + 1.0; break;
+    case ROW_LENGTH_POWERLAW: cap = 100.0 * opts->mean_row_nnz + 1.0; break;
+    default:                  cap = opts->mean_row_nnz + 1.0; break;
+    }
+    rc.max_offdiag = (PetscInt)PetscMin((PetscReal)window, cap);
+    
+    // Множество занимает не более половины таблицы (k <= m/2 в ветке Флойда)
+    rc.hash_size = 16;
+    while (rc.hash_size < 2 * rc.max_offdiag) rc.hash_size *= 2;
+    ierr = PetscMalloc1(rc.hash_size * solver_threads_count(), &rc.hash); CHKERRQ(ierr);
+    for (i = 0; i < rc.hash_size * solver_threads_count(); i++) rc.hash[i] = -1;
     
-    ierr = PetscRandomDestroy(&rctx); CHKERRQ(ierr);
+    ierr = create_matrix_from_rows(comm, n, rc.max_offdiag + 1, random_row, &rc, A); CHKERRQ(ierr);
+    
+    ierr = PetscFree(rc.hash); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode create_random_sparse_matrix(PetscInt n, PetscReal density, Mat *A) {
+    PetscErrorCode ierr;
+    RandomMatrixOptions opts;
+    
+    ierr = random_matrix_options_default(n, density, &opts); CHKERRQ(ierr);
+    ierr = create_random_sparse_matrix_ex(n, &opts, A); CHKERRQ(ierr);
     return 0;
 }
 
 PetscErrorCode create_rhs_vector(PetscInt n, Vec *b) {
     PetscErrorCode ierr;
-    PetscInt i, Istart, Iend;
+    PetscInt i, nlocal;
+    PetscScalar *array;
     
     ierr = VecCreate(PETSC_COMM_WORLD, b); CHKERRQ(ierr);
     ierr = VecSetSizes(*b, PETSC_DECIDE, n); CHKERRQ(ierr);
     ierr = VecSetFromOptions(*b); CHKERRQ(ierr);
+    ierr = solver_threads_first_touch(*b); CHKERRQ(ierr);
+    
+    // Локальная часть заполняется напрямую, без VecSetValue и обмена при сборке
+    ierr = VecGetLocalSize(*b, &nlocal); CHKERRQ(ierr);
+    ierr = VecGetArray(*b, &array); CHKERRQ(ierr);
+    SOLVER_OMP(parallel for schedule(static))
+    for (i = 0; i < nlocal; i++) {
+        array[i] = 1.0; // Uniform right-hand side
+    }
+    ierr = VecRestoreArray(*b, &array); CHKERRQ(ierr);
+    
+    return 0;
+}
+
+PetscErrorCode create_rhs_block(PetscInt n, PetscInt nrhs, Mat *B) {
+    PetscErrorCode ierr;
+    PetscInt i, j, Istart, Iend, lda;
+    PetscScalar *array;
     
-    ierr = VecGetOwnershipRange(*b, &Istart, &Iend); CHKERRQ(ierr);
+    ierr = MatCreateDense(PETSC_COMM_WORLD, PETSC_DECIDE, PETSC_DECIDE, n, nrhs, NULL, B); CHKERRQ(ierr);
+    ierr = MatGetOwnershipRange(*B, &Istart, &Iend); CHKERRQ(ierr);
+    ierr = MatDenseGetLDA(*B, &lda); CHKERRQ(ierr);
+    ierr = MatDenseGetArrayWrite(*B, &array); CHKERRQ(ierr);
     
-    for (i = Istart; i < Iend; i++) {
-        PetscScalar value = 1.0; // Uniform right-hand side
-        ierr = VecSetValue(*b, i, value, INSERT_VALUES); CHKERRQ(ierr);
+    // Набор различных "нагрузок": столбец j - ступенчатая функция с периодом j + 2
+    for (j = 0; j < nrhs; j++) {
+        for (i = Istart; i < Iend; i++) {
+            array[j * lda + (i - Istart)] = 1.0 + (PetscReal)(i % (j + 2));
+        }
     }
     
-    ierr = VecAssemblyBegin(*b); CHKERRQ(ierr);
-    ierr = VecAssemblyEnd(*b); CHKERRQ(ierr);
+    ierr = MatDenseRestoreArrayWrite(*B, &array); CHKERRQ(ierr);
+    ierr = MatAssemblyBegin(*B, MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
+    ierr = MatAssemblyEnd(*B, MAT_FINAL_ASSEMBLY); CHKERRQ(ierr);
     
     return 0;
 }
@@ -2,13 +2,81 @@
 #define MATRIX_UTILS_H
 
 #include <petscksp.h>
+#include <petscdmda.h>
+
+// Генератор одной строки матрицы: записывает не более max_row_nnz элементов
+// строки row в cols/vals (столбцы по возрастанию) и их количество в ncols
+typedef PetscErrorCode (*MatRowFunction)(PetscInt row, PetscInt *ncols, PetscInt cols[], PetscScalar vals[], void *ctx);
+
+// Блочная сборка из локальных CSR-массивов с точной предаллокацией
+PetscErrorCode create_matrix_from_csr(MPI_Comm comm, PetscInt nlocal, PetscInt n, const PetscInt rowptr[], const PetscInt cols[], const PetscScalar vals[], Mat *A);
+PetscErrorCode create_matrix_from_rows(MPI_Comm comm, PetscInt n, PetscInt max_row_nnz, MatRowFunction row_fn, void *ctx, Mat *A);
+PetscErrorCode get_last_assembly_time(PetscLogDouble *time);
+
+// Участок локальных строк [lo, hi) в собственных CSR-массивах (malloc/realloc:
+// PetscMalloc с отладкой памяти не потокобезопасен). Генерация не вызывает PETSc,
+// поэтому может идти в рабочем потоке; rowptr отсчитывается от начала участка.
+typedef struct {
+    PetscInt lo, hi;
+    PetscInt *rowptr;           // hi - lo + 1 элементов
+    PetscInt *cols;
+    PetscScalar *vals;
+    PetscInt capacity;
+    PetscErrorCode ierr;
+} RowChunk;
+
+PetscErrorCode row_chunk_generate(RowChunk *chunk, PetscInt rstart, PetscInt max_row_nnz, MatRowFunction row_fn, void *ctx);
+void row_chunk_free(RowChunk *chunk);
+
+// Распределение длин строк случайной матрицы
+typedef enum {
+    ROW_LENGTH_FIXED,
+    ROW_LENGTH_UNIFORM,
+    ROW_LENGTH_POWERLAW
+} RowLengthDistribution;
+
+typedef struct {
+    PetscInt64 seed;                // одинаковый seed - одинаковая матрица при любом числе процессов
+    PetscReal mean_row_nnz;         // среднее число внедиагональных элементов в строке
+    RowLengthDistribution row_dist;
+    PetscReal powerlaw_alpha;       // показатель хвоста для ROW_LENGTH_POWERLAW (> 1)
+    PetscInt bandwidth;             // столбцы из [i - bandwidth, i + bandwidth]; 0 - без ограничения
+} RandomMatrixOptions;
 
 PetscErrorCode create_laplace_matrix(PetscInt n, Mat *A);
+PetscErrorCode create_poisson2d_matrix(PetscInt nx, PetscInt ny, Mat *A);
+// Пуассон на структурированной сетке DMDA (dim = 2 или 3, nz для 2D не используется):
+// разбиение по процессам и огрубление для PCMG берёт на себя DMDA
+PetscErrorCode create_poisson_grid(PetscInt dim, PetscInt nx, PetscInt ny, PetscInt nz, DM *da);
+PetscErrorCode create_poisson_grid_matrix(DM da, Mat *A);
+PetscErrorCode create_grid_rhs_vector(DM da, Vec *b);
 PetscErrorCode create_diagonal_dominant_matrix(PetscInt n, PetscReal diagonal_value, Mat *A);
 PetscErrorCode create_random_sparse_matrix(PetscInt n, PetscReal density, Mat *A);
+PetscErrorCode random_matrix_options_default(PetscInt n, PetscReal density, RandomMatrixOptions *opts);
+PetscErrorCode create_random_sparse_matrix_ex(PetscInt n, const RandomMatrixOptions *opts, Mat *A);
 PetscErrorCode create_rhs_vector(PetscInt n, Vec *b);
+// Те же генераторы на заданном коммуникаторе (группы ансамбля, ensemble.h); без суффикса - PETSC_COMM_WORLD
+PetscErrorCode create_laplace_matrix_comm(MPI_Comm comm, PetscInt n, Mat *A);
+PetscErrorCode create_poisson2d_matrix_comm(MPI_Comm comm, PetscInt nx, PetscInt ny, Mat *A);
+PetscErrorCode create_random_sparse_matrix_comm(MPI_Comm comm, PetscInt n, const RandomMatrixOptions *opts, Mat *A);
+PetscErrorCode create_rhs_block(PetscInt n, PetscInt nrhs, Mat *B);
+
+// Загрузка из файлов: *.mtx/*.mm - MatrixMarket, остальные - бинарный формат PETSc.
+// Каждый процесс читает только свой диапазон (MPI-IO), строки попадают
+// сразу в предаллоцированную матрицу.
+typedef struct {
+    PetscLogDouble bytes;           // размер файла
+    PetscLogDouble time;            // максимум по процессам
+    PetscLogDouble throughput;      // ГБ/с
+    PetscLogDouble peak_rss_max;    // пиковая память процесса (байты), максимум и минимум по процессам
+    PetscLogDouble peak_rss_min;
+} MatrixLoadStats;
+
 PetscErrorCode read_matrix_from_file(const char *filename, Mat *A);
+PetscErrorCode read_vector_from_file(const char *filename, Vec *b);
 PetscErrorCode write_matrix_to_file(const char *filename, Mat A);
+PetscErrorCode write_vector_to_file(const char *filename, Vec b);
+PetscErrorCode get_last_load_stats(MatrixLoadStats *stats);
 PetscErrorCode print_matrix_info(Mat A, const char *name);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,261 @@
+#include "solver.h"
+#include "threading.h"
+#include "workspace_pool.h"
+
+// Внутренний GMRES не уменьшает невязку хотя бы на 10% - достигнут предел одинарной точности
+#define SOLVER_MIXED_STAGNATION 0.9
+#define SOLVER_MIXED_MAX_OUTER 30
+
+// Копия AIJ-матрицы со значениями float: диагональный и внедиагональный блоки
+// в CSR, ghost-значения x собираются своим VecScatter
+typedef struct {
+    Mat A;                      // исходная матрица двойной точности
+    PetscInt nlocal, nghost;
+    PetscInt *di, *dj, *oi, *oj;
+    float *da, *oa;
+    Vec ghost;
+    VecScatter scatter;
+} SingleMatContext;
+
+static PetscErrorCode single_get_blocks(Mat A, Mat *Ad, Mat *Ao, const PetscInt **garray) {
+    PetscErrorCode ierr;
+    PetscBool is_mpi;
+    
+    ierr = PetscObjectBaseTypeCompare((PetscObject)A, MATMPIAIJ, &is_mpi); CHKERRQ(ierr);
+    if (is_mpi) {
+        ierr = MatMPIAIJGetSeqAIJ(A, Ad, Ao, garray); CHKERRQ(ierr);
+    } else {
+        *Ad = A;
+        *Ao = NULL;
+        *garray = NULL;
+    }
+    return 0;
+}
+
+// Копирование структуры блока: массивы MatGetRowIJ принадлежат матрице
+static PetscErrorCode single_copy_structure(Mat B, PetscInt nrows, PetscInt **ri, PetscInt **rj, float **ra) {
+    PetscErrorCode ierr;
+    const PetscInt *ia, *ja;
+    PetscInt n;
+    PetscBool done;
+    
+    ierr = MatGetRowIJ(B, 0, PETSC_FALSE, PETSC_FALSE, &n, &ia, &ja, &done); CHKERRQ(ierr);
+    if (!done) SETERRQ(PETSC_COMM_SELF, PETSC_ERR_SUP, "Cannot access CSR structure of the matrix block");
+    ierr = PetscMalloc3(nrows + 1, ri, ia[nrows], rj, ia[nrows], ra); CHKERRQ(ierr);
+    ierr = PetscArraycpy(*ri, ia, nrows + 1); CHKERRQ(ierr);
+    ierr = PetscArraycpy(*rj, ja, ia[nrows]); CHKERRQ(ierr);
+    ierr = MatRestoreRowIJ(B, 0, PETSC_FALSE, PETSC_FALSE, &n, &ia, &ja, &done); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode single_copy_values(Mat B, PetscInt nnz, float *ra) {
+    PetscErrorCode ierr;
+    const PetscScalar *aa;
+    PetscInt k;
+    
+    ierr = MatSeqAIJGetArrayRead(B, &aa); CHKERRQ(ierr);
+    SOLVER_OMP(parallel for schedule(static))
+    for (k = 0; k < nnz; k++) ra[k] = (float)PetscRealPart(aa[k]);
+    ierr = MatSeqAIJRestoreArrayRead(B, &aa); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode single_mult(Mat S, Vec xv, Vec yv) {
+    PetscErrorCode ierr;
+    SingleMatContext *ctx;
+    const PetscScalar *x, *g;
+    PetscScalar *y;
+    PetscInt i;
+    
+    ierr = MatShellGetContext(S, &ctx); CHKERRQ(ierr);
+    
+    if (ctx->scatter) {
+        ierr = VecScatterBegin(ctx->scatter, xv, ctx->ghost, INSERT_VALUES, SCATTER_FORWARD); CHKERRQ(ierr);
+    }
+    
+    // Значения матрицы читаются в float, накопление - в двойной точности
+    ierr = VecGetArrayRead(xv, &x); CHKERRQ(ierr);
+    ierr = VecGetArray(yv, &y); CHKERRQ(ierr);
+    SOLVER_OMP(parallel for schedule(static))
+    for (i = 0; i < ctx->nlocal; i++) {
+        PetscScalar sum = 0.0;
+        PetscInt k;
+        for (k = ctx->di[i]; k < ctx->di[i+1]; k++) sum += (PetscScalar)ctx->da[k] * x[ctx->dj[k]];
+        y[i] = sum;
+    }
+    ierr = VecRestoreArrayRead(xv, &x); CHKERRQ(ierr);
+    
+    if (ctx->scatter) {
+        ierr = VecScatterEnd(ctx->scatter, xv, ctx->ghost, INSERT_VALUES, SCATTER_FORWARD); CHKERRQ(ierr);
+        ierr = VecGetArrayRead(ctx->ghost, &g); CHKERRQ(ierr);
+        SOLVER_OMP(parallel for schedule(static))
+        for (i = 0; i < ctx->nlocal; i++) {
+            PetscScalar sum = 0.0;
+            PetscInt k;
+            for (k = ctx->oi[i]; k < ctx->oi[i+1]; k++) sum += (PetscScalar)ctx->oa[k] * g[ctx->oj[k]];
+            y[i] += sum;
+        }
+        ierr = VecRestoreArrayRead(ctx->ghost, &g); CHKERRQ(ierr);
+    }
+    ierr = VecRestoreArray(yv, &y); CHKERRQ(ierr);
+    
+    return 0;
+}
+
+static PetscErrorCode single_destroy(Mat S) {
+    PetscErrorCode ierr;
+    SingleMatContext *ctx;
+    
+    ierr = MatShellGetContext(S, &ctx); CHKERRQ(ierr);
+    ierr = PetscFree3(ctx->di, ctx->dj, ctx->da); CHKERRQ(ierr);
+    if (ctx->scatter) {
+        ierr = PetscFree3(ctx->oi, ctx->oj, ctx->oa); CHKERRQ(ierr);
+        ierr = VecScatterDestroy(&ctx->scatter); CHKERRQ(ierr);
+        ierr = VecDestroy(&ctx->ghost); CHKERRQ(ierr);
+    }
+    ierr = PetscFree(ctx); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode create_single_precision_operator(Mat A, Mat *S) {
+    PetscErrorCode ierr;
+    SingleMatContext *ctx;
+    Mat Ad, Ao;
+    const PetscInt *garray;
+    PetscInt m, n, M, N;
+    MPI_Comm comm;
+    
+    ierr = PetscObjectGetComm((PetscObject)A, &comm); CHKERRQ(ierr);
+    ierr = MatGetLocalSize(A, &m, &n); CHKERRQ(ierr);
+    ierr = MatGetSize(A, &M, &N); CHKERRQ(ierr);
+    ierr = single_get_blocks(A, &Ad, &Ao, &garray); CHKERRQ(ierr);
+    
+    ierr = PetscNew(&ctx); CHKERRQ(ierr);
+    ctx->A = A;
+    ctx->nlocal = m;
+    ierr = single_copy_structure(Ad, m, &ctx->di, &ctx->dj, &ctx->da); CHKERRQ(ierr);
+    ierr = single_copy_values(Ad, ctx->di[m], ctx->da); CHKERRQ(ierr);
+    
+    if (Ao) {
+        IS is;
+        Vec xtmp;
+    
+        // Столбцы Ao локально сжаты, garray - их глобальные номера
+        ierr = MatGetSize(Ao, NULL, &ctx->nghost); CHKERRQ(ierr);
+        ierr = single_copy_structure(Ao, m, &ctx->oi, &ctx->oj, &ctx->oa); CHKERRQ(ierr);
+        ierr = single_copy_values(Ao, ctx->oi[m], ctx->oa); CHKERRQ(ierr);
+    
+        ierr = ISCreateGeneral(PETSC_COMM_SELF, ctx->nghost, garray, PETSC_COPY_VALUES, &is); CHKERRQ(ierr);
+        ierr = VecCreateSeq(PETSC_COMM_SELF, ctx->nghost, &ctx->ghost); CHKERRQ(ierr);
+        ierr = MatCreateVecs(A, &xtmp, NULL); CHKERRQ(ierr);
+        ierr = VecScatterCreate(xtmp, is, ctx->ghost, NULL, &ctx->scatter); CHKERRQ(ierr);
+        ierr = VecDestroy(&xtmp); CHKERRQ(ierr);
+        ierr = ISDestroy(&is); CHKERRQ(ierr);
+    }
+    
+    ierr = MatCreateShell(comm, m, n, M, N, ctx, S); CHKERRQ(ierr);
+    ierr = MatShellSetOperation(*S, MATOP_MULT, (void (*)(void))single_mult); CHKERRQ(ierr);
+    ierr = MatShellSetOperation(*S, MATOP_DESTROY, (void (*)(void))single_destroy); CHKERRQ(ierr);
+    
+    return 0;
+}
+
+PetscErrorCode solver_set_mixed_precision(LinearSolver *solver, PetscBool enable) {
+    PetscErrorCode ierr;
+    PetscBool is_aij;
+    
+    ierr = MatDestroy(&solver->A_single); CHKERRQ(ierr);
+    if (enable) {
+#if defined(PETSC_USE_COMPLEX)
+        SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_SUP, "Mixed precision mode requires real scalars");
+#endif
+        ierr = PetscObjectBaseTypeCompareAny((PetscObject)solver->A, &is_aij, MATSEQAIJ, MATMPIAIJ, ""); CHKERRQ(ierr);
+        if (!is_aij) SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_SUP, "Mixed precision mode requires an assembled AIJ matrix");
+        ierr = create_single_precision_operator(solver->A, &solver->A_single); CHKERRQ(ierr);
+        // Внутренний KSP: оператор в float, предобуславливатель строится по исходной матрице
+        ierr = KSPSetOperators(solver->ksp, solver->A_single, solver->A); CHKERRQ(ierr);
+    } else {
+        ierr = KSPSetOperators(solver->ksp, solver->A, solver->A); CHKERRQ(ierr);
+    }
+    return 0;
+}
+
+PetscErrorCode solver_refresh_mixed_operator(LinearSolver *solver) {
+    PetscErrorCode ierr;
+    SingleMatContext *ctx;
+    Mat Ad, Ao;
+    const PetscInt *garray;
+    
+    if (!solver->A_single) return 0;
+    ierr = MatShellGetContext(solver->A_single, &ctx); CHKERRQ(ierr);
+    ierr = single_get_blocks(ctx->A, &Ad, &Ao, &garray); CHKERRQ(ierr);
+    ierr = single_copy_values(Ad, ctx->di[ctx->nlocal], ctx->da); CHKERRQ(ierr);
+    if (Ao) { ierr = single_copy_values(Ao, ctx->oi[ctx->nlocal], ctx->oa); CHKERRQ(ierr); }
+    return 0;
+}
+
+PetscErrorCode solver_solve_mixed(LinearSolver *solver, Vec b, Vec x) {
+    PetscErrorCode ierr;
+    PetscReal rtol, atol, dtol, bnorm, rnorm, rnorm_new, target;
+    PetscInt maxits, its, total_its = 0, outer = 0;
+    PetscBool guess_nonzero;
+    PetscLayout map;
+    Vec *work, r, d;
+    
+    ierr = KSPGetTolerances(solver->ksp, &rtol, &atol, &dtol, &maxits); CHKERRQ(ierr);
+    ierr = KSPGetInitialGuessNonzero(solver->ksp, &guess_nonzero); CHKERRQ(ierr);
+    ierr = VecGetLayout(b, &map); CHKERRQ(ierr);
+    ierr = workspace_get_vecs(PetscObjectComm((PetscObject)b), map, 2, &work); CHKERRQ(ierr);
+    r = work[0];
+    d = work[1];
+    
+    ierr = VecNorm(b, NORM_2, &bnorm); CHKERRQ(ierr);
+    target = PetscMax(rtol * bnorm, atol);
+    
+    // Невязка внешнего цикла всегда считается с исходной матрицей в двойной точности
+    if (!guess_nonzero) { ierr = VecSet(x, 0.0); CHKERRQ(ierr); }
+    ierr = MatMult(solver->A, x, r); CHKERRQ(ierr);
+    ierr = VecAYPX(r, -1.0, b); CHKERRQ(ierr);
+    ierr = VecNorm(r, NORM_2, &rnorm); CHKERRQ(ierr);
+    
+    // Внутреннее решение: поправка d для текущей невязки с точностью inner_rtol
+    ierr = KSPSetInitialGuessNonzero(solver->ksp, PETSC_FALSE); CHKERRQ(ierr);
+    
+    while (rnorm > target && outer < SOLVER_MIXED_MAX_OUTER && total_its < maxits) {
+        // Внутренний KSP получает только остаток общего бюджета итераций
+        ierr = KSPSetTolerances(solver->ksp, solver->mixed_inner_rtol, atol, dtol, maxits - total_its); CHKERRQ(ierr);
+        ierr = KSPSolve(solver->ksp, r, d); CHKERRQ(ierr);
+        ierr = KSPGetIterationNumber(solver->ksp, &its); CHKERRQ(ierr);
+        total_its += its;
+        outer++;
+    
+        ierr = VecAXPY(x, 1.0, d); CHKERRQ(ierr);
+        ierr = MatMult(solver->A, x, r); CHKERRQ(ierr);
+        ierr = VecAYPX(r, -1.0, b); CHKERRQ(ierr);
+        ierr = VecNorm(r, NORM_2, &rnorm_new); CHKERRQ(ierr);
+    
+        ierr = PetscInfo(solver->ksp, "Mixed precision outer step %" PetscInt_FMT ": inner its %" PetscInt_FMT ", residual %g\n",
+                         outer, its, (double)rnorm_new); CHKERRQ(ierr);
+        if (rnorm_new > SOLVER_MIXED_STAGNATION * rnorm) {
+            // Поправка, увеличившая невязку, отбрасывается: x возвращается к предыдущему шагу
+            if (rnorm_new > rnorm) {
+                ierr = VecAXPY(x, -1.0, d); CHKERRQ(ierr);
+            } else {
+                rnorm = rnorm_new;
+            }
+            break;
+        }
+        rnorm = rnorm_new;
+    }
+    
+    ierr = KSPSetTolerances(solver->ksp, rtol, atol, dtol, maxits); CHKERRQ(ierr);
+    ierr = KSPSetInitialGuessNonzero(solver->ksp, guess_nonzero); CHKERRQ(ierr);
+    ierr = workspace_return_vecs(2, &work); CHKERRQ(ierr);
+    
+    solver->iterations = total_its;
+    solver->residual = rnorm;
+    solver->outer_iterations = outer;
+    solver->outer_converged = (PetscBool)(rnorm <= target);
+    
+    return 0;
+}
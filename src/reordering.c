@@ -0,0 +1,164 @@
+#include "solver.h"
+#include "threading.h"
+#include <petsctime.h>
+
+// Перестановка строится по диагональному блоку процесса: строки не переходят
+// между процессами, поэтому разбиение матрицы и векторов сохраняется
+static PetscErrorCode reorder_local_permutation(Mat A, MatOrderingType type, IS *perm) {
+    PetscErrorCode ierr;
+    Mat Ad;
+    IS rperm, cperm;
+    const PetscInt *idx;
+    PetscInt *global, n, rstart, rend, i;
+    
+    ierr = MatGetOwnershipRange(A, &rstart, &rend); CHKERRQ(ierr);
+    ierr = MatGetDiagonalBlock(A, &Ad); CHKERRQ(ierr);
+    ierr = MatGetOrdering(Ad, type, &rperm, &cperm); CHKERRQ(ierr);
+    
+    // Симметричная перестановка: RCM и ND возвращают одинаковые rperm и cperm
+    ierr = ISGetLocalSize(rperm, &n); CHKERRQ(ierr);
+    ierr = ISGetIndices(rperm, &idx); CHKERRQ(ierr);
+    ierr = PetscMalloc1(n, &global); CHKERRQ(ierr);
+    for (i = 0; i < n; i++) global[i] = idx[i] + rstart;
+    ierr = ISRestoreIndices(rperm, &idx); CHKERRQ(ierr);
+    ierr = ISCreateGeneral(PetscObjectComm((PetscObject)A), n, global, PETSC_OWN_POINTER, perm); CHKERRQ(ierr);
+    ierr = ISSetPermutation(*perm); CHKERRQ(ierr);
+    
+    ierr = ISDestroy(&rperm); CHKERRQ(ierr);
+    ierr = ISDestroy(&cperm); CHKERRQ(ierr);
+    return 0;
+}
+
+// Среднее время одного SpMV, максимум по процессам
+PetscErrorCode solver_time_spmv(Mat A, PetscLogDouble *time) {
+    PetscErrorCode ierr;
+    PetscLogDouble start_time, end_time;
+    PetscInt k;
+    Vec x, y;
+    
+    ierr = MatCreateVecs(A, &x, &y); CHKERRQ(ierr);
+    ierr = VecSet(x, 1.0); CHKERRQ(ierr);
+    ierr = MatMult(A, x, y); CHKERRQ(ierr);
+    
+    ierr = PetscTime(&start_time); CHKERRQ(ierr);
+    for (k = 0; k < SOLVER_SPMV_SAMPLES; k++) {
+        ierr = MatMult(A, x, y); CHKERRQ(ierr);
+    }
+    ierr = PetscTime(&end_time); CHKERRQ(ierr);
+    *time = (end_time - start_time) / SOLVER_SPMV_SAMPLES;
+    ierr = MPI_Allreduce(MPI_IN_PLACE, time, 1, MPI_DOUBLE, MPI_MAX, PetscObjectComm((PetscObject)A)); CHKERRMPI(ierr);
+    
+    ierr = VecDestroy(&x); CHKERRQ(ierr);
+    ierr = VecDestroy(&y); CHKERRQ(ierr);
+    return 0;
+}
+
+// Пробное решение A x = A*1 с тем же методом, предобуславливателем и допусками, что у решателя
+static PetscErrorCode reorder_trial_iterations(LinearSolver *solver, Mat A, PetscInt *iterations) {
+    PetscErrorCode ierr;
+    LinearSolver trial;
+    KSPType ksp_type;
+    PCType pc_type;
+    PetscReal rtol, atol, dtol;
+    PetscInt maxits;
+    Vec x, b;
+    
+    ierr = KSPGetType(solver->ksp, &ksp_type); CHKERRQ(ierr);
+    ierr = PCGetType(solver->pc, &pc_type); CHKERRQ(ierr);
+    ierr = KSPGetTolerances(solver->ksp, &rtol, &atol, &dtol, &maxits); CHKERRQ(ierr);
+    
+    ierr = solver_create_trial(&trial, A); CHKERRQ(ierr);
+    ierr = KSPSetType(trial.ksp, ksp_type); CHKERRQ(ierr);
+    if (pc_type) { ierr = PCSetType(trial.pc, pc_type); CHKERRQ(ierr); }
+    ierr = KSPSetTolerances(trial.ksp, rtol, atol, dtol, maxits); CHKERRQ(ierr);
+    ierr = solver_setup(&trial); CHKERRQ(ierr);
+    
+    ierr = MatCreateVecs(A, &x, &b); CHKERRQ(ierr);
+    ierr = VecSet(x, 1.0); CHKERRQ(ierr);
+    ierr = MatMult(A, x, b); CHKERRQ(ierr);
+    ierr = VecSet(x, 0.0); CHKERRQ(ierr);
+    ierr = solver_solve(&trial, b, x); CHKERRQ(ierr);
+    *iterations = trial.iterations;
+    
+    ierr = VecDestroy(&x); CHKERRQ(ierr);
+    ierr = VecDestroy(&b); CHKERRQ(ierr);
+    ierr = solver_destroy(&trial); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode solver_set_reordering(LinearSolver *solver, MatOrderingType type) {
+    PetscErrorCode ierr;
+    
+    if (solver->A_natural) SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_ARG_WRONGSTATE, "Reordering must be chosen before solver_setup");
+    solver->reorder_type[0] = '\0';
+    if (type) { ierr = PetscStrncpy(solver->reorder_type, type, sizeof(solver->reorder_type)); CHKERRQ(ierr); }
+    return 0;
+}
+
+PetscErrorCode solver_set_reordering_compare(LinearSolver *solver, PetscBool enable) {
+    solver->reorder_compare = enable;
+    return 0;
+}
+
+PetscErrorCode solver_apply_reordering(LinearSolver *solver) {
+    PetscErrorCode ierr;
+    PetscBool is_aij;
+    PetscLogDouble start_time, end_time;
+    Mat A_perm;
+    
+    if (!solver->reorder_type[0] || solver->A_natural) return 0;
+    ierr = PetscObjectBaseTypeCompareAny((PetscObject)solver->A, &is_aij, MATSEQAIJ, MATMPIAIJ, ""); CHKERRQ(ierr);
+    if (!is_aij) SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_SUP, "Reordering requires an assembled AIJ matrix");
+    if (solver->dm) SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_SUP, "Reordering would break the structured-grid hierarchy");
+    
+    ierr = PetscTime(&start_time); CHKERRQ(ierr);
+    ierr = reorder_local_permutation(solver->A, solver->reorder_type, &solver->perm); CHKERRQ(ierr);
+    ierr = MatPermute(solver->A, solver->perm, solver->perm, &A_perm); CHKERRQ(ierr);
+    ierr = solver_threads_enable_spmv(A_perm); CHKERRQ(ierr);
+    ierr = PetscTime(&end_time); CHKERRQ(ierr);
+    solver->reorder_time = end_time - start_time;
+    
+    ierr = solver_time_spmv(solver->A, &solver->spmv_time_natural); CHKERRQ(ierr);
+    ierr = solver_time_spmv(A_perm, &solver->spmv_time_reordered); CHKERRQ(ierr);
+    if (solver->reorder_compare) {
+        ierr = reorder_trial_iterations(solver, solver->A, &solver->reorder_its_natural); CHKERRQ(ierr);
+        ierr = reorder_trial_iterations(solver, A_perm, &solver->reorder_its_reordered); CHKERRQ(ierr);
+    }
+    
+    // Дальше решатель работает с переставленной матрицей; векторы переставляются в solver_solve
+    solver->A_natural = solver->A;
+    solver->A = A_perm;
+    ierr = MatCreateVecs(A_perm, &solver->x_perm, &solver->b_perm); CHKERRQ(ierr);
+    if (solver->A_single) {
+        ierr = solver_set_mixed_precision(solver, PETSC_TRUE); CHKERRQ(ierr);
+    } else {
+        ierr = KSPSetOperators(solver->ksp, solver->A, solver->A); CHKERRQ(ierr);
+    }
+    return 0;
+}
+
+PetscErrorCode solver_refresh_reordering(LinearSolver *solver) {
+    PetscErrorCode ierr;
+    
+    if (!solver->A_natural) return 0;
+    // Перестановка та же, новые значения берутся из исходной матрицы
+    ierr = MatDestroy(&solver->A); CHKERRQ(ierr);
+    ierr = MatPermute(solver->A_natural, solver->perm, solver->perm, &solver->A); CHKERRQ(ierr);
+    ierr = solver_threads_enable_spmv(solver->A); CHKERRQ(ierr);
+    if (solver->A_single) { ierr = solver_set_mixed_precision(solver, PETSC_TRUE); CHKERRQ(ierr); }
+    return 0;
+}
+
+PetscErrorCode solver_destroy_reordering(LinearSolver *solver) {
+    PetscErrorCode ierr;
+    
+    if (solver->A_natural) {
+        ierr = MatDestroy(&solver->A); CHKERRQ(ierr);
+        solver->A = solver->A_natural;
+        solver->A_natural = NULL;
+    }
+    ierr = ISDestroy(&solver->perm); CHKERRQ(ierr);
+    ierr = VecDestroy(&solver->b_perm); CHKERRQ(ierr);
+    ierr = VecDestroy(&solver->x_perm); CHKERRQ(ierr);
+    return 0;
+}
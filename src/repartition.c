@@ -0,0 +1,235 @@
+#include "repartition.h"
+#include "threading.h"
+
+// Встроенное разбиение: граф на процессе 0, RCM, непрерывные куски равного веса.
+// Вес строки - число ненулевых плюс 1 за элемент векторов
+static PetscErrorCode repartition_rcm_rows(Mat A, IS *rows) {
+    PetscErrorCode ierr;
+    MPI_Comm comm = PetscObjectComm((PetscObject)A);
+    PetscMPIInt rank, size, p, nsend, nnew, *counts = NULL, *displs = NULL;
+    PetscInt rstart, rend, nlocal, N, row, ncols, k, i, nnz = 0, total = 0, start;
+    PetscInt *lens, *cols, *all_lens = NULL, *all_cols = NULL, *ia = NULL, *local;
+    const PetscInt *rcols, *order = NULL;
+    PetscScalar *vals = NULL;
+    PetscReal weight, weight_total;
+    IS rperm = NULL, cperm = NULL;
+    Mat G = NULL;
+    
+    ierr = MPI_Comm_rank(comm, &rank); CHKERRMPI(ierr);
+    ierr = MPI_Comm_size(comm, &size); CHKERRMPI(ierr);
+    ierr = MatGetSize(A, &N, NULL); CHKERRQ(ierr);
+    ierr = MatGetOwnershipRange(A, &rstart, &rend); CHKERRQ(ierr);
+    nlocal = rend - rstart;
+    
+    // Локальная часть шаблона в CSR с глобальными столбцами
+    ierr = PetscMalloc1(nlocal, &lens); CHKERRQ(ierr);
+    for (row = rstart; row < rend; row++) {
+        ierr = MatGetRow(A, row, &ncols, NULL, NULL); CHKERRQ(ierr);
+        lens[row - rstart] = ncols;
+        nnz += ncols;
+        ierr = MatRestoreRow(A, row, &ncols, NULL, NULL); CHKERRQ(ierr);
+    }
+    ierr = PetscMalloc1(nnz, &cols); CHKERRQ(ierr);
+    for (row = rstart, k = 0; row < rend; row++) {
+        ierr = MatGetRow(A, row, &ncols, &rcols, NULL); CHKERRQ(ierr);
+        ierr = PetscArraycpy(cols + k, rcols, ncols); CHKERRQ(ierr);
+        k += ncols;
+        ierr = MatRestoreRow(A, row, &ncols, &rcols, NULL); CHKERRQ(ierr);
+    }
+    
+    // Сборка шаблона на процессе 0
+    if (rank == 0) {
+        ierr = PetscMalloc2(size, &counts, size, &displs); CHKERRQ(ierr);
+        ierr = PetscMalloc1(N, &all_lens); CHKERRQ(ierr);
+    }
+    nsend = (PetscMPIInt)nlocal;
+    ierr = MPI_Gather(&nsend, 1, MPI_INT, counts, 1, MPI_INT, 0, comm); CHKERRMPI(ierr);
+    if (rank == 0) {
+        for (p = 0, displs[0] = 0; p < size - 1; p++) displs[p + 1] = displs[p] + counts[p];
+    }
+    ierr = MPI_Gatherv(lens, nsend, MPIU_INT, all_lens, counts, displs, MPIU_INT, 0, comm); CHKERRMPI(ierr);
+    nsend = (PetscMPIInt)nnz;
+    ierr = MPI_Gather(&nsend, 1, MPI_INT, counts, 1, MPI_INT, 0, comm); CHKERRMPI(ierr);
+    if (rank == 0) {
+        for (p = 0, displs[0] = 0; p < size - 1; p++) displs[p + 1] = displs[p] + counts[p];
+        total = displs[size - 1] + counts[size - 1];
+        ierr = PetscMalloc1(total, &all_cols); CHKERRQ(ierr);
+    }
+    ierr = MPI_Gatherv(cols, nsend, MPIU_INT, all_cols, counts, displs, MPIU_INT, 0, comm); CHKERRMPI(ierr);
+    ierr = PetscFree(lens); CHKERRQ(ierr);
+    ierr = PetscFree(cols); CHKERRQ(ierr);
+    
+    if (rank == 0) {
+        // RCM по симметризованному шаблону; значения для MatGetOrdering не нужны
+        ierr = PetscMalloc1(N + 1, &ia); CHKERRQ(ierr);
+        for (i = 0, ia[0] = 0; i < N; i++) ia[i + 1] = ia[i] + all_lens[i];
+        ierr = PetscCalloc1(total, &vals); CHKERRQ(ierr);
+        ierr = MatCreateSeqAIJWithArrays(PETSC_COMM_SELF, N, N, ia, all_cols, vals, &G); CHKERRQ(ierr);
+        ierr = MatGetOrdering(G, MATORDERINGRCM, &rperm, &cperm); CHKERRQ(ierr);
+        ierr = ISGetIndices(rperm, &order); CHKERRQ(ierr);
+    
+        // Границы кусков - там, где накопленный вес переходит очередную долю 1/size
+        weight_total = (PetscReal)(total + N);
+        for (i = 0, p = 0, start = 0, weight = 0.0; i < N; i++) {
+            weight += all_lens[order[i]] + 1;
+            if (p < size - 1 && weight >= (p + 1) * weight_total / size) {
+                counts[p++] = (PetscMPIInt)(i + 1 - start);
+                start = i + 1;
+            }
+        }
+        counts[p] = (PetscMPIInt)(N - start);
+        for (p = p + 1; p < size; p++) counts[p] = 0;
+        for (p = 0, displs[0] = 0; p < size - 1; p++) displs[p + 1] = displs[p] + counts[p];
+    }
+    
+    ierr = MPI_Scatter(counts, 1, MPI_INT, &nnew, 1, MPI_INT, 0, comm); CHKERRMPI(ierr);
+    ierr = PetscMalloc1(nnew, &local); CHKERRQ(ierr);
+    ierr = MPI_Scatterv((void *)order, counts, displs, MPIU_INT, local, nnew, MPIU_INT, 0, comm); CHKERRMPI(ierr);
+    ierr = ISCreateGeneral(comm, nnew, local, PETSC_OWN_POINTER, rows); CHKERRQ(ierr);
+    
+    if (rank == 0) {
+        ierr = ISRestoreIndices(rperm, &order); CHKERRQ(ierr);
+        ierr = ISDestroy(&rperm); CHKERRQ(ierr);
+        ierr = ISDestroy(&cperm); CHKERRQ(ierr);
+        ierr = MatDestroy(&G); CHKERRQ(ierr);
+        ierr = PetscFree(ia); CHKERRQ(ierr);
+        ierr = PetscFree(vals); CHKERRQ(ierr);
+        ierr = PetscFree(all_lens); CHKERRQ(ierr);
+        ierr = PetscFree(all_cols); CHKERRQ(ierr);
+        ierr = PetscFree2(counts, displs); CHKERRQ(ierr);
+    }
+    return 0;
+}
+
+// Разбиение MatPartitioning PETSc с весами вершин по числу ненулевых в строке
+static PetscErrorCode repartition_partitioner_rows(Mat A, const char *type, IS *rows) {
+    PetscErrorCode ierr;
+    MatPartitioning part;
+    Mat adj;
+    IS is_part;
+    PetscInt rstart, rend, row, ncols, *weights;
+    
+    ierr = MatGetOwnershipRange(A, &rstart, &rend); CHKERRQ(ierr);
+    ierr = PetscMalloc1(rend - rstart, &weights); CHKERRQ(ierr);
+    for (row = rstart; row < rend; row++) {
+        ierr = MatGetRow(A, row, &ncols, NULL, NULL); CHKERRQ(ierr);
+        weights[row - rstart] = ncols;
+        ierr = MatRestoreRow(A, row, &ncols, NULL, NULL); CHKERRQ(ierr);
+    }
+    
+    ierr = MatConvert(A, MATMPIADJ, MAT_INITIAL_MATRIX, &adj); CHKERRQ(ierr);
+    ierr = MatPartitioningCreate(PetscObjectComm((PetscObject)A), &part); CHKERRQ(ierr);
+    ierr = MatPartitioningSetAdjacency(part, adj); CHKERRQ(ierr);
+    ierr = MatPartitioningSetType(part, type); CHKERRQ(ierr);
+    ierr = MatPartitioningSetVertexWeights(part, weights); CHKERRQ(ierr);   // владение переходит к part
+    ierr = MatPartitioningSetFromOptions(part); CHKERRQ(ierr);
+    ierr = MatPartitioningApply(part, &is_part); CHKERRQ(ierr);
+    
+    // is_part - номер процесса для каждой локальной строки; rows - строки, пришедшие на процесс
+    ierr = ISBuildTwoSided(is_part, NULL, rows); CHKERRQ(ierr);
+    
+    ierr = ISDestroy(&is_part); CHKERRQ(ierr);
+    ierr = MatPartitioningDestroy(&part); CHKERRQ(ierr);
+    ierr = MatDestroy(&adj); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode repartition_get_stats(Mat A, RepartitionStats *stats) {
+    PetscErrorCode ierr;
+    MPI_Comm comm = PetscObjectComm((PetscObject)A);
+    PetscMPIInt size;
+    MatInfo info;
+    PetscLogDouble nnz_max, nnz_sum;
+    PetscInt nghost = 0;
+    PetscBool is_mpi;
+    Mat Ad, Ao;
+    
+    ierr = MPI_Comm_size(comm, &size); CHKERRMPI(ierr);
+    ierr = MatGetInfo(A, MAT_LOCAL, &info); CHKERRQ(ierr);
+    ierr = MPI_Allreduce(&info.nz_used, &nnz_max, 1, MPI_DOUBLE, MPI_MAX, comm); CHKERRMPI(ierr);
+    ierr = MPI_Allreduce(&info.nz_used, &nnz_sum, 1, MPI_DOUBLE, MPI_SUM, comm); CHKERRMPI(ierr);
+    stats->nnz_imbalance = nnz_sum > 0.0 ? nnz_max * size / nnz_sum : 1.0;
+    
+    // Столбцы внедиагонального блока MPIAIJ сжаты до ghost-значений, получаемых в SpMV
+    ierr = PetscObjectBaseTypeCompare((PetscObject)A, MATMPIAIJ, &is_mpi); CHKERRQ(ierr);
+    if (is_mpi) {
+        ierr = MatMPIAIJGetSeqAIJ(A, &Ad, &Ao, NULL); CHKERRQ(ierr);
+        ierr = MatGetSize(Ao, NULL, &nghost); CHKERRQ(ierr);
+    }
+    ierr = MPI_Allreduce(&nghost, &stats->ghost_total, 1, MPIU_INT, MPI_SUM, comm); CHKERRMPI(ierr);
+    ierr = MPI_Allreduce(&nghost, &stats->ghost_max, 1, MPIU_INT, MPI_MAX, comm); CHKERRMPI(ierr);
+    
+    ierr = solver_time_spmv(A, &stats->spmv_time); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode repartition_create(Mat A, Repartition *rp) {
+    PetscErrorCode ierr;
+    PetscBool is_aij, is_rcm;
+    PetscLogDouble start_time, end_time;
+    Vec v, v_new;
+    
+    ierr = PetscObjectBaseTypeCompareAny((PetscObject)A, &is_aij, MATSEQAIJ, MATMPIAIJ, ""); CHKERRQ(ierr);
+    if (!is_aij) SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_SUP, "Repartitioning requires an assembled AIJ matrix");
+    
+    rp->A = NULL;
+    rp->rows = NULL;
+    rp->scatter = NULL;
+    ierr = PetscStrncpy(rp->type, "rcm", sizeof(rp->type)); CHKERRQ(ierr);
+    ierr = PetscOptionsGetString(NULL, NULL, "-repartition_type", rp->type, sizeof(rp->type), NULL); CHKERRQ(ierr);
+    ierr = repartition_get_stats(A, &rp->before); CHKERRQ(ierr);
+    
+    ierr = PetscTime(&start_time); CHKERRQ(ierr);
+    ierr = PetscStrcmp(rp->type, "rcm", &is_rcm); CHKERRQ(ierr);
+    if (is_rcm) {
+        ierr = repartition_rcm_rows(A, &rp->rows); CHKERRQ(ierr);
+    } else {
+        ierr = repartition_partitioner_rows(A, rp->type, &rp->rows); CHKERRQ(ierr);
+    }
+    
+    // Те же индексы для столбцов: локальные части векторов совпадают с новыми строками
+    ierr = MatCreateSubMatrix(A, rp->rows, rp->rows, MAT_INITIAL_MATRIX, &rp->A); CHKERRQ(ierr);
+    ierr = MatCreateVecs(A, &v, NULL); CHKERRQ(ierr);
+    ierr = MatCreateVecs(rp->A, &v_new, NULL); CHKERRQ(ierr);
+    ierr = VecScatterCreate(v, rp->rows, v_new, NULL, &rp->scatter); CHKERRQ(ierr);
+    ierr = VecDestroy(&v); CHKERRQ(ierr);
+    ierr = VecDestroy(&v_new); CHKERRQ(ierr);
+    ierr = PetscTime(&end_time); CHKERRQ(ierr);
+    rp->time = end_time - start_time;
+    
+    ierr = solver_threads_enable_spmv(rp->A); CHKERRQ(ierr);
+    ierr = repartition_get_stats(rp->A, &rp->after); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode repartition_forward(Repartition *rp, Vec v, Vec v_new) {
+    PetscErrorCode ierr;
+    ierr = VecScatterBegin(rp->scatter, v, v_new, INSERT_VALUES, SCATTER_FORWARD); CHKERRQ(ierr);
+    ierr = VecScatterEnd(rp->scatter, v, v_new, INSERT_VALUES, SCATTER_FORWARD); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode repartition_backward(Repartition *rp, Vec v_new, Vec v) {
+    PetscErrorCode ierr;
+    ierr = VecScatterBegin(rp->scatter, v_new, v, INSERT_VALUES, SCATTER_REVERSE); CHKERRQ(ierr);
+    ierr = VecScatterEnd(rp->scatter, v_new, v, INSERT_VALUES, SCATTER_REVERSE); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode repartition_print_stats(const Repartition *rp) {
+    PetscPrintf(PETSC_COMM_WORLD, "Repartitioning (%s): %g seconds\n", rp->type, rp->time);
+    PetscPrintf(PETSC_COMM_WORLD, "  nnz imbalance (max/avg): %.3f -> %.3f\n",
+                (double)rp->before.nnz_imbalance, (double)rp->after.nnz_imbalance);
+    PetscPrintf(PETSC_COMM_WORLD, "  ghost values per SpMV: %" PetscInt_FMT " (max %" PetscInt_FMT " per rank) -> %" PetscInt_FMT " (max %" PetscInt_FMT ")\n",
+                rp->before.ghost_total, rp->before.ghost_max, rp->after.ghost_total, rp->after.ghost_max);
+    PetscPrintf(PETSC_COMM_WORLD, "  SpMV time: %g -> %g seconds\n", rp->before.spmv_time, rp->after.spmv_time);
+    return 0;
+}
+
+PetscErrorCode repartition_destroy(Repartition *rp) {
+    PetscErrorCode ierr;
+    ierr = MatDestroy(&rp->A); CHKERRQ(ierr);
+    ierr = ISDestroy(&rp->rows); CHKERRQ(ierr);
+    ierr = VecScatterDestroy(&rp->scatter); CHKERRQ(ierr);
+    return 0;
+}
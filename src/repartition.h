@@ -0,0 +1,41 @@
+#ifndef REPARTITION_H
+#define REPARTITION_H
+
+#include "solver.h"
+
+// Переразбиение строк собранной AIJ-матрицы перед solver_create: строки
+// распределяются между процессами с равным числом ненулевых и так, чтобы
+// соседние по графу матрицы строки попадали на один процесс. Матрица и векторы
+// переносятся в новое разбиение, решение возвращается в исходное.
+//
+// Разбиение по умолчанию (-repartition_type rcm) встроенное: граф собирается на
+// процессе 0, упорядочивается RCM и режется на непрерывные куски равного веса,
+// так что межпроцессные связи ограничены шириной ленты. Любой другой тип -
+// MatPartitioningType PETSc (parmetis, ptscotch, ...) с весами вершин по числу
+// ненулевых в строке.
+
+typedef struct {
+    PetscReal nnz_imbalance;        // максимум / среднее число ненулевых на процесс
+    PetscInt ghost_total;           // ghost-значений в одном SpMV: сумма по процессам
+    PetscInt ghost_max;             // и максимум
+    PetscLogDouble spmv_time;       // среднее время одного SpMV
+} RepartitionStats;
+
+typedef struct {
+    Mat A;                          // матрица в новом разбиении
+    IS rows;                        // строки исходной матрицы, которые процесс получил, в новом порядке
+    VecScatter scatter;             // исходное разбиение -> новое
+    char type[64];
+    PetscLogDouble time;            // построение разбиения и перенос матрицы
+    RepartitionStats before, after;
+} Repartition;
+
+PetscErrorCode repartition_create(Mat A, Repartition *rp);
+// v - в исходном разбиении, v_new - в разбиении rp->A (MatCreateVecs)
+PetscErrorCode repartition_forward(Repartition *rp, Vec v, Vec v_new);
+PetscErrorCode repartition_backward(Repartition *rp, Vec v_new, Vec v);
+PetscErrorCode repartition_get_stats(Mat A, RepartitionStats *stats);
+PetscErrorCode repartition_print_stats(const Repartition *rp);
+PetscErrorCode repartition_destroy(Repartition *rp);
+
+#endif
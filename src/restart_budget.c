@@ -0,0 +1,126 @@
+#include "solver.h"
+
+// Рабочие векторы GMRES сверх базиса (VEC_OFFSET в реализации PETSc)
+#define KRYLOV_WORK_VECS 3
+
+// Модель памяти GMRES(m) на процесс: m + 1 векторов базиса и рабочие векторы
+// (у гибких вариантов ещё m предобусловленных), матрица Хессенберга и вращения
+static PetscErrorCode krylov_memory_model(LinearSolver *solver, PetscInt restart, PetscLogDouble *bytes) {
+    PetscErrorCode ierr;
+    PetscBool flexible;
+    PetscInt nlocal, nvecs;
+    
+    if (!solver->nlocal_max) {
+        ierr = VecGetLocalSize(solver->x, &nlocal); CHKERRQ(ierr);
+        ierr = MPI_Allreduce(&nlocal, &solver->nlocal_max, 1, MPIU_INT, MPI_MAX, PetscObjectComm((PetscObject)solver->ksp)); CHKERRMPI(ierr);
+    }
+    ierr = PetscObjectTypeCompareAny((PetscObject)solver->ksp, &flexible, KSPFGMRES, KSPPIPEFGMRES, ""); CHKERRQ(ierr);
+    nvecs = restart + 1 + KRYLOV_WORK_VECS + (flexible ? restart : 0);
+    *bytes = (PetscLogDouble)nvecs * solver->nlocal_max * sizeof(PetscScalar)
+             + 4.0 * (restart + 2) * (restart + 2) * sizeof(PetscScalar);
+    return 0;
+}
+
+static PetscErrorCode krylov_is_gmres(KSP ksp, PetscBool *gmres) {
+    PetscErrorCode ierr;
+    ierr = PetscObjectTypeCompareAny((PetscObject)ksp, gmres, KSPGMRES, KSPFGMRES, KSPPGMRES, KSPPIPEFGMRES, ""); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode solver_set_memory_budget(LinearSolver *solver, PetscReal bytes) {
+    if (bytes < 0.0) SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Memory budget must be non-negative");
+    solver->memory_budget = bytes;
+    return 0;
+}
+
+PetscErrorCode solver_apply_memory_budget(LinearSolver *solver) {
+    PetscErrorCode ierr;
+    PetscBool gmres, adaptive;
+    PetscLogDouble bytes;
+    PetscReal rtol, atol, dtol;
+    PetscInt restart, maxits;
+    
+    solver->restart_max = 0;
+    solver->restart_adaptive = PETSC_FALSE;
+    if (solver->memory_budget <= 0.0) return 0;
+    ierr = krylov_is_gmres(solver->ksp, &gmres); CHKERRQ(ierr);
+    if (!gmres) return 0;
+    
+    // Память растёт с рестартом монотонно: наибольший рестарт в пределах бюджета,
+    // но не длиннее предела итераций
+    ierr = KSPGetTolerances(solver->ksp, &rtol, &atol, &dtol, &maxits); CHKERRQ(ierr);
+    for (restart = 1; restart < maxits; restart++) {
+        ierr = krylov_memory_model(solver, restart + 1, &bytes); CHKERRQ(ierr);
+        if (bytes > solver->memory_budget) break;
+    }
+    if (restart < SOLVER_RESTART_MIN) {
+        SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Memory budget is too small for a GMRES basis");
+    }
+    solver->restart_max = restart;
+    
+    // Начальный рестарт - заданный или стандартный, но не больше допустимого
+    restart = PetscMin(solver->restart > 0 ? solver->restart : SOLVER_RESTART_INITIAL, solver->restart_max);
+    ierr = solver_set_restart(solver, restart); CHKERRQ(ierr);
+    
+    // Рост рестарта требует решения по циклам; конвейерным вариантам нужна своя проверка
+    // невязки, а проекция начального приближения пересчитывала бы его в каждом цикле
+    ierr = PetscObjectTypeCompareAny((PetscObject)solver->ksp, &adaptive, KSPGMRES, KSPFGMRES, ""); CHKERRQ(ierr);
+    solver->restart_adaptive = (PetscBool)(adaptive && solver->guess_type != SOLVER_GUESS_FISCHER);
+    return 0;
+}
+
+// Решение циклами по restart итераций. Если цикл уменьшил невязку меньше, чем в
+// SOLVER_RESTART_STAGNATION раз относительно прошлого, рестарт удваивается в
+// пределах restart_max. Начиная со второго цикла приближение ненулевое, и порог
+// сходимости по-прежнему считается от ||b||, как в одном KSPSolve.
+PetscErrorCode solver_solve_budgeted(LinearSolver *solver, Vec b, Vec x) {
+    PetscErrorCode ierr;
+    KSPConvergedReason reason;
+    PetscReal rtol, atol, dtol, rnorm, rnorm_prev = 0.0;
+    PetscInt maxits, its, total = 0, restart, cycle;
+    PetscBool guess_nonzero;
+    
+    ierr = KSPGetTolerances(solver->ksp, &rtol, &atol, &dtol, &maxits); CHKERRQ(ierr);
+    ierr = KSPGetInitialGuessNonzero(solver->ksp, &guess_nonzero); CHKERRQ(ierr);
+    ierr = KSPGMRESGetRestart(solver->ksp, &restart); CHKERRQ(ierr);
+    
+    for (cycle = 0; total < maxits; cycle++) {
+        ierr = KSPSetTolerances(solver->ksp, rtol, atol, dtol, PetscMin(restart, maxits - total)); CHKERRQ(ierr);
+        ierr = KSPSolve(solver->ksp, b, x); CHKERRQ(ierr);
+        ierr = KSPGetIterationNumber(solver->ksp, &its); CHKERRQ(ierr);
+        ierr = KSPGetConvergedReason(solver->ksp, &reason); CHKERRQ(ierr);
+        ierr = KSPGetResidualNorm(solver->ksp, &rnorm); CHKERRQ(ierr);
+        total += its;
+        if (reason != KSP_DIVERGED_ITS) break;
+    
+        if (cycle > 0 && rnorm > SOLVER_RESTART_STAGNATION * rnorm_prev && restart < solver->restart_max) {
+            // Смена рестарта пересоздаёт базис; PC не пересобирается, оператор тот же
+            restart = PetscMin(2 * restart, solver->restart_max);
+            ierr = solver_set_restart(solver, restart); CHKERRQ(ierr);
+            ierr = PetscInfo(solver->ksp, "GMRES stagnated (%g -> %g), restart increased to %" PetscInt_FMT "\n",
+                             (double)rnorm_prev, (double)rnorm, restart); CHKERRQ(ierr);
+        }
+        rnorm_prev = rnorm;
+        ierr = KSPSetInitialGuessNonzero(solver->ksp, PETSC_TRUE); CHKERRQ(ierr);
+    }
+    
+    ierr = KSPSetTolerances(solver->ksp, rtol, atol, dtol, maxits); CHKERRQ(ierr);
+    ierr = KSPSetInitialGuessNonzero(solver->ksp, guess_nonzero); CHKERRQ(ierr);
+    solver->iterations = total;
+    solver->residual = rnorm;
+    return 0;
+}
+
+PetscErrorCode solver_krylov_memory(LinearSolver *solver, PetscLogDouble *bytes) {
+    PetscErrorCode ierr;
+    PetscBool gmres;
+    PetscInt restart;
+    
+    // Для не-GMRES методов число рабочих векторов постоянно и мало: не учитывается
+    *bytes = 0.0;
+    ierr = krylov_is_gmres(solver->ksp, &gmres); CHKERRQ(ierr);
+    if (!gmres) return 0;
+    ierr = KSPGMRESGetRestart(solver->ksp, &restart); CHKERRQ(ierr);
+    ierr = krylov_memory_model(solver, restart, bytes); CHKERRQ(ierr);
+    return 0;
+}
@@ -0,0 +1,254 @@
+#define _POSIX_C_SOURCE 200809L
+#include "solve_queue.h"
+#include <time.h>
+
+// Монотонные часы, одинаковые для обоих потоков (MPI_Wtime из фонового потока не вызывается)
+static PetscLogDouble queue_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (PetscLogDouble)ts.tv_sec + 1e-9 * (PetscLogDouble)ts.tv_nsec;
+}
+
+// Фоновый поток: генерирует строки заданий по порядку, PETSc не вызывает
+static void *solve_queue_worker(void *arg) {
+    SolveQueue *queue = (SolveQueue *)arg;
+    
+    pthread_mutex_lock(&queue->lock);
+    for (;;) {
+        SolveJob *job;
+    
+        while (!queue->shutdown && queue->next_assembly >= queue->njobs) {
+            pthread_cond_wait(&queue->cond, &queue->lock);
+        }
+        if (queue->shutdown) break;
+        job = queue->jobs[queue->next_assembly++];
+        if (!job->row_fn) continue;
+    
+        job->state = SOLVE_JOB_ASSEMBLING;
+        job->assembly_start = queue_now();
+        pthread_mutex_unlock(&queue->lock);
+    
+        job->rows.ierr = row_chunk_generate(&job->rows, job->rstart, job->max_row_nnz, job->row_fn, job->ctx);
+    
+        pthread_mutex_lock(&queue->lock);
+        job->assembly_end = queue_now();
+        job->state = SOLVE_JOB_READY;
+        pthread_cond_broadcast(&queue->cond);
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return NULL;
+}
+
+PetscErrorCode solve_queue_create(SolveQueue *queue, const SolverConfig *config) {
+    PetscErrorCode ierr;
+    
+    ierr = PetscMemzero(queue, sizeof(*queue)); CHKERRQ(ierr);
+    if (config) {
+        queue->config = *config;
+        queue->has_config = PETSC_TRUE;
+    }
+    if (pthread_mutex_init(&queue->lock, NULL) || pthread_cond_init(&queue->cond, NULL)) {
+        SETERRQ(PETSC_COMM_SELF, PETSC_ERR_SYS, "Cannot initialize solve queue synchronization");
+    }
+    if (pthread_create(&queue->worker, NULL, solve_queue_worker, queue)) {
+        SETERRQ(PETSC_COMM_SELF, PETSC_ERR_SYS, "Cannot start solve queue worker thread");
+    }
+    return 0;
+}
+
+static PetscErrorCode solve_queue_push(SolveQueue *queue, SolveJob *job, PetscInt *handle) {
+    PetscErrorCode ierr;
+    
+    if (!queue->njobs) queue->first_submit = queue_now();
+    pthread_mutex_lock(&queue->lock);
+    if (queue->njobs == queue->capacity) {
+        queue->capacity = PetscMax(2 * queue->capacity, 16);
+        ierr = PetscRealloc(sizeof(SolveJob *) * queue->capacity, &queue->jobs);
+        if (ierr) { pthread_mutex_unlock(&queue->lock); CHKERRQ(ierr); }
+    }
+    *handle = queue->njobs;
+    queue->jobs[queue->njobs++] = job;
+    pthread_cond_broadcast(&queue->cond);
+    pthread_mutex_unlock(&queue->lock);
+    return 0;
+}
+
+PetscErrorCode solve_queue_submit(SolveQueue *queue, Mat A, Vec b, Vec x, PetscInt *handle) {
+    PetscErrorCode ierr;
+    SolveJob *job;
+    
+    ierr = PetscNew(&job); CHKERRQ(ierr);
+    job->state = SOLVE_JOB_READY;
+    job->A = A;
+    job->b = b;
+    job->x = x;
+    ierr = solve_queue_push(queue, job, handle); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode solve_queue_submit_rows(SolveQueue *queue, PetscInt n, PetscInt max_row_nnz, MatRowFunction row_fn, void *ctx,
+                                       Vec b, Vec x, PetscInt *handle) {
+    PetscErrorCode ierr;
+    SolveJob *job;
+    PetscInt rend;
+    
+    ierr = PetscNew(&job); CHKERRQ(ierr);
+    job->state = SOLVE_JOB_QUEUED;
+    job->b = b;
+    job->x = x;
+    job->n = n;
+    job->max_row_nnz = max_row_nnz;
+    job->row_fn = row_fn;
+    job->ctx = ctx;
+    
+    // Разбиение строк считается здесь (коллективно), фоновому потоку MPI не нужен
+    job->nlocal = PETSC_DECIDE;
+    ierr = PetscSplitOwnership(PETSC_COMM_WORLD, &job->nlocal, &job->n); CHKERRQ(ierr);
+    ierr = MPI_Scan(&job->nlocal, &rend, 1, MPIU_INT, MPI_SUM, PETSC_COMM_WORLD); CHKERRMPI(ierr);
+    job->rstart = rend - job->nlocal;
+    job->rows.lo = 0;
+    job->rows.hi = job->nlocal;
+    
+    ierr = solve_queue_push(queue, job, handle); CHKERRQ(ierr);
+    return 0;
+}
+
+// Вклад одного решения в перекрытие: пересечение [solve_start, solve_end] со всеми
+// интервалами фоновой сборки; решения идут последовательно, поэтому без двойного счёта
+static PetscLogDouble solve_queue_overlap(SolveQueue *queue, const SolveJob *solved) {
+    PetscLogDouble overlap = 0.0;
+    PetscInt k;
+    
+    pthread_mutex_lock(&queue->lock);
+    for (k = 0; k < queue->njobs; k++) {
+        const SolveJob *job = queue->jobs[k];
+        PetscLogDouble end;
+    
+        if (!job->row_fn || job->state == SOLVE_JOB_QUEUED) continue;
+        end = (job->state == SOLVE_JOB_ASSEMBLING) ? solved->solve_end : job->assembly_end;
+        overlap += PetscMax(0.0, PetscMin(end, solved->solve_end) - PetscMax(job->assembly_start, solved->solve_start));
+    }
+    pthread_mutex_unlock(&queue->lock);
+    return overlap;
+}
+
+// Состояние пишет и фоновый поток, читается только под lock
+static PetscBool solve_queue_job_done(SolveQueue *queue, PetscInt handle) {
+    PetscBool done;
+    pthread_mutex_lock(&queue->lock);
+    done = (PetscBool)(queue->jobs[handle]->state == SOLVE_JOB_DONE);
+    pthread_mutex_unlock(&queue->lock);
+    return done;
+}
+
+static PetscErrorCode solve_queue_run_next(SolveQueue *queue) {
+    PetscErrorCode ierr;
+    SolveJob *job = queue->jobs[queue->next_solve];
+    LinearSolver solver;
+    PetscLogDouble insert_time = 0.0;
+    
+    pthread_mutex_lock(&queue->lock);
+    while (job->state != SOLVE_JOB_READY) pthread_cond_wait(&queue->cond, &queue->lock);
+    pthread_mutex_unlock(&queue->lock);
+    
+    job->solve_start = queue_now();
+    if (job->row_fn) {
+        // Ошибка генерации на одном процессе - общая, иначе остальные ждут в коллективной сборке
+        int rows_ierr = (int)job->rows.ierr;
+        ierr = MPI_Allreduce(MPI_IN_PLACE, &rows_ierr, 1, MPI_INT, MPI_MAX, PETSC_COMM_WORLD); CHKERRMPI(ierr);
+        if (rows_ierr) SETERRQ(PETSC_COMM_WORLD, (PetscErrorCode)rows_ierr, "Background row generation failed");
+        ierr = create_matrix_from_csr(PETSC_COMM_WORLD, job->nlocal, job->n, job->rows.rowptr, job->rows.cols, job->rows.vals, &job->A); CHKERRQ(ierr);
+        ierr = get_last_assembly_time(&insert_time); CHKERRQ(ierr);
+        row_chunk_free(&job->rows);
+        job->owns_matrix = PETSC_TRUE;
+    }
+    
+    // Пока здесь идут настройка и решение, фоновый поток собирает следующие задания
+    ierr = solver_create(&solver, job->A); CHKERRQ(ierr);
+    if (queue->has_config) { ierr = solver_configure(&solver, &queue->config); CHKERRQ(ierr); }
+    ierr = solver_setup(&solver); CHKERRQ(ierr);
+    ierr = solver_solve_with_result(&solver, job->b, job->x, &job->result); CHKERRQ(ierr);
+    job->result.assembly_time = job->row_fn ? (job->assembly_end - job->assembly_start) + insert_time : 0.0;
+    ierr = solver_destroy(&solver); CHKERRQ(ierr);
+    if (job->owns_matrix) { ierr = MatDestroy(&job->A); CHKERRQ(ierr); }
+    job->solve_end = queue_now();
+    
+    queue->stats.jobs++;
+    queue->stats.solve_time += job->solve_end - job->solve_start;
+    if (job->row_fn) queue->stats.assembly_time += job->assembly_end - job->assembly_start;
+    queue->stats.overlap_time += solve_queue_overlap(queue, job);
+    queue->stats.wall_time = job->solve_end - queue->first_submit;
+    
+    pthread_mutex_lock(&queue->lock);
+    job->state = SOLVE_JOB_DONE;
+    pthread_mutex_unlock(&queue->lock);
+    queue->next_solve++;
+    return 0;
+}
+
+PetscErrorCode solve_queue_poll(SolveQueue *queue, PetscInt handle, PetscBool *done) {
+    PetscErrorCode ierr;
+    int ready = 0;
+    
+    if (handle < 0 || handle >= queue->njobs) SETERRQ(PETSC_COMM_SELF, PETSC_ERR_ARG_OUTOFRANGE, "Unknown solve handle");
+    if (!solve_queue_job_done(queue, handle) && queue->next_solve < queue->njobs) {
+        pthread_mutex_lock(&queue->lock);
+        ready = (queue->jobs[queue->next_solve]->state == SOLVE_JOB_READY);
+        pthread_mutex_unlock(&queue->lock);
+        // Решение коллективное: начинается, только если строки готовы на всех процессах
+        ierr = MPI_Allreduce(MPI_IN_PLACE, &ready, 1, MPI_INT, MPI_LAND, PETSC_COMM_WORLD); CHKERRMPI(ierr);
+        if (ready) { ierr = solve_queue_run_next(queue); CHKERRQ(ierr); }
+    }
+    *done = solve_queue_job_done(queue, handle);
+    return 0;
+}
+
+PetscErrorCode solve_queue_wait(SolveQueue *queue, PetscInt handle, SolverResult *result) {
+    PetscErrorCode ierr;
+    
+    if (handle < 0 || handle >= queue->njobs) SETERRQ(PETSC_COMM_SELF, PETSC_ERR_ARG_OUTOFRANGE, "Unknown solve handle");
+    while (!solve_queue_job_done(queue, handle)) {
+        ierr = solve_queue_run_next(queue); CHKERRQ(ierr);
+    }
+    if (result) *result = queue->jobs[handle]->result;
+    return 0;
+}
+
+PetscErrorCode solve_queue_get_stats(SolveQueue *queue, SolveQueueStats *stats) {
+    *stats = queue->stats;
+    return 0;
+}
+
+PetscErrorCode solve_queue_print_stats(SolveQueue *queue) {
+    const SolveQueueStats *s = &queue->stats;
+    
+    PetscPrintf(PETSC_COMM_WORLD, "=== Solve Queue ===\n");
+    PetscPrintf(PETSC_COMM_WORLD, "Jobs: %" PetscInt_FMT "\n", s->jobs);
+    PetscPrintf(PETSC_COMM_WORLD, "Background assembly: %g seconds\n", s->assembly_time);
+    PetscPrintf(PETSC_COMM_WORLD, "Setup and solve: %g seconds\n", s->solve_time);
+    PetscPrintf(PETSC_COMM_WORLD, "Overlapped: %g seconds (%.1f%% of assembly hidden)\n", s->overlap_time,
+                s->assembly_time > 0.0 ? 100.0 * s->overlap_time / s->assembly_time : 0.0);
+    PetscPrintf(PETSC_COMM_WORLD, "Wall time: %g seconds\n", s->wall_time);
+    return 0;
+}
+
+PetscErrorCode solve_queue_destroy(SolveQueue *queue) {
+    PetscErrorCode ierr;
+    PetscInt k;
+    
+    pthread_mutex_lock(&queue->lock);
+    queue->shutdown = PETSC_TRUE;
+    pthread_cond_broadcast(&queue->cond);
+    pthread_mutex_unlock(&queue->lock);
+    pthread_join(queue->worker, NULL);
+    pthread_cond_destroy(&queue->cond);
+    pthread_mutex_destroy(&queue->lock);
+    
+    // Незавершённые задания отбрасываются
+    for (k = 0; k < queue->njobs; k++) {
+        row_chunk_free(&queue->jobs[k]->rows);
+        ierr = PetscFree(queue->jobs[k]); CHKERRQ(ierr);
+    }
+    ierr = PetscFree(queue->jobs); CHKERRQ(ierr);
+    return 0;
+}
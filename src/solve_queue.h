@@ -0,0 +1,73 @@
+#ifndef SOLVE_QUEUE_H
+#define SOLVE_QUEUE_H
+
+#include <pthread.h>
+#include "solver.h"
+#include "matrix_utils.h"
+
+// Асинхронная очередь решений. Матрицы, заданные генератором строк, собираются
+// в фоновом потоке, пока решается предыдущая система. Все вызовы PETSc
+// (вставка в матрицу, настройка PC, KSPSolve) идут в вызывающем потоке внутри
+// solve_queue_poll/solve_queue_wait: PETSc не потокобезопасен. Вызовы
+// коллективные: все процессы отправляют задания и ждут их в одном порядке.
+
+typedef enum {
+    SOLVE_JOB_QUEUED,           // ждёт фоновой сборки
+    SOLVE_JOB_ASSEMBLING,
+    SOLVE_JOB_READY,            // строки готовы или матрица передана собранной
+    SOLVE_JOB_DONE
+} SolveJobState;
+
+typedef struct {
+    SolveJobState state;
+    Mat A;                      // собранная матрица; для генератора - создаётся перед решением
+    PetscBool owns_matrix;
+    Vec b, x;
+    // Генератор строк (row_fn == NULL - матрица передана собранной)
+    PetscInt n, nlocal, rstart, max_row_nnz;
+    MatRowFunction row_fn;
+    void *ctx;
+    RowChunk rows;
+    PetscLogDouble assembly_start, assembly_end;    // фоновая сборка строк
+    PetscLogDouble solve_start, solve_end;          // вставка, настройка и решение
+    SolverResult result;
+} SolveJob;
+
+// Время: assembly - фоновая генерация строк, solve - работа вызывающего потока
+// (вставка, настройка PC, решение), overlap - время, когда оба шли одновременно
+typedef struct {
+    PetscInt jobs;
+    PetscLogDouble assembly_time;
+    PetscLogDouble solve_time;
+    PetscLogDouble overlap_time;
+    PetscLogDouble wall_time;   // от первой отправки до последнего завершения
+} SolveQueueStats;
+
+typedef struct {
+    SolverConfig config;
+    PetscBool has_config;
+    SolveJob **jobs;            // задания по отдельности: фоновый поток держит указатель при росте массива
+    PetscInt njobs, capacity;
+    PetscInt next_assembly;     // первое задание, которое ещё не взял фоновый поток
+    PetscInt next_solve;        // первое нерешённое задание
+    PetscBool shutdown;
+    pthread_t worker;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    PetscLogDouble first_submit;
+    SolveQueueStats stats;
+} SolveQueue;
+
+// config == NULL - настройки решателя по умолчанию
+PetscErrorCode solve_queue_create(SolveQueue *queue, const SolverConfig *config);
+PetscErrorCode solve_queue_submit(SolveQueue *queue, Mat A, Vec b, Vec x, PetscInt *handle);
+PetscErrorCode solve_queue_submit_rows(SolveQueue *queue, PetscInt n, PetscInt max_row_nnz, MatRowFunction row_fn, void *ctx,
+                                       Vec b, Vec x, PetscInt *handle);
+// poll решает не более одного готового задания и сообщает, завершено ли handle
+PetscErrorCode solve_queue_poll(SolveQueue *queue, PetscInt handle, PetscBool *done);
+PetscErrorCode solve_queue_wait(SolveQueue *queue, PetscInt handle, SolverResult *result);
+PetscErrorCode solve_queue_get_stats(SolveQueue *queue, SolveQueueStats *stats);
+PetscErrorCode solve_queue_print_stats(SolveQueue *queue);
+PetscErrorCode solve_queue_destroy(SolveQueue *queue);
+
+#endif
@@ -1,35 +1,54 @@
 #include "solver.h"
+#include "threading.h"
+#include "workspace_pool.h"
 #include <petsctime.h>
 
+// Сквозной номер решения для имён файлов отчётов
+static PetscInt solve_report_count = 0;
+
 PetscErrorCode solver_initialize(int argc, char **argv) {
     PetscErrorCode ierr;
     ierr = PetscInitialize(&argc, &argv, NULL, NULL); CHKERRQ(ierr);
     PetscPrintf(PETSC_COMM_WORLD, "=== PETSc GMRES Solver Initialized ===\n");
+    PetscPrintf(PETSC_COMM_WORLD, "Threads per rank: %" PetscInt_FMT "\n", solver_threads_count());
     return 0;
 }
 
 PetscErrorCode solver_finalize() {
     PetscErrorCode ierr;
+    WorkspaceStats stats;
+    ierr = workspace_get_stats(&stats); CHKERRQ(ierr);
+    if (stats.reuses > 0) { ierr = workspace_print_stats(); CHKERRQ(ierr); }
     PetscPrintf(PETSC_COMM_WORLD, "=== PETSc GMRES Solver Finalized ===\n");
     ierr = PetscFinalize();
     return ierr;
 }
 
-PetscErrorCode solver_create(LinearSolver *solver, Mat A) {
+// trial: пробный решатель подбора конфигурации (solver_create_trial)
+static PetscErrorCode solver_create_internal(LinearSolver *solver, Mat A, Vec x, Vec b, PetscBool trial) {
     PetscErrorCode ierr;
+    PetscBool report, checkpoint;
+    char checkpoint_prefix[PETSC_MAX_PATH_LEN] = "";
+    PetscLayout cmap;
+    DM dm;
     
     solver->A = A;
     ierr = MatGetSize(A, &solver->matrix_size, NULL); CHKERRQ(ierr);
     
-    // Создание векторов
-    ierr = VecCreate(PETSC_COMM_WORLD, &solver->b); CHKERRQ(ierr);
-    ierr = VecSetSizes(solver->b, PETSC_DECIDE, solver->matrix_size); CHKERRQ(ierr);
-    ierr = VecSetFromOptions(solver->b); CHKERRQ(ierr);
-    
-    ierr = VecDuplicate(solver->b, &solver->x); CHKERRQ(ierr);
+    // Векторы вызывающего решатель держит по ссылке
+    ierr = PetscObjectReference((PetscObject)x); CHKERRQ(ierr);
+    ierr = PetscObjectReference((PetscObject)b); CHKERRQ(ierr);
+    solver->x = x;
+    solver->b = b;
+    solver->x_work = NULL;
+    solver->b_work = NULL;
+    solver->A_csr = NULL;
+    ierr = solver_threads_enable_spmv(A); CHKERRQ(ierr);
     
-    // Создание решателя KSP
-    ierr = KSPCreate(PETSC_COMM_WORLD, &solver->ksp); CHKERRQ(ierr);
+    // Решатель KSP из пула сохраняет базис Крылова, выделенный прошлым решателем.
+    // Коммуникатор - матрицы: в ансамбле (ensemble.h) это коммуникатор группы
+    ierr = MatGetLayouts(A, NULL, &cmap); CHKERRQ(ierr);
+    ierr = workspace_get_ksp(PetscObjectComm((PetscObject)A), cmap, &solver->ksp, &solver->ksp_reused); CHKERRQ(ierr);
     ierr = KSPSetOperators(solver->ksp, A, A); CHKERRQ(ierr);
     ierr = KSPSetType(solver->ksp, KSPGMRES); CHKERRQ(ierr);
     
@@ -42,13 +61,324 @@ PetscErrorCode solver_create(LinearSolver *solver, Mat A) {
     solver->iterations = 0;
     solver->residual = 0.0;
     solver->solve_time = 0.0;
+    solver->setup_time = 0.0;
+    solver->report = NULL;
+    solver->gmres_variant = SOLVER_GMRES_CLASSICAL;
+    solver->restart = 0;
+    solver->reductions = 0.0;
+    solver->fallbacks = 0;
+    solver->pipelined_variant = SOLVER_GMRES_PIPELINED;
+    solver->pipelined_suspended = 0;
+    solver->A_single = NULL;
+    solver->mixed_inner_rtol = 1e-4;
+    solver->outer_iterations = 0;
+    solver->outer_converged = PETSC_FALSE;
+    solver->dm = NULL;
+    solver->reorder_type[0] = '\0';
+    solver->A_natural = NULL;
+    solver->perm = NULL;
+    solver->b_perm = NULL;
+    solver->x_perm = NULL;
+    solver->reorder_time = 0.0;
+    solver->spmv_time_natural = 0.0;
+    solver->spmv_time_reordered = 0.0;
+    solver->reorder_compare = PETSC_FALSE;
+    solver->reorder_its_natural = 0;
+    solver->reorder_its_reordered = 0;
+    solver->tune_format = PETSC_FALSE;
+    solver->A_format = NULL;
+    solver->spmv_format[0] = '\0';
+    solver->spmv_block_size = 1;
+    solver->spmv_gbs = 0.0;
+    solver->guess_type = SOLVER_GUESS_ZERO;
+    solver->guess_size = 0;
+    solver->memory_budget = 0.0;
+    solver->restart_max = 0;
+    solver->restart_adaptive = PETSC_FALSE;
+    solver->nlocal_max = 0;
+    solver->krylov_memory = 0.0;
+    solver->tune_config = PETSC_FALSE;
+    solver->tuned_ksp[0] = '\0';
+    solver->tuned_pc[0] = '\0';
+    solver->tuned_restart = 0;
+    solver->tune_cache_hit = PETSC_FALSE;
+    solver->tune_time = 0.0;
+    solver->checkpoint = NULL;
+    solver->checkpoint_time = 0.0;
+    ierr = PetscOptionsGetReal(NULL, NULL, "-mixed_inner_rtol", &solver->mixed_inner_rtol, NULL); CHKERRQ(ierr);
+    
+    // Пробные решения подбора идут без отчётов, снимков, перестановки (A уже переставлена),
+    // выбора формата, подбора и бюджета памяти
+    if (!trial) {
+        ierr = PetscOptionsGetString(NULL, NULL, "-solver_reorder", solver->reorder_type, sizeof(solver->reorder_type), NULL); CHKERRQ(ierr);
+        ierr = PetscOptionsGetBool(NULL, NULL, "-solver_reorder_compare", &solver->reorder_compare, NULL); CHKERRQ(ierr);
+        ierr = PetscOptionsGetBool(NULL, NULL, "-solver_tune_format", &solver->tune_format, NULL); CHKERRQ(ierr);
+        ierr = PetscOptionsGetBool(NULL, NULL, "-solver_tune", &solver->tune_config, NULL); CHKERRQ(ierr);
+        ierr = PetscOptionsGetReal(NULL, NULL, "-solver_memory_budget", &solver->memory_budget, NULL); CHKERRQ(ierr);
+        ierr = PetscOptionsHasName(NULL, NULL, "-solver_report", &report); CHKERRQ(ierr);
+        if (report) { ierr = solve_report_create(solver->ksp, &solver->report); CHKERRQ(ierr); }
+        ierr = PetscOptionsGetString(NULL, NULL, "-solver_checkpoint", checkpoint_prefix, sizeof(checkpoint_prefix), &checkpoint); CHKERRQ(ierr);
+        if (checkpoint) {
+            PetscInt interval = CHECKPOINT_DEFAULT_INTERVAL;
+            PetscBool resume = PETSC_FALSE;
+            ierr = PetscOptionsGetInt(NULL, NULL, "-solver_checkpoint_interval", &interval, NULL); CHKERRQ(ierr);
+            ierr = PetscOptionsGetBool(NULL, NULL, "-solver_resume", &resume, NULL); CHKERRQ(ierr);
+            ierr = solver_set_checkpoint(solver, checkpoint_prefix[0] ? checkpoint_prefix : "checkpoint", interval); CHKERRQ(ierr);
+            ierr = solver_set_resume(solver, resume); CHKERRQ(ierr);
+        }
+    }
+    
+    // Матрица из DMCreateMatrix несёт свою сетку
+    ierr = MatGetDM(A, &dm); CHKERRQ(ierr);
+    if (dm) { ierr = solver_set_dm(solver, dm); CHKERRQ(ierr); }
+    
+    return 0;
+}
+
+static PetscErrorCode solver_create_pooled(LinearSolver *solver, Mat A, PetscBool trial) {
+    PetscErrorCode ierr;
+    PetscLayout rmap, cmap;
+    Vec *x_work, *b_work;
+    
+    // Векторы из пула: разбиение берётся из матрицы (у DMDA оно не совпадает с PETSC_DECIDE)
+    ierr = MatGetLayouts(A, &rmap, &cmap); CHKERRQ(ierr);
+    ierr = workspace_get_vecs(PetscObjectComm((PetscObject)A), cmap, 1, &x_work); CHKERRQ(ierr);
+    ierr = workspace_get_vecs(PetscObjectComm((PetscObject)A), rmap, 1, &b_work); CHKERRQ(ierr);
+    ierr = solver_create_internal(solver, A, x_work[0], b_work[0], trial); CHKERRQ(ierr);
+    
+    // Набор из пула возвращается целиком в solver_destroy, отдельные ссылки не нужны
+    ierr = PetscObjectDereference((PetscObject)x_work[0]); CHKERRQ(ierr);
+    ierr = PetscObjectDereference((PetscObject)b_work[0]); CHKERRQ(ierr);
+    solver->x_work = x_work;
+    solver->b_work = b_work;
+    return 0;
+}
+
+PetscErrorCode solver_create(LinearSolver *solver, Mat A) {
+    PetscErrorCode ierr;
+    ierr = solver_create_pooled(solver, A, PETSC_FALSE); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode solver_create_trial(LinearSolver *solver, Mat A) {
+    PetscErrorCode ierr;
+    ierr = solver_create_pooled(solver, A, PETSC_TRUE); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode solver_create_with_vectors(LinearSolver *solver, Mat A, Vec x, Vec b) {
+    PetscErrorCode ierr;
+    ierr = solver_create_internal(solver, A, x, b, PETSC_FALSE); CHKERRQ(ierr);
+    return 0;
+}
+
+// Число уровней: сетка огрубляется вдвое, пока (M - 1) чётно по всем направлениям,
+// на грубой сетке остаётся не меньше 3 узлов, а у каждого процесса - не меньше 2
+static PetscErrorCode solver_multigrid_levels(DM dm, PetscInt *levels) {
+    PetscErrorCode ierr;
+    PetscInt dim, M[3], procs[3], d, i;
+    const PetscInt *ranges[3];
+    PetscInt min_local[3];
+    PetscBool coarsen = PETSC_TRUE;
+    
+    ierr = DMDAGetInfo(dm, &dim, &M[0], &M[1], &M[2], &procs[0], &procs[1], &procs[2], NULL, NULL, NULL, NULL, NULL, NULL); CHKERRQ(ierr);
+    ierr = DMDAGetOwnershipRanges(dm, &ranges[0], &ranges[1], &ranges[2]); CHKERRQ(ierr);
+    for (d = 0; d < dim; d++) {
+        min_local[d] = M[d];
+        for (i = 0; i < procs[d]; i++) min_local[d] = PetscMin(min_local[d], ranges[d][i]);
+    }
+    
+    *levels = 1;
+    while (coarsen && *levels < SOLVER_MG_MAX_LEVELS) {
+        for (d = 0; d < dim; d++) {
+            if ((M[d] - 1) % 2 != 0 || (M[d] - 1) / 2 + 1 < 3 || min_local[d] / 2 < 2) coarsen = PETSC_FALSE;
+        }
+        if (!coarsen) break;
+        for (d = 0; d < dim; d++) {
+            M[d] = (M[d] - 1) / 2 + 1;
+            min_local[d] /= 2;
+        }
+        (*levels)++;
+    }
+    
+    return 0;
+}
+
+static PetscErrorCode solver_configure_multigrid(LinearSolver *solver) {
+    PetscErrorCode ierr;
+    PetscInt levels;
+    
+    if (!solver->dm) SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_ARG_WRONGSTATE, "Geometric multigrid requires a structured grid: use create_poisson_grid_matrix or solver_set_dm");
+    
+    ierr = solver_multigrid_levels(solver->dm, &levels); CHKERRQ(ierr);
+    ierr = PetscOptionsGetInt(NULL, NULL, "-pc_mg_levels", &levels, NULL); CHKERRQ(ierr);
+    
+    // Интерполяция - из DMDA, грубые операторы - P^T A P, поэтому хватает матрицы на мелкой сетке
+    ierr = PCMGSetLevels(solver->pc, levels, NULL); CHKERRQ(ierr);
+    ierr = PCMGSetGalerkin(solver->pc, PC_MG_GALERKIN_BOTH); CHKERRQ(ierr);
     
     return 0;
 }
 
 PetscErrorCode solver_set_preconditioner(LinearSolver *solver, PCType pc_type) {
     PetscErrorCode ierr;
+    PetscBool is_mg;
+    
     ierr = PCSetType(solver->pc, pc_type); CHKERRQ(ierr);
+    ierr = PetscStrcmp(pc_type, PCMG, &is_mg); CHKERRQ(ierr);
+    if (is_mg) { ierr = solver_configure_multigrid(solver); CHKERRQ(ierr); }
+    return 0;
+}
+
+PetscErrorCode solver_set_dm(LinearSolver *solver, DM dm) {
+    PetscErrorCode ierr;
+    
+    solver->dm = dm;
+    // Операторы задаются явно, DM нужен только для иерархии сеток
+    ierr = KSPSetDM(solver->ksp, dm); CHKERRQ(ierr);
+    ierr = KSPSetDMActive(solver->ksp, PETSC_FALSE); CHKERRQ(ierr);
+    
+    return 0;
+}
+
+PetscErrorCode solver_set_ksp_type(LinearSolver *solver, KSPType ksp_type) {
+    PetscErrorCode ierr;
+    ierr = KSPSetType(solver->ksp, ksp_type); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode solver_set_gmres_variant(LinearSolver *solver, SolverGMRESVariant variant) {
+    PetscErrorCode ierr;
+    
+    switch (variant) {
+    case SOLVER_GMRES_CLASSICAL:
+        // Одна редукция на проекцию, вторая - только если CGS потерял ортогональность
+        ierr = KSPSetType(solver->ksp, KSPGMRES); CHKERRQ(ierr);
+        ierr = KSPGMRESSetOrthogonalization(solver->ksp, KSPGMRESClassicalGramSchmidtOrthogonalization); CHKERRQ(ierr);
+        ierr = KSPGMRESSetCGSRefinementType(solver->ksp, KSP_GMRES_CGS_REFINE_IFNEEDED); CHKERRQ(ierr);
+        break;
+    case SOLVER_GMRES_MODIFIED:
+        ierr = KSPSetType(solver->ksp, KSPGMRES); CHKERRQ(ierr);
+        ierr = KSPGMRESSetOrthogonalization(solver->ksp, KSPGMRESModifiedGramSchmidtOrthogonalization); CHKERRQ(ierr);
+        break;
+    case SOLVER_GMRES_PIPELINED:
+        ierr = KSPSetType(solver->ksp, KSPPGMRES); CHKERRQ(ierr);
+        break;
+    case SOLVER_GMRES_PIPELINED_FLEXIBLE:
+        // Гибкий вариант работает только с правым предобуславливанием
+        ierr = KSPSetType(solver->ksp, KSPPIPEFGMRES); CHKERRQ(ierr);
+        ierr = KSPSetPCSide(solver->ksp, PC_RIGHT); CHKERRQ(ierr);
+        break;
+    default:
+        SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Unknown GMRES variant");
+    }
+    solver->gmres_variant = variant;
+    solver->pipelined_suspended = 0;
+    
+    // Смена типа KSP сбрасывает длину рестарта
+    if (solver->restart > 0) { ierr = KSPGMRESSetRestart(solver->ksp, solver->restart); CHKERRQ(ierr); }
+    return 0;
+}
+
+PetscErrorCode solver_gmres_variant_from_string(const char *name, SolverGMRESVariant *variant, PetscBool *found) {
+    PetscErrorCode ierr;
+    static const char *names[] = {"classical", "modified", "pipelined", "pipefgmres"};
+    PetscInt i;
+    
+    *found = PETSC_FALSE;
+    for (i = 0; i < 4; i++) {
+        ierr = PetscStrcmp(name, names[i], found); CHKERRQ(ierr);
+        if (*found) {
+            *variant = (SolverGMRESVariant)i;
+            break;
+        }
+    }
+    return 0;
+}
+
+PetscErrorCode solver_set_restart(LinearSolver *solver, PetscInt restart) {
+    PetscErrorCode ierr;
+    // Для методов не из семейства GMRES вызов игнорируется
+    ierr = KSPGMRESSetRestart(solver->ksp, restart); CHKERRQ(ierr);
+    solver->restart = restart;
+    return 0;
+}
+
+PetscErrorCode solver_set_initial_guess(LinearSolver *solver, SolverGuessType type, PetscInt size) {
+    PetscErrorCode ierr;
+    KSPGuess guess;
+    
+    if (solver->guess_type == SOLVER_GUESS_FISCHER && type != SOLVER_GUESS_FISCHER) {
+        SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_ARG_WRONGSTATE, "Initial guess projection cannot be disabled once enabled");
+    }
+    // Внутренний KSP смешанной точности решает уравнение для поправки, прошлые решения ему не подходят
+    if (solver->A_single && type == SOLVER_GUESS_FISCHER) {
+        SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_SUP, "Initial guess projection is not supported with mixed precision");
+    }
+    
+    switch (type) {
+    case SOLVER_GUESS_ZERO:
+        ierr = KSPSetInitialGuessNonzero(solver->ksp, PETSC_FALSE); CHKERRQ(ierr);
+        break;
+    case SOLVER_GUESS_LAST:
+        ierr = KSPSetInitialGuessNonzero(solver->ksp, PETSC_TRUE); CHKERRQ(ierr);
+        break;
+    case SOLVER_GUESS_FISCHER:
+        if (size < 1) SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Initial guess subspace size must be positive");
+        // Модель 1: хранятся решения x_i и A x_i, приближение - A-ортогональная проекция
+        ierr = KSPGetGuess(solver->ksp, &guess); CHKERRQ(ierr);
+        ierr = KSPGuessSetType(guess, KSPGUESSFISCHER); CHKERRQ(ierr);
+        ierr = KSPGuessFischerSetModel(guess, 1, size); CHKERRQ(ierr);
+        break;
+    default:
+        SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "Unknown initial guess type");
+    }
+    solver->guess_type = type;
+    solver->guess_size = (type == SOLVER_GUESS_FISCHER) ? size : 0;
+    return 0;
+}
+
+PetscErrorCode solver_set_checkpoint(LinearSolver *solver, const char *prefix, PetscInt interval) {
+    PetscErrorCode ierr;
+    ierr = checkpoint_create(solver->ksp, solver->x, prefix, interval, &solver->checkpoint); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode solver_set_resume(LinearSolver *solver, PetscBool resume) {
+    if (!solver->checkpoint) SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_ARG_WRONGSTATE, "Resume requires checkpoints: call solver_set_checkpoint first");
+    solver->checkpoint->resume = resume;
+    return 0;
+}
+
+PetscErrorCode solver_guess_type_from_string(const char *name, SolverGuessType *type, PetscBool *found) {
+    PetscErrorCode ierr;
+    static const char *names[] = {"none", "last", "fischer"};
+    PetscInt i;
+    
+    *found = PETSC_FALSE;
+    for (i = 0; i < 3; i++) {
+        ierr = PetscStrcmp(name, names[i], found); CHKERRQ(ierr);
+        if (*found) {
+            *type = (SolverGuessType)i;
+            break;
+        }
+    }
+    return 0;
+}
+
+PetscErrorCode solver_configure(LinearSolver *solver, const SolverConfig *config) {
+    PetscErrorCode ierr;
+    SolverGMRESVariant variant;
+    PetscBool is_variant = PETSC_FALSE;
+    
+    if (config->ksp_type) { ierr = solver_gmres_variant_from_string(config->ksp_type, &variant, &is_variant); CHKERRQ(ierr); }
+    if (is_variant) {
+        ierr = solver_set_gmres_variant(solver, variant); CHKERRQ(ierr);
+    } else if (config->ksp_type) {
+        ierr = solver_set_ksp_type(solver, config->ksp_type); CHKERRQ(ierr);
+    }
+    if (config->pc_type) { ierr = solver_set_preconditioner(solver, config->pc_type); CHKERRQ(ierr); }
+    if (config->restart > 0) { ierr = solver_set_restart(solver, config->restart); CHKERRQ(ierr); }
     return 0;
 }
 
@@ -58,51 +388,241 @@ PetscErrorCode solver_set_tolerances(LinearSolver *solver, PetscReal rtol, Petsc
     return 0;
 }
 
+// Подготовка оператора перед первым KSPSetUp: общая для solver_setup и первого решения сессии
+static PetscErrorCode solver_prepare_operator(LinearSolver *solver) {
+    PetscErrorCode ierr;
+    ierr = solver_apply_reordering(solver); CHKERRQ(ierr);
+    ierr = solver_tune_config(solver); CHKERRQ(ierr);
+    ierr = solver_tune_format(solver); CHKERRQ(ierr);
+    ierr = solver_apply_memory_budget(solver); CHKERRQ(ierr);
+    return 0;
+}
+
 PetscErrorCode solver_setup(LinearSolver *solver) {
     PetscErrorCode ierr;
+    PetscLogDouble start_time, end_time;
+    
+    ierr = solver_log_setup_begin(); CHKERRQ(ierr);
+    ierr = PetscTime(&start_time); CHKERRQ(ierr);
+    ierr = solver_prepare_operator(solver); CHKERRQ(ierr);
     ierr = KSPSetUp(solver->ksp); CHKERRQ(ierr);
+    ierr = PetscTime(&end_time); CHKERRQ(ierr);
+    ierr = solver_log_setup_end(); CHKERRQ(ierr);
+    
+    solver->setup_time = end_time - start_time;
+    return 0;
+}
+
+PetscErrorCode solver_get_reduction_count(PetscLogDouble *count) {
+    // Счётчик MPIU_Allreduce/MPIU_Iallreduce ведётся PETSc только при сборке с логированием
+#if defined(PETSC_USE_LOG)
+    *count = petsc_allreduce_ct;
+#else
+    *count = 0.0;
+#endif
+    return 0;
+}
+
+// Конвейерные варианты обновляют невязку рекуррентно, и при потере ортогональности
+// она расходится с истинной. Истинная невязка сравнивается в той норме, по которой
+// KSP проверял сходимость (с левым предобуславливателем - B(b - A x) против B b).
+// Если она не достигла цели или метод сломался, решение продолжается классическим
+// GMRES с текущего приближения; следующие SOLVER_PIPELINED_RETRY решений тоже идут
+// классическим, затем конвейерный вариант пробуется снова.
+static PetscErrorCode solver_pipelined_safeguard(LinearSolver *solver, Vec b, Vec x) {
+    PetscErrorCode ierr;
+    KSPConvergedReason reason;
+    KSPNormType norm_type;
+    PCSide side;
+    PetscReal rtol, atol, dtol, rnorm, bnorm;
+    PetscInt maxits, its;
+    PetscBool guess_nonzero, fallback;
+    SolverGMRESVariant variant = solver->gmres_variant;
+    PetscLayout map;
+    Vec *r;
+    
+    ierr = KSPGetConvergedReason(solver->ksp, &reason); CHKERRQ(ierr);
+    ierr = KSPGetTolerances(solver->ksp, &rtol, &atol, &dtol, &maxits); CHKERRQ(ierr);
+    ierr = KSPGetNormType(solver->ksp, &norm_type); CHKERRQ(ierr);
+    ierr = KSPGetPCSide(solver->ksp, &side); CHKERRQ(ierr);
+    
+    ierr = VecGetLayout(b, &map); CHKERRQ(ierr);
+    ierr = workspace_get_vecs(PetscObjectComm((PetscObject)b), map, 2, &r); CHKERRQ(ierr);
+    ierr = MatMult(solver->A, x, r[0]); CHKERRQ(ierr);
+    ierr = VecAYPX(r[0], -1.0, b); CHKERRQ(ierr);
+    if (norm_type == KSP_NORM_PRECONDITIONED && side == PC_LEFT) {
+        ierr = PCApply(solver->pc, r[0], r[1]); CHKERRQ(ierr);
+        ierr = VecNorm(r[1], NORM_2, &rnorm); CHKERRQ(ierr);
+        ierr = PCApply(solver->pc, b, r[1]); CHKERRQ(ierr);
+        ierr = VecNorm(r[1], NORM_2, &bnorm); CHKERRQ(ierr);
+    } else {
+        ierr = VecNorm(r[0], NORM_2, &rnorm); CHKERRQ(ierr);
+        ierr = VecNorm(b, NORM_2, &bnorm); CHKERRQ(ierr);
+    }
+    ierr = workspace_return_vecs(2, &r); CHKERRQ(ierr);
+    
+    // Без нормы (KSP_NORM_NONE) сходимость не проверялась, остаются только поломки
+    fallback = (PetscBool)((reason > 0 && norm_type != KSP_NORM_NONE &&
+                            rnorm > SOLVER_PIPELINED_RESIDUAL_GAP * PetscMax(rtol * bnorm, atol)) ||
+                           reason == KSP_DIVERGED_BREAKDOWN || reason == KSP_DIVERGED_NANORINF ||
+                           PetscIsInfOrNanReal(rnorm));
+    if (!fallback) return 0;
+    
+    ierr = PetscInfo(solver->ksp, "Pipelined GMRES true residual %g (reason %d), falling back to classical GMRES\n",
+                     (double)rnorm, (int)reason); CHKERRQ(ierr);
+    if (PetscIsInfOrNanReal(rnorm)) { ierr = VecSet(x, 0.0); CHKERRQ(ierr); }
+    
+    ierr = solver_set_gmres_variant(solver, SOLVER_GMRES_CLASSICAL); CHKERRQ(ierr);
+    solver->pipelined_variant = variant;
+    solver->pipelined_suspended = SOLVER_PIPELINED_RETRY;
+    ierr = KSPGetInitialGuessNonzero(solver->ksp, &guess_nonzero); CHKERRQ(ierr);
+    ierr = KSPSetInitialGuessNonzero(solver->ksp, PETSC_TRUE); CHKERRQ(ierr);
+    ierr = KSPSolve(solver->ksp, b, x); CHKERRQ(ierr);
+    ierr = KSPSetInitialGuessNonzero(solver->ksp, guess_nonzero); CHKERRQ(ierr);
+    
+    ierr = KSPGetIterationNumber(solver->ksp, &its); CHKERRQ(ierr);
+    solver->iterations += its;
+    solver->fallbacks++;
     return 0;
 }
 
 PetscErrorCode solver_solve(LinearSolver *solver, Vec b, Vec x) {
     PetscErrorCode ierr;
-    PetscLogDouble start_time, end_time;
+    PetscLogDouble start_time, end_time, red_start, red_end, checkpoint_overhead = 0.0;
+    PetscBool guess_nonzero = PETSC_FALSE;
+    Vec x_natural = x;
     
+    ierr = solver_log_solve_begin(); CHKERRQ(ierr);
+    if (solver->report) { ierr = solve_report_begin(solver->report); CHKERRQ(ierr); }
+    ierr = solver_get_reduction_count(&red_start); CHKERRQ(ierr);
     ierr = PetscTime(&start_time); CHKERRQ(ierr);
-    ierr = KSPSolve(solver->ksp, b, x); CHKERRQ(ierr);
+    if (solver->A_natural) {
+        // Решается переставленная система: b и начальное приближение в порядке perm
+        ierr = VecCopy(b, solver->b_perm); CHKERRQ(ierr);
+        ierr = VecPermute(solver->b_perm, solver->perm, PETSC_FALSE); CHKERRQ(ierr);
+        ierr = VecCopy(x, solver->x_perm); CHKERRQ(ierr);
+        ierr = VecPermute(solver->x_perm, solver->perm, PETSC_FALSE); CHKERRQ(ierr);
+        b = solver->b_perm;
+        x = solver->x_perm;
+    }
+    if (solver->checkpoint) {
+        // Внутренний KSP смешанной точности решает уравнение для поправки, а не для x
+        if (solver->A_single) SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_SUP, "Checkpoints are not supported with mixed precision");
+        checkpoint_overhead = solver->checkpoint->stats.overhead;
+        ierr = checkpoint_begin(solver->checkpoint, solver->ksp, x, &guess_nonzero); CHKERRQ(ierr);
+    }
+    if (solver->A_single) {
+        ierr = solver_solve_mixed(solver, b, x); CHKERRQ(ierr);
+    } else if (solver->restart_adaptive) {
+        ierr = solver_solve_budgeted(solver, b, x); CHKERRQ(ierr);
+    } else {
+        ierr = KSPSolve(solver->ksp, b, x); CHKERRQ(ierr);
+        ierr = KSPGetIterationNumber(solver->ksp, &solver->iterations); CHKERRQ(ierr);
+        if (solver->gmres_variant == SOLVER_GMRES_PIPELINED || solver->gmres_variant == SOLVER_GMRES_PIPELINED_FLEXIBLE) {
+            ierr = solver_pipelined_safeguard(solver, b, x); CHKERRQ(ierr);
+        } else if (solver->pipelined_suspended > 0 && --solver->pipelined_suspended == 0) {
+            // Переход был временным: со следующего решения снова конвейерный вариант
+            ierr = solver_set_gmres_variant(solver, solver->pipelined_variant); CHKERRQ(ierr);
+        }
+        ierr = KSPGetResidualNorm(solver->ksp, &solver->residual); CHKERRQ(ierr);
+    }
+    if (solver->checkpoint) {
+        ierr = checkpoint_end(solver->checkpoint, solver->ksp, guess_nonzero); CHKERRQ(ierr);
+        solver->checkpoint_time = solver->checkpoint->stats.overhead - checkpoint_overhead;
+    }
+    if (solver->A_natural) {
+        ierr = VecPermute(x, solver->perm, PETSC_TRUE); CHKERRQ(ierr);
+        ierr = VecCopy(x, x_natural); CHKERRQ(ierr);
+    }
     ierr = PetscTime(&end_time); CHKERRQ(ierr);
+    ierr = solver_get_reduction_count(&red_end); CHKERRQ(ierr);
+    // Рестарт внутри решения только растёт, поэтому текущий - пиковый
+    ierr = solver_krylov_memory(solver, &solver->krylov_memory); CHKERRQ(ierr);
     
     // Сохранение информации о решении
-    ierr = KSPGetIterationNumber(solver->ksp, &solver->iterations); CHKERRQ(ierr);
-    ierr = KSPGetResidualNorm(solver->ksp, &solver->residual); CHKERRQ(ierr);
     solver->solve_time = end_time - start_time;
+    solver->reductions = red_end - red_start;
+    
+    if (solver->report) {
+        char prefix[PETSC_MAX_PATH_LEN] = "solve_report", filename[PETSC_MAX_PATH_LEN];
+        ierr = solve_report_end(solver->report); CHKERRQ(ierr);
+        ierr = PetscOptionsGetString(NULL, NULL, "-solver_report", prefix, sizeof(prefix), NULL); CHKERRQ(ierr);
+        ierr = PetscSNPrintf(filename, sizeof(filename), "%s_%" PetscInt_FMT ".json", prefix, solve_report_count++); CHKERRQ(ierr);
+        ierr = solve_report_write(solver->report, solver->ksp, solver->setup_time, solver->solve_time, filename); CHKERRQ(ierr);
+    }
+    ierr = solver_log_solve_end(); CHKERRQ(ierr);
     
     return 0;
 }
 
 PetscErrorCode solver_solve_with_result(LinearSolver *solver, Vec b, Vec x, SolverResult *result) {
     PetscErrorCode ierr;
+    PetscBool has_info;
     
     ierr = solver_solve(solver, b, x); CHKERRQ(ierr);
     
     // Заполнение структуры результата
+    ierr = MatHasOperation(solver->A, MATOP_GET_INFO, &has_info); CHKERRQ(ierr);
+    result->nonzeros = 0;
+    if (has_info) {
+        MatInfo info;
+        ierr = MatGetInfo(solver->A, MAT_GLOBAL_SUM, &info); CHKERRQ(ierr);
+        result->nonzeros = (PetscInt)info.nz_used;
+    }
     result->matrix_size = solver->matrix_size;
     result->iterations = solver->iterations;
     result->residual = solver->residual;
+    // Сборку матрицы решатель не видит: время заполняет вызывающий (бенчмарк, очередь решений)
+    result->assembly_time = 0.0;
+    result->setup_time = solver->setup_time;
     result->solve_time = solver->solve_time;
+    result->reductions = solver->reductions;
+    result->reorder_time = solver->reorder_time;
+    result->reorder_its_natural = solver->reorder_its_natural;
+    result->reorder_its_reordered = solver->reorder_its_reordered;
+    ierr = PetscStrncpy(result->spmv_format, solver->spmv_format, sizeof(result->spmv_format)); CHKERRQ(ierr);
+    result->spmv_gbs = solver->spmv_gbs;
+    result->krylov_memory = solver->krylov_memory;
+    result->checkpoint_time = solver->checkpoint ? solver->checkpoint_time : 0.0;
+    result->resumed_iteration = solver->checkpoint ? solver->checkpoint->stats.resumed_iteration : 0;
+    
+    result->outer_iterations = solver->A_single ? solver->outer_iterations : 0;
     
     KSPConvergedReason reason;
     ierr = KSPGetConvergedReason(solver->ksp, &reason); CHKERRQ(ierr);
-    result->converged = (reason > 0);
+    result->converged = solver->A_single ? solver->outer_converged : (PetscBool)(reason > 0);
+    result->pc_rebuilt = PETSC_FALSE;
     
     return 0;
 }
 
 PetscErrorCode solver_destroy(LinearSolver *solver) {
     PetscErrorCode ierr;
-    if (solver->ksp) { ierr = KSPDestroy(&solver->ksp); CHKERRQ(ierr); }
-    if (solver->b) { ierr = VecDestroy(&solver->b); CHKERRQ(ierr); }
-    if (solver->x) { ierr = VecDestroy(&solver->x); CHKERRQ(ierr); }
+    PetscLogDouble bytes;
+    if (solver->ksp) {
+        // KSP с сеткой или пространством проекции не возвращается: их не сбросить без пересоздания
+        if (!solver->dm && solver->guess_type != SOLVER_GUESS_FISCHER) {
+            ierr = solver_krylov_memory(solver, &bytes); CHKERRQ(ierr);
+            ierr = workspace_return_ksp(&solver->ksp, bytes, solver->ksp_reused); CHKERRQ(ierr);
+        } else {
+            ierr = KSPDestroy(&solver->ksp); CHKERRQ(ierr);
+        }
+    }
+    if (solver->x_work) {
+        ierr = workspace_return_vecs(1, &solver->b_work); CHKERRQ(ierr);
+        ierr = workspace_return_vecs(1, &solver->x_work); CHKERRQ(ierr);
+        solver->b = NULL;
+        solver->x = NULL;
+    } else {
+        ierr = VecDestroy(&solver->b); CHKERRQ(ierr);
+        ierr = VecDestroy(&solver->x); CHKERRQ(ierr);
+    }
+    ierr = MatDestroy(&solver->A_single); CHKERRQ(ierr);
+    ierr = MatDestroy(&solver->A_format); CHKERRQ(ierr);
+    ierr = MatDestroy(&solver->A_csr); CHKERRQ(ierr);
+    ierr = solver_destroy_reordering(solver); CHKERRQ(ierr);
+    ierr = solve_report_destroy(&solver->report); CHKERRQ(ierr);
+    ierr = checkpoint_destroy(&solver->checkpoint); CHKERRQ(ierr);
     return 0;
 }
 
@@ -112,26 +632,168 @@ PetscErrorCode solver_print_info(LinearSolver *solver) {
     PetscPrintf(PETSC_COMM_WORLD, "Matrix size: %" PetscInt_FMT "\n", solver->matrix_size);
     PetscPrintf(PETSC_COMM_WORLD, "Iterations: %" PetscInt_FMT "\n", solver->iterations);
     PetscPrintf(PETSC_COMM_WORLD, "Final residual: %g\n", solver->residual);
+    PetscPrintf(PETSC_COMM_WORLD, "Setup time: %g seconds\n", solver->setup_time);
     PetscPrintf(PETSC_COMM_WORLD, "Solve time: %g seconds\n", solver->solve_time);
+    PetscPrintf(PETSC_COMM_WORLD, "Global reductions: %.0f\n", solver->reductions);
+    if (solver->A_single) {
+        PetscPrintf(PETSC_COMM_WORLD, "Mixed precision outer iterations: %" PetscInt_FMT " (%s)\n",
+                    solver->outer_iterations, solver->outer_converged ? "converged" : "not converged");
+    }
+    if (solver->A_natural) {
+        PetscPrintf(PETSC_COMM_WORLD, "Reordering %s: %g seconds, SpMV %g -> %g seconds\n", solver->reorder_type,
+                    solver->reorder_time, solver->spmv_time_natural, solver->spmv_time_reordered);
+        if (solver->reorder_compare) {
+            PetscPrintf(PETSC_COMM_WORLD, "Reordering %s: trial iterations %" PetscInt_FMT " -> %" PetscInt_FMT "\n", solver->reorder_type,
+                        solver->reorder_its_natural, solver->reorder_its_reordered);
+        }
+    }
+    if (solver->tuned_ksp[0]) {
+        if (solver->tune_cache_hit) {
+            PetscPrintf(PETSC_COMM_WORLD, "Tuned configuration: %s/%s, restart %" PetscInt_FMT " (from cache)\n",
+                        solver->tuned_ksp, solver->tuned_pc, solver->tuned_restart);
+        } else {
+            PetscPrintf(PETSC_COMM_WORLD, "Tuned configuration: %s/%s, restart %" PetscInt_FMT " (trials %g seconds)\n",
+                        solver->tuned_ksp, solver->tuned_pc, solver->tuned_restart, solver->tune_time);
+        }
+    }
+    if (solver->spmv_format[0]) {
+        PetscPrintf(PETSC_COMM_WORLD, "SpMV format: %s (block size %" PetscInt_FMT ", %.2f GB/s)\n", solver->spmv_format,
+                    solver->spmv_block_size, (double)solver->spmv_gbs);
+    }
+    if (solver->restart_max) {
+        PetscInt restart;
+        ierr = KSPGMRESGetRestart(solver->ksp, &restart); CHKERRQ(ierr);
+        PetscPrintf(PETSC_COMM_WORLD, "GMRES restart: %" PetscInt_FMT " (at most %" PetscInt_FMT " within %.0f bytes per rank)\n",
+                    restart, solver->restart_max, (double)solver->memory_budget);
+    }
+    PetscPrintf(PETSC_COMM_WORLD, "Krylov workspace: %.0f bytes per rank\n", solver->krylov_memory);
+    if (solver->checkpoint) { ierr = checkpoint_print_stats(solver->checkpoint); CHKERRQ(ierr); }
+    if (solver->guess_type == SOLVER_GUESS_LAST) {
+        PetscPrintf(PETSC_COMM_WORLD, "Initial guess: previous solution\n");
+    } else if (solver->guess_type == SOLVER_GUESS_FISCHER) {
+        PetscPrintf(PETSC_COMM_WORLD, "Initial guess: projection on %" PetscInt_FMT " previous solutions\n", solver->guess_size);
+    }
+    if (solver->fallbacks) {
+        PetscPrintf(PETSC_COMM_WORLD, "Pipelined GMRES fallbacks: %" PetscInt_FMT "\n", solver->fallbacks);
+    }
     ierr = KSPView(solver->ksp, PETSC_VIEWER_STDOUT_WORLD); CHKERRQ(ierr);
     return 0;
 }
 
 PetscErrorCode solver_benchmark(Mat A, Vec b, Vec x, PCType pc_type, SolverResult *result) {
+    PetscErrorCode ierr;
+    SolverConfig config = {KSPGMRES, pc_type, 0};
+    ierr = solver_benchmark_config(A, b, x, &config, result); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode solver_benchmark_config(Mat A, Vec b, Vec x, const SolverConfig *config, SolverResult *result) {
     PetscErrorCode ierr;
     LinearSolver solver;
     PetscLogDouble setup_start, setup_end;
     
     ierr = PetscTime(&setup_start); CHKERRQ(ierr);
     ierr = solver_create(&solver, A); CHKERRQ(ierr);
-    ierr = solver_set_preconditioner(&solver, pc_type); CHKERRQ(ierr);
+    ierr = solver_configure(&solver, config); CHKERRQ(ierr);
     ierr = solver_setup(&solver); CHKERRQ(ierr);
     ierr = PetscTime(&setup_end); CHKERRQ(ierr);
     
-    result->setup_time = setup_end - setup_start;
-    
     ierr = solver_solve_with_result(&solver, b, x, result); CHKERRQ(ierr);
+    // Для бенчмарка настройка включает создание KSP, а не только KSPSetUp
+    result->setup_time = setup_end - setup_start;
     ierr = solver_destroy(&solver); CHKERRQ(ierr);
     
     return 0;
-}
\ No newline at end of file
+}
+
+PetscErrorCode solver_session_create(SolverSession *session, Mat A) {
+    PetscErrorCode ierr;
+    
+    ierr = solver_create(&session->solver, A); CHKERRQ(ierr);
+    session->pc_mode = SOLVER_PC_REBUILD;
+    session->refresh_interval = 1;
+    session->solve_count = 0;
+    session->pc_builds = 0;
+    session->solves_since_build = 0;
+    session->values_changed = PETSC_FALSE;
+    
+    return 0;
+}
+
+PetscErrorCode solver_session_set_pc_reuse(SolverSession *session, PCReuseMode mode, PetscInt refresh_interval) {
+    if (mode == SOLVER_PC_REFRESH_EVERY && refresh_interval < 1) {
+        SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "refresh_interval must be positive");
+    }
+    session->pc_mode = mode;
+    session->refresh_interval = refresh_interval;
+    return 0;
+}
+
+// Новые значения с тем же шаблоном разреженности. A_new == NULL или сама
+// матрица сессии означает, что значения уже изменены на месте.
+PetscErrorCode solver_session_update_values(SolverSession *session, Mat A_new) {
+    PetscErrorCode ierr;
+    
+    Mat A = session->solver.A_natural ? session->solver.A_natural : session->solver.A;
+    
+    if (A_new && A_new != A) {
+        ierr = MatCopy(A_new, A, SAME_NONZERO_PATTERN); CHKERRQ(ierr);
+    }
+    session->values_changed = PETSC_TRUE;
+    return 0;
+}
+
+PetscErrorCode solver_session_solve(SolverSession *session, Vec b, Vec x, SolverResult *result) {
+    PetscErrorCode ierr;
+    LinearSolver *solver = &session->solver;
+    PetscBool rebuild;
+    PetscLogDouble setup_start, setup_end;
+    
+    switch (session->pc_mode) {
+    case SOLVER_PC_REUSE:
+        rebuild = (PetscBool)(session->pc_builds == 0);
+        break;
+    case SOLVER_PC_REFRESH_EVERY:
+        rebuild = (PetscBool)(session->pc_builds == 0 ||
+                              (session->values_changed && session->solves_since_build >= session->refresh_interval));
+        break;
+    default:
+        rebuild = (PetscBool)(session->pc_builds == 0 || session->values_changed);
+        break;
+    }
+    
+    ierr = PetscTime(&setup_start); CHKERRQ(ierr);
+    if (session->values_changed) {
+        // KSP и его рабочие векторы сохраняются, меняются только значения оператора
+        ierr = solver_refresh_reordering(solver); CHKERRQ(ierr);
+        ierr = solver_refresh_mixed_operator(solver); CHKERRQ(ierr);
+        ierr = solver_refresh_format(solver); CHKERRQ(ierr);
+        ierr = KSPSetOperators(solver->ksp, solver->A_single ? solver->A_single : (solver->A_format ? solver->A_format : solver->A),
+                               solver->A); CHKERRQ(ierr);
+        session->values_changed = PETSC_FALSE;
+    }
+    // Сессия не вызывает solver_setup: первое решение проходит ту же подготовку
+    if (session->solve_count == 0) { ierr = solver_prepare_operator(solver); CHKERRQ(ierr); }
+    ierr = KSPSetReusePreconditioner(solver->ksp, rebuild ? PETSC_FALSE : PETSC_TRUE); CHKERRQ(ierr);
+    ierr = KSPSetUp(solver->ksp); CHKERRQ(ierr);
+    ierr = PetscTime(&setup_end); CHKERRQ(ierr);
+    
+    ierr = solver_solve_with_result(solver, b, x, result); CHKERRQ(ierr);
+    result->setup_time = setup_end - setup_start;
+    result->pc_rebuilt = rebuild;
+    
+    if (rebuild) {
+        session->pc_builds++;
+        session->solves_since_build = 0;
+    }
+    session->solves_since_build++;
+    session->solve_count++;
+    
+    return 0;
+}
+
+PetscErrorCode solver_session_destroy(SolverSession *session) {
+    PetscErrorCode ierr;
+    ierr = solver_destroy(&session->solver); CHKERRQ(ierr);
+    return 0;
+}
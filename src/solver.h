@@ -2,6 +2,56 @@
 #define SOLVER_H
 
 #include <petscksp.h>
+#include <petscdmda.h>
+#include <stdint.h>
+#include "solver_log.h"
+#include "checkpoint.h"
+
+// Вариант GMRES по числу глобальных редукций на итерацию
+typedef enum {
+    SOLVER_GMRES_CLASSICAL,             // CGS с повторной ортогонализацией при потере ортогональности
+    SOLVER_GMRES_MODIFIED,              // MGS: устойчивее, но k редукций на k-й итерации
+    SOLVER_GMRES_PIPELINED,             // KSPPGMRES: одна неблокирующая редукция, совмещённая с SpMV
+    SOLVER_GMRES_PIPELINED_FLEXIBLE     // KSPPIPEFGMRES: то же, допускает переменный предобуславливатель
+} SolverGMRESVariant;
+
+// Начальное приближение для серии близких систем (шаги по времени)
+typedef enum {
+    SOLVER_GUESS_ZERO,                  // нулевое, x на входе solver_solve игнорируется
+    SOLVER_GUESS_LAST,                  // x на входе solver_solve - обычно решение прошлого шага
+    SOLVER_GUESS_FISCHER                // проекция b на подпространство прошлых решений (KSPGUESSFISCHER)
+} SolverGuessType;
+
+// Допустимый разрыв между истинной невязкой и rtol*||b|| для конвейерных вариантов
+// и число решений классическим GMRES после перехода, до новой попытки конвейерного
+#define SOLVER_PIPELINED_RESIDUAL_GAP 10.0
+#define SOLVER_PIPELINED_RETRY 5
+
+// Рестарт GMRES при бюджете памяти: начальный, наименьший допустимый и порог застоя
+// (отношение невязок соседних циклов, выше которого рестарт удваивается)
+#define SOLVER_RESTART_INITIAL 30
+#define SOLVER_RESTART_MIN 2
+#define SOLVER_RESTART_STAGNATION 0.8
+
+// Предел числа уровней PCMG при автоматическом выборе
+#define SOLVER_MG_MAX_LEVELS 10
+
+// Число SpMV для замера времени умножения (перестановка, выбор формата)
+#define SOLVER_SPMV_SAMPLES 10
+
+// Выбор формата хранения для SpMV: длина имени формата и число шаблонов в кэше
+#define SOLVER_FORMAT_NAME_LEN 16
+#define SOLVER_FORMAT_CACHE_SIZE 16
+
+// Подбор KSP/PC/рестарта: длина имён, предел итераций пробного решения, период (в
+// итерациях) проверки бюджета времени и пороги похожести матриц для кэша на диске
+#define SOLVER_TUNE_NAME_LEN 32
+#define SOLVER_TUNE_MAXITS 200
+#define SOLVER_TUNE_CHECK_INTERVAL 10
+#define SOLVER_TUNE_SYMMETRY_TOL 1e-10
+#define SOLVER_TUNE_DOMINANCE_TOL 0.1
+#define SOLVER_TUNE_ROW_NNZ_TOL 0.25
+#define SOLVER_TUNE_SIZE_RATIO 4.0
 
 typedef struct {
     KSP ksp;
@@ -12,6 +62,50 @@ typedef struct {
     PetscInt iterations;
     PetscReal residual;
     PetscLogDouble solve_time;
+    PetscLogDouble setup_time;
+    SolveReport *report;            // JSON-отчёт по каждому решению (-solver_report); NULL - выключен
+    SolverGMRESVariant gmres_variant;
+    PetscInt restart;               // заданная длина рестарта; 0 - по умолчанию PETSc
+    PetscLogDouble reductions;      // глобальных редукций за последнее решение (на процесс)
+    PetscInt fallbacks;             // переходов с конвейерного варианта на классический
+    SolverGMRESVariant pipelined_variant;  // конвейерный вариант, временно замененный классическим
+    PetscInt pipelined_suspended;   // решений классическим GMRES до возврата к нему; 0 - замены нет
+    Mat A_single;                   // копия A в float для смешанной точности; NULL - режим выключен
+    PetscReal mixed_inner_rtol;     // точность внутреннего решения в смешанной точности
+    PetscInt outer_iterations;
+    PetscBool outer_converged;
+    DM dm;                          // структурированная сетка (DMDA) для геометрического многосеточного PCMG; NULL - нет
+    char reorder_type[32];          // MatOrderingType (rcm, nd, ...) для перестановки в solver_setup; "" - выключено
+    Mat A_natural;                  // исходная матрица, если A - её перестановка; NULL - без перестановки
+    IS perm;                        // новая строка i - строка perm[i] исходной матрицы
+    Vec b_perm, x_perm;
+    PetscLogDouble reorder_time;
+    PetscLogDouble spmv_time_natural, spmv_time_reordered;  // среднее время одного SpMV до и после
+    PetscBool reorder_compare;      // пробные решения до и после перестановки (-solver_reorder_compare)
+    PetscInt reorder_its_natural, reorder_its_reordered;
+    PetscBool tune_format;          // выбор формата SpMV в solver_setup (-solver_tune_format)
+    Mat A_format;                   // копия A в выбранном формате (SELL, BAIJ); NULL - SpMV по самой A
+    char spmv_format[SOLVER_FORMAT_NAME_LEN];  // aij, sell, baij; "" - выбор не выполнялся
+    PetscInt spmv_block_size;
+    PetscReal spmv_gbs;             // полезная пропускная способность SpMV в выбранном формате, ГБ/с
+    SolverGuessType guess_type;
+    PetscInt guess_size;            // число хранимых решений для проекции
+    PetscReal memory_budget;        // байт на процесс под базис Крылова (-solver_memory_budget); 0 - без ограничения
+    PetscInt restart_max;           // наибольший рестарт в пределах бюджета; 0 - бюджет не применён
+    PetscBool restart_adaptive;     // рост рестарта при застое внутри solver_solve
+    PetscInt nlocal_max;            // наибольшая локальная длина вектора по процессам; 0 - не вычислена
+    PetscLogDouble krylov_memory;   // пик памяти базиса Крылова за последнее решение, байт на процесс
+    Vec *x_work, *b_work;           // наборы пула рабочих векторов, x = x_work[0], b = b_work[0]; NULL - векторы вызывающего
+    PetscBool ksp_reused;           // KSP взят из пула (workspace_pool.h)
+    Mat A_csr;                      // обёртка над CSR-массивами вызывающего (solver_create_csr); NULL - нет
+    PetscBool tune_config;          // подбор KSP/PC/рестарта в solver_setup (-solver_tune)
+    char tuned_ksp[SOLVER_TUNE_NAME_LEN];  // выбранная конфигурация; "" - подбор не выполнялся
+    char tuned_pc[SOLVER_TUNE_NAME_LEN];
+    PetscInt tuned_restart;
+    PetscBool tune_cache_hit;       // конфигурация взята из кэша, пробных решений не было
+    PetscLogDouble tune_time;       // время подбора (пробные решения)
+    SolverCheckpoint *checkpoint;   // снимки приближения (-solver_checkpoint); NULL - выключены
+    PetscLogDouble checkpoint_time; // накладные расходы снимков на пути последнего решения
 } LinearSolver;
 
 typedef struct {
@@ -19,28 +113,160 @@ typedef struct {
     PetscInt nonzeros;
     PetscInt iterations;
     PetscReal residual;
+    PetscLogDouble assembly_time;   // 0 из solver_solve_with_result, заполняет вызывающий
     PetscLogDouble setup_time;
     PetscLogDouble solve_time;
-    PetscBool converged;
+    PetscLogDouble reductions;
+    PetscLogDouble reorder_time;    // 0 - без перестановки
+    PetscInt reorder_its_natural;   // итерации пробных решений до и после перестановки; 0 - без сравнения
+    PetscInt reorder_its_reordered;
+    char spmv_format[SOLVER_FORMAT_NAME_LEN];  // формат SpMV после выбора; "" - без выбора
+    PetscReal spmv_gbs;
+    PetscLogDouble krylov_memory;   // пик памяти базиса Крылова на процесс (модель), байты; 0 - не GMRES
+    PetscLogDouble checkpoint_time; // накладные расходы снимков на пути решения; 0 - без снимков
+    PetscInt resumed_iteration;     // итерация снимка, с которого продолжено решение; 0 - с начала
+    PetscInt outer_iterations;      // шаги уточнения в смешанной точности; 0 - обычное решение
+    PetscBool converged;            // в смешанной точности - сходимость внешнего цикла
+    PetscBool pc_rebuilt;
 } SolverResult;
 
+// Конфигурация решателя для бенчмарков
+typedef struct {
+    KSPType ksp_type;           // тип KSP или имя варианта GMRES (classical, modified, pipelined, pipefgmres)
+    PCType pc_type;
+    PetscInt restart;           // длина рестарта GMRES; 0 - по умолчанию PETSc
+} SolverConfig;
+
+// Повторное использование предобуславливателя в сессии
+typedef enum {
+    SOLVER_PC_REBUILD,          // пересборка при каждом изменении значений матрицы
+    SOLVER_PC_REUSE,            // сборка один раз на всю сессию
+    SOLVER_PC_REFRESH_EVERY     // пересборка не чаще, чем раз в refresh_interval решений
+} PCReuseMode;
+
+// Сессия: один KSP/PC и рабочие векторы на серию систем с общим шаблоном разреженности
+typedef struct {
+    LinearSolver solver;
+    PCReuseMode pc_mode;
+    PetscInt refresh_interval;
+    PetscInt solve_count;
+    PetscInt pc_builds;
+    PetscInt solves_since_build;
+    PetscBool values_changed;
+} SolverSession;
+
 // Инициализация и финализация
 PetscErrorCode solver_initialize(int argc, char **argv);
 PetscErrorCode solver_finalize();
 
 // Создание и настройка решателя
 PetscErrorCode solver_create(LinearSolver *solver, Mat A);
+// x и b задаёт вызывающий (решатель берёт ссылки), векторы пула не используются
+PetscErrorCode solver_create_with_vectors(LinearSolver *solver, Mat A, Vec x, Vec b);
+// Решатель без копирования над CSR-массивами и векторами вызывающего (src/csr_wrap.c).
+// Массивы остаются у вызывающего и должны жить и не менять адрес до solver_destroy:
+// rowptr/cols (локальные строки, глобальные столбцы по возрастанию, rowptr[0] = 0) не
+// меняются, vals можно менять между решениями с вызовом solver_csr_values_changed,
+// rhs читается и sol записывается при solver_solve_csr (sol - начальное приближение
+// при SOLVER_GUESS_LAST).
+// На одном процессе матрица - AIJ прямо на массивах (любой предобуславливатель),
+// на нескольких - безматричный оператор над ними (предобуславливатели none и jacobi).
+PetscErrorCode solver_create_csr(LinearSolver *solver, MPI_Comm comm, PetscInt nlocal, PetscInt n,
+                                 const PetscInt rowptr[], const PetscInt cols[], PetscScalar vals[],
+                                 PetscScalar rhs[], PetscScalar sol[]);
+PetscErrorCode solver_csr_values_changed(LinearSolver *solver);
+PetscErrorCode solver_solve_csr(LinearSolver *solver);
+// PCMG строит иерархию сеток огрублением DM решателя (Galerkin-операторы на грубых уровнях);
+// число уровней выбирается по размерам сетки, -pc_mg_levels задаёт его явно
 PetscErrorCode solver_set_preconditioner(LinearSolver *solver, PCType pc_type);
+PetscErrorCode solver_set_dm(LinearSolver *solver, DM dm);
+PetscErrorCode solver_set_ksp_type(LinearSolver *solver, KSPType ksp_type);
+PetscErrorCode solver_set_gmres_variant(LinearSolver *solver, SolverGMRESVariant variant);
+PetscErrorCode solver_gmres_variant_from_string(const char *name, SolverGMRESVariant *variant, PetscBool *found);
+PetscErrorCode solver_set_restart(LinearSolver *solver, PetscInt restart);
+// Проекция (FISCHER) хранит size прошлых решений и A на них; базис сбрасывается при
+// смене значений матрицы. Выключить её на том же решателе нельзя
+PetscErrorCode solver_set_initial_guess(LinearSolver *solver, SolverGuessType type, PetscInt size);
+PetscErrorCode solver_guess_type_from_string(const char *name, SolverGuessType *type, PetscBool *found);
+PetscErrorCode solver_configure(LinearSolver *solver, const SolverConfig *config);
 PetscErrorCode solver_set_tolerances(LinearSolver *solver, PetscReal rtol, PetscReal atol, PetscReal dtol, PetscInt maxits);
 PetscErrorCode solver_setup(LinearSolver *solver);
 
 // Решение системы
 PetscErrorCode solver_solve(LinearSolver *solver, Vec b, Vec x);
 PetscErrorCode solver_solve_with_result(LinearSolver *solver, Vec b, Vec x, SolverResult *result);
+// Блок правых частей (плотные B и X, столбец - система): псевдоблочный GMRES,
+// одно SpMM на итерацию для всего блока, results[j] - по столбцу j
+PetscErrorCode solver_solve_multi(LinearSolver *solver, Mat B, Mat X, SolverResult results[]);
+
+// Смешанная точность: внешний цикл уточнения с невязкой в double, внутренний
+// KSP с оператором в float и предобуславливателем по исходной матрице
+PetscErrorCode solver_set_mixed_precision(LinearSolver *solver, PetscBool enable);
+PetscErrorCode solver_refresh_mixed_operator(LinearSolver *solver);
+PetscErrorCode solver_solve_mixed(LinearSolver *solver, Vec b, Vec x);
+
+// Перестановка RCM/ND в solver_setup (-solver_reorder <type>): матрица переставляется
+// внутри процесса, правая часть и решение - внутри solver_solve
+PetscErrorCode solver_set_reordering(LinearSolver *solver, MatOrderingType type);
+// Пробные решения с правой частью A*1 на исходной и переставленной матрице: число итераций
+PetscErrorCode solver_set_reordering_compare(LinearSolver *solver, PetscBool enable);
+PetscErrorCode solver_apply_reordering(LinearSolver *solver);
+PetscErrorCode solver_refresh_reordering(LinearSolver *solver);
+PetscErrorCode solver_destroy_reordering(LinearSolver *solver);
+// Среднее время одного MatMult (максимум по процессам)
+PetscErrorCode solver_time_spmv(Mat A, PetscLogDouble *time);
+// Полезный трафик одного SpMV в модели CSR (байты), для ГБ/с
+PetscErrorCode solver_spmv_bytes(Mat A, PetscLogDouble *bytes);
+// Хэш шаблона разреженности собранной AIJ-матрицы (одинаков на всех процессах)
+PetscErrorCode solver_pattern_fingerprint(Mat A, uint64_t *fingerprint);
+
+// Выбор формата SpMV в solver_setup (-solver_tune_format): AIJ, SELL и BAIJ при
+// обнаруженной блочной структуре замеряются на самой матрице, побеждает быстрейший.
+// Выбор кэшируется по шаблону разреженности; предобуславливатель строится по AIJ
+PetscErrorCode solver_set_format_tuning(LinearSolver *solver, PetscBool enable);
+PetscErrorCode solver_tune_format(LinearSolver *solver);
+PetscErrorCode solver_refresh_format(LinearSolver *solver);
+
+// Подбор конфигурации в solver_setup (-solver_tune): кандидаты KSP/PC/рестарт решают
+// систему с известным решением в пределах SOLVER_TUNE_MAXITS итераций и времени
+// лучшего из уже опробованных, побеждает наименьшее время настройки и решения.
+// Победитель дописывается в кэш на диске (-solver_tune_cache) с отпечатком матрицы
+// (размер, число ненулевых, хэш шаблона, оценки симметрии и диагонального
+// преобладания); матрица с тем же шаблоном или похожая берёт конфигурацию из кэша.
+// Только для собранных AIJ-матриц
+PetscErrorCode solver_set_config_tuning(LinearSolver *solver, PetscBool enable);
+PetscErrorCode solver_tune_config(LinearSolver *solver);
+// Решатель пробного решения: как solver_create, но без отчёта, снимков, перестановки,
+// выбора формата, подбора и бюджета памяти из опций
+PetscErrorCode solver_create_trial(LinearSolver *solver, Mat A);
+
+// Бюджет памяти базиса Крылова (-solver_memory_budget <bytes>): в solver_setup из него
+// выводится наибольший рестарт GMRES; решение идёт циклами, и при застое рестарт
+// удваивается, не выходя за бюджет. Для KSPGMRES/KSPFGMRES без проекции приближения
+PetscErrorCode solver_set_memory_budget(LinearSolver *solver, PetscReal bytes);
+PetscErrorCode solver_apply_memory_budget(LinearSolver *solver);
+PetscErrorCode solver_solve_budgeted(LinearSolver *solver, Vec b, Vec x);
+PetscErrorCode solver_krylov_memory(LinearSolver *solver, PetscLogDouble *bytes);
+
+// Снимки долгого решения (-solver_checkpoint <prefix>, -solver_checkpoint_interval):
+// каждые interval итераций текущее приближение пишется в фоне в файл каждого процесса
+// (checkpoint.h). solver_set_resume (-solver_resume) - следующее решение начинается с
+// последнего снимка. Не вместе со смешанной точностью
+PetscErrorCode solver_set_checkpoint(LinearSolver *solver, const char *prefix, PetscInt interval);
+PetscErrorCode solver_set_resume(LinearSolver *solver, PetscBool resume);
 
 // Утилиты
 PetscErrorCode solver_destroy(LinearSolver *solver);
 PetscErrorCode solver_print_info(LinearSolver *solver);
+PetscErrorCode solver_get_reduction_count(PetscLogDouble *count);
 PetscErrorCode solver_benchmark(Mat A, Vec b, Vec x, PCType pc_type, SolverResult *result);
+PetscErrorCode solver_benchmark_config(Mat A, Vec b, Vec x, const SolverConfig *config, SolverResult *result);
+
+// Сессия многократного решения
+PetscErrorCode solver_session_create(SolverSession *session, Mat A);
+PetscErrorCode solver_session_set_pc_reuse(SolverSession *session, PCReuseMode mode, PetscInt refresh_interval);
+PetscErrorCode solver_session_update_values(SolverSession *session, Mat A_new);
+PetscErrorCode solver_session_solve(SolverSession *session, Vec b, Vec x, SolverResult *result);
+PetscErrorCode solver_session_destroy(SolverSession *session);
 
 #endif
\ No newline at end of file
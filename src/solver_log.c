@@ -0,0 +1,246 @@
+#include "solver_log.h"
+#include "matrix_utils.h"
+#include <petsctime.h>
+#include <sys/resource.h>
+
+#define SOLVER_PHASE_MAX_EVENTS 4
+
+static PetscBool log_initialized = PETSC_FALSE, log_collecting = PETSC_FALSE;
+static PetscLogStage stage_assembly, stage_setup, stage_solve;
+static PetscLogEvent event_assembly;
+
+// События PETSc, из которых складывается каждая фаза
+static const char *phase_names[SOLVER_PHASE_COUNT] = {
+    "pc_setup", "spmv", "pc_apply", "orthogonalization", "reductions"
+};
+static const char *phase_events[SOLVER_PHASE_COUNT][SOLVER_PHASE_MAX_EVENTS] = {
+    {"PCSetUp"},
+    {"MatMult"},
+    {"PCApply"},
+    {"KSPGMRESOrthog"},
+    {"VecNorm", "VecDot", "VecMDot", "VecReduceComm"}
+};
+
+PetscErrorCode solver_log_initialize(void) {
+    PetscErrorCode ierr;
+    
+    if (log_initialized) return 0;
+    ierr = PetscLogStageRegister("Assembly", &stage_assembly); CHKERRQ(ierr);
+    ierr = PetscLogStageRegister("Solver Setup", &stage_setup); CHKERRQ(ierr);
+    ierr = PetscLogStageRegister("Solve", &stage_solve); CHKERRQ(ierr);
+    ierr = PetscLogEventRegister("MatAssembleCSR", MAT_CLASSID, &event_assembly); CHKERRQ(ierr);
+    
+    log_initialized = PETSC_TRUE;
+    return 0;
+}
+
+PetscErrorCode solver_log_assembly_begin(void) {
+    PetscErrorCode ierr;
+    ierr = solver_log_initialize(); CHKERRQ(ierr);
+    ierr = PetscLogStagePush(stage_assembly); CHKERRQ(ierr);
+    ierr = PetscLogEventBegin(event_assembly, 0, 0, 0, 0); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode solver_log_assembly_end(void) {
+    PetscErrorCode ierr;
+    ierr = PetscLogEventEnd(event_assembly, 0, 0, 0, 0); CHKERRQ(ierr);
+    ierr = PetscLogStagePop(); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode solver_log_setup_begin(void) {
+    PetscErrorCode ierr;
+    ierr = solver_log_initialize(); CHKERRQ(ierr);
+    ierr = PetscLogStagePush(stage_setup); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode solver_log_setup_end(void) {
+    PetscErrorCode ierr;
+    ierr = PetscLogStagePop(); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode solver_log_solve_begin(void) {
+    PetscErrorCode ierr;
+    ierr = solver_log_initialize(); CHKERRQ(ierr);
+    ierr = PetscLogStagePush(stage_solve); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode solver_log_solve_end(void) {
+    PetscErrorCode ierr;
+    ierr = PetscLogStagePop(); CHKERRQ(ierr);
+    return 0;
+}
+
+// Накопленные значения событий фаз в стадиях настройки и решения
+static PetscErrorCode phase_snapshot(PhaseStats stats[]) {
+    PetscErrorCode ierr;
+    PetscLogStage stages[2] = {stage_setup, stage_solve};
+    PetscInt p, e, s;
+    
+    for (p = 0; p < SOLVER_PHASE_COUNT; p++) {
+        stats[p].time = stats[p].count = stats[p].flops = stats[p].reductions = 0.0;
+        for (e = 0; e < SOLVER_PHASE_MAX_EVENTS && phase_events[p][e]; e++) {
+            PetscLogEvent id;
+            ierr = PetscLogEventGetId(phase_events[p][e], &id); CHKERRQ(ierr);
+            if (id < 0) continue;
+            for (s = 0; s < 2; s++) {
+                PetscEventPerfInfo info;
+                ierr = PetscLogEventGetPerfInfo(stages[s], id, &info); CHKERRQ(ierr);
+                stats[p].time += info.time;
+                stats[p].count += info.count;
+                stats[p].flops += info.flops;
+                stats[p].reductions += info.numReductions;
+            }
+        }
+    }
+    return 0;
+}
+
+static PetscErrorCode solve_report_monitor(KSP ksp, PetscInt its, PetscReal rnorm, void *ctx) {
+    PetscErrorCode ierr;
+    SolveReport *report = (SolveReport *)ctx;
+    PetscLogDouble now;
+    
+    if (report->history_len == report->history_cap) {
+        report->history_cap = PetscMax(2 * report->history_cap, 64);
+        ierr = PetscRealloc(sizeof(ResidualSample) * report->history_cap, &report->history); CHKERRQ(ierr);
+    }
+    ierr = PetscTime(&now); CHKERRQ(ierr);
+    report->history[report->history_len].iteration = its;
+    report->history[report->history_len].rnorm = rnorm;
+    report->history[report->history_len].time = now - report->start_time;
+    report->history_len++;
+    return 0;
+}
+
+PetscErrorCode solve_report_create(KSP ksp, SolveReport **report) {
+    PetscErrorCode ierr;
+    
+    ierr = solver_log_initialize(); CHKERRQ(ierr);
+    // Без -log_view сбор статистики событий включается только для отчётов
+    if (!log_collecting) {
+        ierr = PetscLogDefaultBegin(); CHKERRQ(ierr);
+        log_collecting = PETSC_TRUE;
+    }
+    ierr = PetscNew(report); CHKERRQ(ierr);
+    ierr = KSPMonitorSet(ksp, solve_report_monitor, *report, NULL); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode solve_report_begin(SolveReport *report) {
+    PetscErrorCode ierr;
+    
+    report->history_len = 0;
+    ierr = phase_snapshot(report->start); CHKERRQ(ierr);
+    ierr = PetscTime(&report->start_time); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode solve_report_end(SolveReport *report) {
+    PetscErrorCode ierr;
+    PetscLogDouble sums[SOLVER_PHASE_COUNT], maxs[3 * SOLVER_PHASE_COUNT + 2];
+    struct rusage usage;
+    PetscInt p;
+    
+    ierr = phase_snapshot(report->phases); CHKERRQ(ierr);
+    for (p = 0; p < SOLVER_PHASE_COUNT; p++) {
+        maxs[3 * p] = report->phases[p].time - report->start[p].time;
+        maxs[3 * p + 1] = report->phases[p].count - report->start[p].count;
+        maxs[3 * p + 2] = report->phases[p].reductions - report->start[p].reductions;
+        sums[p] = report->phases[p].flops - report->start[p].flops;
+    }
+    
+    // Память: текущая и пиковая (ru_maxrss в Linux - в килобайтах)
+    ierr = PetscMemoryGetCurrentUsage(&maxs[3 * SOLVER_PHASE_COUNT]); CHKERRQ(ierr);
+    getrusage(RUSAGE_SELF, &usage);
+    maxs[3 * SOLVER_PHASE_COUNT + 1] = (PetscLogDouble)usage.ru_maxrss * 1024.0;
+    
+    ierr = MPI_Allreduce(MPI_IN_PLACE, maxs, 3 * SOLVER_PHASE_COUNT + 2, MPI_DOUBLE, MPI_MAX, PETSC_COMM_WORLD); CHKERRMPI(ierr);
+    ierr = MPI_Allreduce(MPI_IN_PLACE, sums, SOLVER_PHASE_COUNT, MPI_DOUBLE, MPI_SUM, PETSC_COMM_WORLD); CHKERRMPI(ierr);
+    
+    for (p = 0; p < SOLVER_PHASE_COUNT; p++) {
+        report->phases[p].time = maxs[3 * p];
+        report->phases[p].count = maxs[3 * p + 1];
+        report->phases[p].reductions = maxs[3 * p + 2];
+        report->phases[p].flops = sums[p];
+    }
+    report->memory_current = maxs[3 * SOLVER_PHASE_COUNT];
+    report->memory_peak = maxs[3 * SOLVER_PHASE_COUNT + 1];
+    return 0;
+}
+
+PetscErrorCode solve_report_write(const SolveReport *report, KSP ksp, PetscLogDouble setup_time, PetscLogDouble solve_time, const char *filename) {
+    PetscErrorCode ierr;
+    FILE *fd;
+    KSPType ksp_type;
+    PCType pc_type;
+    PC pc;
+    Mat A;
+    MatInfo info;
+    PetscInt n, its, p, k;
+    PetscReal rnorm;
+    KSPConvergedReason reason;
+    PetscMPIInt nranks;
+    PetscLogDouble assembly_time;
+    PetscBool has_info;
+    
+    ierr = MPI_Comm_size(PETSC_COMM_WORLD, &nranks); CHKERRMPI(ierr);
+    ierr = KSPGetType(ksp, &ksp_type); CHKERRQ(ierr);
+    ierr = KSPGetPC(ksp, &pc); CHKERRQ(ierr);
+    ierr = PCGetType(pc, &pc_type); CHKERRQ(ierr);
+    ierr = KSPGetOperators(ksp, NULL, &A); CHKERRQ(ierr);
+    ierr = MatGetSize(A, &n, NULL); CHKERRQ(ierr);
+    ierr = MatHasOperation(A, MATOP_GET_INFO, &has_info); CHKERRQ(ierr);
+    info.nz_used = 0.0;
+    if (has_info) { ierr = MatGetInfo(A, MAT_GLOBAL_SUM, &info); CHKERRQ(ierr); }
+    ierr = KSPGetIterationNumber(ksp, &its); CHKERRQ(ierr);
+    ierr = KSPGetResidualNorm(ksp, &rnorm); CHKERRQ(ierr);
+    ierr = KSPGetConvergedReason(ksp, &reason); CHKERRQ(ierr);
+    ierr = get_last_assembly_time(&assembly_time); CHKERRQ(ierr);
+    
+    ierr = PetscFOpen(PETSC_COMM_WORLD, filename, "w", &fd); CHKERRQ(ierr);
+    ierr = PetscFPrintf(PETSC_COMM_WORLD, fd, "{\n"); CHKERRQ(ierr);
+    ierr = PetscFPrintf(PETSC_COMM_WORLD, fd, "  \"nranks\": %d,\n  \"matrix_size\": %" PetscInt_FMT ",\n  \"nonzeros\": %.0f,\n",
+                        nranks, n, info.nz_used); CHKERRQ(ierr);
+    ierr = PetscFPrintf(PETSC_COMM_WORLD, fd, "  \"ksp\": \"%s\",\n  \"pc\": \"%s\",\n", ksp_type ? ksp_type : "", pc_type ? pc_type : ""); CHKERRQ(ierr);
+    ierr = PetscFPrintf(PETSC_COMM_WORLD, fd, "  \"iterations\": %" PetscInt_FMT ",\n  \"residual\": %.6e,\n  \"converged_reason\": \"%s\",\n",
+                        its, (double)rnorm, KSPConvergedReasons[reason]); CHKERRQ(ierr);
+    ierr = PetscFPrintf(PETSC_COMM_WORLD, fd, "  \"assembly_time\": %.6e,\n  \"setup_time\": %.6e,\n  \"solve_time\": %.6e,\n",
+                        assembly_time, setup_time, solve_time); CHKERRQ(ierr);
+    
+    ierr = PetscFPrintf(PETSC_COMM_WORLD, fd, "  \"phases\": {\n"); CHKERRQ(ierr);
+    for (p = 0; p < SOLVER_PHASE_COUNT; p++) {
+        const PhaseStats *ps = &report->phases[p];
+        ierr = PetscFPrintf(PETSC_COMM_WORLD, fd, "    \"%s\": {\"time\": %.6e, \"count\": %.0f, \"flops\": %.6e, \"reductions\": %.0f}%s\n",
+                            phase_names[p], ps->time, ps->count, ps->flops, ps->reductions,
+                            (p + 1 < SOLVER_PHASE_COUNT) ? "," : ""); CHKERRQ(ierr);
+    }
+    ierr = PetscFPrintf(PETSC_COMM_WORLD, fd, "  },\n"); CHKERRQ(ierr);
+    
+    ierr = PetscFPrintf(PETSC_COMM_WORLD, fd, "  \"memory\": {\"current_max\": %.0f, \"peak_max\": %.0f},\n",
+                        report->memory_current, report->memory_peak); CHKERRQ(ierr);
+    
+    ierr = PetscFPrintf(PETSC_COMM_WORLD, fd, "  \"residual_history\": [\n"); CHKERRQ(ierr);
+    for (k = 0; k < report->history_len; k++) {
+        const ResidualSample *rs = &report->history[k];
+        ierr = PetscFPrintf(PETSC_COMM_WORLD, fd, "    {\"iteration\": %" PetscInt_FMT ", \"time\": %.6e, \"rnorm\": %.6e}%s\n",
+                            rs->iteration, rs->time, (double)rs->rnorm,
+                            (k + 1 < report->history_len) ? "," : ""); CHKERRQ(ierr);
+    }
+    ierr = PetscFPrintf(PETSC_COMM_WORLD, fd, "  ]\n}\n"); CHKERRQ(ierr);
+    ierr = PetscFClose(PETSC_COMM_WORLD, fd); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode solve_report_destroy(SolveReport **report) {
+    PetscErrorCode ierr;
+    
+    if (!*report) return 0;
+    ierr = PetscFree((*report)->history); CHKERRQ(ierr);
+    ierr = PetscFree(*report); CHKERRQ(ierr);
+    return 0;
+}
@@ -0,0 +1,56 @@
+#ifndef SOLVER_LOG_H
+#define SOLVER_LOG_H
+
+#include <petscksp.h>
+
+// Фазы решения в отчёте; время и число вызовов берутся из событий PETSc
+typedef enum {
+    SOLVER_PHASE_PC_SETUP,
+    SOLVER_PHASE_SPMV,
+    SOLVER_PHASE_PC_APPLY,
+    SOLVER_PHASE_ORTHOGONALIZATION,
+    SOLVER_PHASE_REDUCTION,         // VecNorm/VecDot/VecMDot/VecReduceComm: события с глобальной редукцией
+    SOLVER_PHASE_COUNT
+} SolverPhase;
+
+typedef struct {
+    PetscLogDouble time;            // максимум по процессам
+    PetscLogDouble count;
+    PetscLogDouble flops;           // сумма по процессам
+    PetscLogDouble reductions;
+} PhaseStats;
+
+typedef struct {
+    PetscInt iteration;
+    PetscReal rnorm;
+    PetscLogDouble time;            // от начала решения
+} ResidualSample;
+
+// Отчёт одного решения: фазы, история невязки с отметками времени, память
+typedef struct {
+    PhaseStats phases[SOLVER_PHASE_COUNT];
+    PhaseStats start[SOLVER_PHASE_COUNT];
+    ResidualSample *history;
+    PetscInt history_len, history_cap;
+    PetscLogDouble start_time;
+    PetscLogDouble memory_current;  // байты, максимум по процессам
+    PetscLogDouble memory_peak;     // пиковый RSS, максимум по процессам
+} SolveReport;
+
+// Стадии и события регистрируются при первом вызове
+PetscErrorCode solver_log_initialize(void);
+PetscErrorCode solver_log_assembly_begin(void);
+PetscErrorCode solver_log_assembly_end(void);
+PetscErrorCode solver_log_setup_begin(void);
+PetscErrorCode solver_log_setup_end(void);
+PetscErrorCode solver_log_solve_begin(void);
+PetscErrorCode solver_log_solve_end(void);
+
+// Отчёты включаются опцией -solver_report <prefix>: <prefix>_<N>.json на каждое решение
+PetscErrorCode solve_report_create(KSP ksp, SolveReport **report);
+PetscErrorCode solve_report_begin(SolveReport *report);
+PetscErrorCode solve_report_end(SolveReport *report);
+PetscErrorCode solve_report_write(const SolveReport *report, KSP ksp, PetscLogDouble setup_time, PetscLogDouble solve_time, const char *filename);
+PetscErrorCode solve_report_destroy(SolveReport **report);
+
+#endif
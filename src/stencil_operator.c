@@ -0,0 +1,204 @@
+#include "stencil_operator.h"
+#include "threading.h"
+
+// Ширина блока по x для 2D ядра: три соседние строки блока остаются в кэше
+#define STENCIL_BLOCK 512
+
+typedef struct {
+    PetscInt dim;           // 1 - трёхточечный Лаплас, 2 - пятиточечный Пуассон
+    PetscInt nx, ny, n;
+    PetscScalar diag;
+    PetscInt rstart, rend;
+    PetscInt halo;          // ширина ghost-зоны: 1 (1D) или nx (2D)
+    PetscInt nlo, nhi;      // число ghost-значений до rstart и после rend
+    Vec ghost;
+    VecScatter scatter;
+} StencilContext;
+
+// Значение x по глобальному индексу: локальная часть или ghost-буфер
+static inline PetscScalar stencil_get(const StencilContext *ctx, const PetscScalar *x, const PetscScalar *g, PetscInt gi) {
+    if (gi < ctx->rstart) return g[gi - (ctx->rstart - ctx->nlo)];
+    if (gi >= ctx->rend) return g[ctx->nlo + gi - ctx->rend];
+    return x[gi - ctx->rstart];
+}
+
+// Универсальная формула для строк, которым нужны ghost-значения
+static PetscScalar stencil_row(const StencilContext *ctx, const PetscScalar *x, const PetscScalar *g, PetscInt gi) {
+    PetscScalar v = ctx->diag * x[gi - ctx->rstart];
+    
+    if (ctx->dim == 1) {
+        if (gi > 0) v -= stencil_get(ctx, x, g, gi - 1);
+        if (gi < ctx->n - 1) v -= stencil_get(ctx, x, g, gi + 1);
+    } else {
+        PetscInt ix = gi % ctx->nx, iy = gi / ctx->nx;
+        if (iy > 0) v -= stencil_get(ctx, x, g, gi - ctx->nx);
+        if (ix > 0) v -= stencil_get(ctx, x, g, gi - 1);
+        if (ix < ctx->nx - 1) v -= stencil_get(ctx, x, g, gi + 1);
+        if (iy < ctx->ny - 1) v -= stencil_get(ctx, x, g, gi + ctx->nx);
+    }
+    return v;
+}
+
+// Внутренние строки 1D: все соседи локальные, цикл векторизуется компилятором
+static void stencil_interior_1d(const PetscScalar *restrict x, PetscScalar *restrict y, PetscInt lo, PetscInt hi, PetscScalar diag) {
+    PetscInt k;
+    SOLVER_OMP(parallel for simd schedule(static))
+    for (k = lo; k < hi; k++) {
+        y[k] = diag * x[k] - x[k-1] - x[k+1];
+    }
+}
+
+// Внутренние строки 2D (локальные индексы [lo, hi)): соседи по y локальные,
+// проверяются только границы по x. Обход блоками по x для повторного
+// использования строк x[iy-1], x[iy], x[iy+1] из кэша.
+static void stencil_interior_2d(const StencilContext *ctx, const PetscScalar *restrict x, PetscScalar *restrict y, PetscInt lo, PetscInt hi) {
+    const PetscInt nx = ctx->nx;
+    const PetscScalar diag = ctx->diag;
+    PetscInt glo = ctx->rstart + lo, ghi = ctx->rstart + hi;
+    PetscInt iy, ix0;
+    
+    if (lo >= hi) return;
+    
+    // Строки сетки делятся между потоками; каждый пишет только свои y[k]
+    for (ix0 = 0; ix0 < nx; ix0 += STENCIL_BLOCK) {
+        PetscInt ix1 = PetscMin(ix0 + STENCIL_BLOCK, nx);
+        SOLVER_OMP(parallel for schedule(static))
+        for (iy = glo / nx; iy <= (ghi - 1) / nx; iy++) {
+            PetscInt k, a, b;
+            a = PetscMax(iy * nx + ix0, glo) - ctx->rstart;
+            b = PetscMin(iy * nx + ix1, ghi) - ctx->rstart;
+            if (a >= b) continue;
+    
+            // Левая и правая граница сетки обрабатываются отдельно
+            if ((a + ctx->rstart) % nx == 0) {
+                y[a] = diag * x[a] - x[a-nx] - x[a+nx] - (nx > 1 ? x[a+1] : 0.0);
+                a++;
+            }
+            if (nx > 1 && a < b && (b - 1 + ctx->rstart) % nx == nx - 1) {
+                b--;
+                y[b] = diag * x[b] - x[b-nx] - x[b+nx] - x[b-1];
+            }
+            for (k = a; k < b; k++) {
+                y[k] = diag * x[k] - x[k-1] - x[k+1] - x[k-nx] - x[k+nx];
+            }
+        }
+    }
+}
+
+static PetscErrorCode stencil_mult(Mat A, Vec xv, Vec yv) {
+    PetscErrorCode ierr;
+    StencilContext *ctx;
+    const PetscScalar *x, *g;
+    PetscScalar *y;
+    PetscInt nlocal, lo, hi, k;
+    
+    ierr = MatShellGetContext(A, &ctx); CHKERRQ(ierr);
+    nlocal = ctx->rend - ctx->rstart;
+    
+    // Обмен ghost-значениями идёт параллельно с расчётом внутренних строк
+    ierr = VecScatterBegin(ctx->scatter, xv, ctx->ghost, INSERT_VALUES, SCATTER_FORWARD); CHKERRQ(ierr);
+    
+    ierr = VecGetArrayRead(xv, &x); CHKERRQ(ierr);
+    ierr = VecGetArray(yv, &y); CHKERRQ(ierr);
+    
+    lo = PetscMin(ctx->halo, nlocal);
+    hi = PetscMax(lo, nlocal - ctx->halo);
+    if (ctx->dim == 1) {
+        stencil_interior_1d(x, y, lo, hi, ctx->diag);
+    } else {
+        stencil_interior_2d(ctx, x, y, lo, hi);
+    }
+    
+    ierr = VecScatterEnd(ctx->scatter, xv, ctx->ghost, INSERT_VALUES, SCATTER_FORWARD); CHKERRQ(ierr);
+    
+    ierr = VecGetArrayRead(ctx->ghost, &g); CHKERRQ(ierr);
+    for (k = 0; k < lo; k++) y[k] = stencil_row(ctx, x, g, ctx->rstart + k);
+    for (k = hi; k < nlocal; k++) y[k] = stencil_row(ctx, x, g, ctx->rstart + k);
+    ierr = VecRestoreArrayRead(ctx->ghost, &g); CHKERRQ(ierr);
+    
+    ierr = VecRestoreArray(yv, &y); CHKERRQ(ierr);
+    ierr = VecRestoreArrayRead(xv, &x); CHKERRQ(ierr);
+    
+    return 0;
+}
+
+static PetscErrorCode stencil_get_diagonal(Mat A, Vec d) {
+    PetscErrorCode ierr;
+    StencilContext *ctx;
+    
+    ierr = MatShellGetContext(A, &ctx); CHKERRQ(ierr);
+    ierr = VecSet(d, ctx->diag); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode stencil_destroy(Mat A) {
+    PetscErrorCode ierr;
+    StencilContext *ctx;
+    
+    ierr = MatShellGetContext(A, &ctx); CHKERRQ(ierr);
+    ierr = VecScatterDestroy(&ctx->scatter); CHKERRQ(ierr);
+    ierr = VecDestroy(&ctx->ghost); CHKERRQ(ierr);
+    ierr = PetscFree(ctx); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode create_stencil_operator(PetscInt dim, PetscInt nx, PetscInt ny, Mat *A) {
+    PetscErrorCode ierr;
+    StencilContext *ctx;
+    PetscInt n = nx * ny, nlocal = PETSC_DECIDE, i, lo_start, hi_end, nghost;
+    PetscInt *idx;
+    IS is;
+    Vec xtmp;
+    
+    ierr = PetscNew(&ctx); CHKERRQ(ierr);
+    ctx->dim = dim;
+    ctx->nx = nx;
+    ctx->ny = ny;
+    ctx->n = n;
+    ctx->diag = (dim == 1) ? 2.0 : 4.0;
+    ctx->halo = (dim == 1) ? 1 : nx;
+    
+    // То же разбиение строк, что и у собранных матриц
+    ierr = PetscSplitOwnership(PETSC_COMM_WORLD, &nlocal, &n); CHKERRQ(ierr);
+    ierr = MPI_Scan(&nlocal, &ctx->rend, 1, MPIU_INT, MPI_SUM, PETSC_COMM_WORLD); CHKERRMPI(ierr);
+    ctx->rstart = ctx->rend - nlocal;
+    
+    // Ghost-зона: halo значений до и после локального диапазона
+    lo_start = PetscMax(0, ctx->rstart - ctx->halo);
+    hi_end = PetscMin(n, ctx->rend + ctx->halo);
+    ctx->nlo = nlocal ? ctx->rstart - lo_start : 0;
+    ctx->nhi = nlocal ? hi_end - ctx->rend : 0;
+    nghost = ctx->nlo + ctx->nhi;
+    
+    ierr = PetscMalloc1(nghost, &idx); CHKERRQ(ierr);
+    for (i = 0; i < ctx->nlo; i++) idx[i] = lo_start + i;
+    for (i = 0; i < ctx->nhi; i++) idx[ctx->nlo + i] = ctx->rend + i;
+    
+    ierr = ISCreateGeneral(PETSC_COMM_SELF, nghost, idx, PETSC_OWN_POINTER, &is); CHKERRQ(ierr);
+    ierr = VecCreateSeq(PETSC_COMM_SELF, nghost, &ctx->ghost); CHKERRQ(ierr);
+    ierr = VecCreateMPIWithArray(PETSC_COMM_WORLD, 1, nlocal, n, NULL, &xtmp); CHKERRQ(ierr);
+    ierr = VecScatterCreate(xtmp, is, ctx->ghost, NULL, &ctx->scatter); CHKERRQ(ierr);
+    ierr = VecDestroy(&xtmp); CHKERRQ(ierr);
+    ierr = ISDestroy(&is); CHKERRQ(ierr);
+    
+    ierr = MatCreateShell(PETSC_COMM_WORLD, nlocal, nlocal, n, n, ctx, A); CHKERRQ(ierr);
+    ierr = MatShellSetOperation(*A, MATOP_MULT, (void (*)(void))stencil_mult); CHKERRQ(ierr);
+    ierr = MatShellSetOperation(*A, MATOP_MULT_TRANSPOSE, (void (*)(void))stencil_mult); CHKERRQ(ierr);
+    ierr = MatShellSetOperation(*A, MATOP_GET_DIAGONAL, (void (*)(void))stencil_get_diagonal); CHKERRQ(ierr);
+    ierr = MatShellSetOperation(*A, MATOP_DESTROY, (void (*)(void))stencil_destroy); CHKERRQ(ierr);
+    ierr = MatSetOption(*A, MAT_SYMMETRIC, PETSC_TRUE); CHKERRQ(ierr);
+    
+    return 0;
+}
+
+PetscErrorCode create_laplace_operator(PetscInt n, Mat *A) {
+    PetscErrorCode ierr;
+    ierr = create_stencil_operator(1, n, 1, A); CHKERRQ(ierr);
+    return 0;
+}
+
+PetscErrorCode create_poisson2d_operator(PetscInt nx, PetscInt ny, Mat *A) {
+    PetscErrorCode ierr;
+    ierr = create_stencil_operator(2, nx, ny, A); CHKERRQ(ierr);
+    return 0;
+}
@@ -0,0 +1,11 @@
+#ifndef STENCIL_OPERATOR_H
+#define STENCIL_OPERATOR_H
+
+#include <petscksp.h>
+
+// Безматричные операторы с постоянными коэффициентами (MATSHELL).
+// Поддерживают MatMult и MatGetDiagonal, т.е. работают с GMRES и Jacobi.
+PetscErrorCode create_laplace_operator(PetscInt n, Mat *A);
+PetscErrorCode create_poisson2d_operator(PetscInt nx, PetscInt ny, Mat *A);
+
+#endif
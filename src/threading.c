@@ -0,0 +1,119 @@
+#include "threading.h"
+
+static PetscBool threads_initialized = PETSC_FALSE;
+static PetscInt threads_count = 1;
+
+PetscInt solver_threads_count(void) {
+    if (!threads_initialized) {
+#if defined(SOLVER_USE_OPENMP)
+        threads_count = (PetscInt)omp_get_max_threads();
+#endif
+        // Ошибка чтения опции здесь не критична: остаётся значение по умолчанию
+        (void)PetscOptionsGetInt(NULL, NULL, "-threads", &threads_count, NULL);
+        (void)solver_threads_set(threads_count);
+    }
+    return threads_count;
+}
+
+PetscErrorCode solver_threads_set(PetscInt nthreads) {
+    if (nthreads < 1) SETERRQ(PETSC_COMM_SELF, PETSC_ERR_ARG_OUTOFRANGE, "Number of threads must be positive");
+#if defined(SOLVER_USE_OPENMP)
+    omp_set_num_threads((int)nthreads);
+    threads_count = nthreads;
+#else
+    if (nthreads > 1) {
+        PetscErrorCode ierr;
+        ierr = PetscInfo(NULL, "Built without SOLVER_USE_OPENMP, running %" PetscInt_FMT " threads as 1\n", nthreads); CHKERRQ(ierr);
+    }
+    threads_count = 1;
+#endif
+    threads_initialized = PETSC_TRUE;
+    return 0;
+}
+
+// y = z + A*x для одного блока SeqAIJ (z == NULL - просто A*x); строки делятся между
+// потоками статически, каждый поток пишет только свои y[i], блокировок нет
+static PetscErrorCode threads_aij_kernel(Mat A, Vec xv, Vec zv, Vec yv) {
+    PetscErrorCode ierr;
+    const PetscInt *ia, *ja;
+    const PetscScalar *aa, *x, *z = NULL;
+    PetscScalar *y;
+    PetscInt m, i;
+    PetscBool done;
+    
+    ierr = MatGetRowIJ(A, 0, PETSC_FALSE, PETSC_FALSE, &m, &ia, &ja, &done); CHKERRQ(ierr);
+    if (!done) SETERRQ(PETSC_COMM_SELF, PETSC_ERR_SUP, "Cannot access CSR structure of the matrix block");
+    ierr = MatSeqAIJGetArrayRead(A, &aa); CHKERRQ(ierr);
+    ierr = VecGetArrayRead(xv, &x); CHKERRQ(ierr);
+    if (zv && zv != yv) { ierr = VecGetArrayRead(zv, &z); CHKERRQ(ierr); }
+    ierr = VecGetArray(yv, &y); CHKERRQ(ierr);
+    if (zv == yv) z = y;
+    
+    SOLVER_OMP(parallel for schedule(static))
+    for (i = 0; i < m; i++) {
+        PetscScalar sum = z ? z[i] : 0.0;
+        PetscInt k;
+        for (k = ia[i]; k < ia[i+1]; k++) sum += aa[k] * x[ja[k]];
+        y[i] = sum;
+    }
+    
+    ierr = VecRestoreArray(yv, &y); CHKERRQ(ierr);
+    if (zv && zv != yv) { ierr = VecRestoreArrayRead(zv, &z); CHKERRQ(ierr); }
+    ierr = VecRestoreArrayRead(xv, &x); CHKERRQ(ierr);
+    ierr = PetscLogFlops(2.0 * ia[m] - (zv ? 0 : m)); CHKERRQ(ierr);
+    ierr = MatSeqAIJRestoreArrayRead(A, &aa); CHKERRQ(ierr);
+    ierr = MatRestoreRowIJ(A, 0, PETSC_FALSE, PETSC_FALSE, &m, &ia, &ja, &done); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode threads_aij_mult(Mat A, Vec x, Vec y) {
+    return threads_aij_kernel(A, x, NULL, y);
+}
+
+static PetscErrorCode threads_aij_mult_add(Mat A, Vec x, Vec z, Vec y) {
+    return threads_aij_kernel(A, x, z, y);
+}
+
+PetscErrorCode solver_threads_enable_spmv(Mat A) {
+    PetscErrorCode ierr;
+    PetscBool seq, mpi;
+    Mat Ad, Ao;
+    
+    if (solver_threads_count() == 1) return 0;
+    ierr = PetscObjectTypeCompare((PetscObject)A, MATSEQAIJ, &seq); CHKERRQ(ierr);
+    ierr = PetscObjectTypeCompare((PetscObject)A, MATMPIAIJ, &mpi); CHKERRQ(ierr);
+    
+    if (seq) {
+        ierr = MatSetOperation(A, MATOP_MULT, (void (*)(void))threads_aij_mult); CHKERRQ(ierr);
+        ierr = MatSetOperation(A, MATOP_MULT_ADD, (void (*)(void))threads_aij_mult_add); CHKERRQ(ierr);
+    } else if (mpi) {
+        // MatMult_MPIAIJ вызывает mult диагонального блока и multadd внедиагонального,
+        // обмен ghost-значениями между ними остаётся за PETSc
+        ierr = MatMPIAIJGetSeqAIJ(A, &Ad, &Ao, NULL); CHKERRQ(ierr);
+        ierr = MatSetOperation(Ad, MATOP_MULT, (void (*)(void))threads_aij_mult); CHKERRQ(ierr);
+        ierr = MatSetOperation(Ao, MATOP_MULT_ADD, (void (*)(void))threads_aij_mult_add); CHKERRQ(ierr);
+    }
+    return 0;
+}
+
+PetscErrorCode solver_threads_first_touch(Vec v) {
+    PetscErrorCode ierr;
+    PetscBool standard;
+    const PetscScalar *old;
+    PetscScalar *fresh;
+    PetscInt n, i;
+    
+    if (solver_threads_count() == 1) return 0;
+    ierr = PetscObjectTypeCompareAny((PetscObject)v, &standard, VECSEQ, VECMPI, ""); CHKERRQ(ierr);
+    if (!standard) return 0;
+    
+    // Страницы нового массива попадают на NUMA-узел потока, который их первым записал
+    ierr = VecGetLocalSize(v, &n); CHKERRQ(ierr);
+    ierr = PetscMalloc1(n, &fresh); CHKERRQ(ierr);
+    ierr = VecGetArrayRead(v, &old); CHKERRQ(ierr);
+    SOLVER_OMP(parallel for schedule(static))
+    for (i = 0; i < n; i++) fresh[i] = old[i];
+    ierr = VecRestoreArrayRead(v, &old); CHKERRQ(ierr);
+    ierr = VecReplaceArray(v, fresh); CHKERRQ(ierr);
+    return 0;
+}
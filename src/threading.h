@@ -0,0 +1,35 @@
+#ifndef THREADING_H
+#define THREADING_H
+
+#include <petscmat.h>
+
+// Потоки внутри процесса (гибридный режим MPI + OpenMP). Без сборки с
+// SOLVER_USE_OPENMP все функции работают в одном потоке.
+#if defined(SOLVER_USE_OPENMP)
+#include <omp.h>
+#define SOLVER_PRAGMA(x) _Pragma(#x)
+#define SOLVER_OMP(x) SOLVER_PRAGMA(omp x)
+static inline PetscInt solver_thread_id(void) { return (PetscInt)omp_get_thread_num(); }
+#else
+#define SOLVER_OMP(x)
+static inline PetscInt solver_thread_id(void) { return 0; }
+#endif
+
+// Непрерывный участок [lo, hi) потока tid из nthreads: то же разбиение, что у
+// schedule(static), поэтому данные трогаются первым тем потоком, который с ними работает
+static inline void solver_thread_range(PetscInt n, PetscInt tid, PetscInt nthreads, PetscInt *lo, PetscInt *hi) {
+    PetscInt chunk = n / nthreads, rest = n % nthreads;
+    *lo = tid * chunk + PetscMin(tid, rest);
+    *hi = *lo + chunk + (tid < rest ? 1 : 0);
+}
+
+// Число потоков на процесс: -threads <n>, по умолчанию OMP_NUM_THREADS; читается при первом вызове
+PetscInt solver_threads_count(void);
+PetscErrorCode solver_threads_set(PetscInt nthreads);
+
+// Многопоточный SpMV для блоков AIJ (MATOP_MULT/MATOP_MULT_ADD); для других типов ничего не делает
+PetscErrorCode solver_threads_enable_spmv(Mat A);
+// Перенос массива вектора в память, первым тронутую потоками (first touch на NUMA-узлах)
+PetscErrorCode solver_threads_first_touch(Vec v);
+
+#endif
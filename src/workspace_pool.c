@@ -0,0 +1,229 @@
+#include "workspace_pool.h"
+#include "threading.h"
+
+// Запись пула: набор векторов (vecs) или KSP
+typedef struct {
+    MPI_Comm comm;
+    PetscLayout map;
+    PetscInt count;
+    Vec *vecs;
+    KSP ksp;
+    PetscLogDouble bytes;
+} WorkspaceEntry;
+
+static WorkspaceEntry pool[WORKSPACE_POOL_SIZE];
+static PetscInt pool_count = 0;
+static WorkspaceStats pool_stats = {0, 0, 0.0, 0.0, 0};
+static PetscBool pool_initialized = PETSC_FALSE, pool_enabled = PETSC_TRUE;
+
+static PetscErrorCode workspace_initialize(void) {
+    PetscErrorCode ierr;
+    
+    if (pool_initialized) return 0;
+    ierr = PetscOptionsGetBool(NULL, NULL, "-workspace_pool", &pool_enabled, NULL); CHKERRQ(ierr);
+    // Объекты пула должны быть уничтожены до проверки утечек в PetscFinalize
+    ierr = PetscRegisterFinalize(workspace_pool_clear); CHKERRQ(ierr);
+    pool_initialized = PETSC_TRUE;
+    return 0;
+}
+
+// Последний возвращённый подходящий набор (скорее всего ещё в кэше). Разбиение
+// хранится целиком на каждом процессе, поэтому выбор одинаков на всех процессах
+static PetscErrorCode workspace_find(MPI_Comm comm, PetscLayout map, PetscInt count, PetscBool want_ksp, PetscInt *slot) {
+    PetscErrorCode ierr;
+    PetscMPIInt result;
+    PetscBool same;
+    PetscInt k;
+    
+    *slot = -1;
+    for (k = pool_count - 1; k >= 0; k--) {
+        if ((pool[k].ksp != NULL) != want_ksp || pool[k].count != count) continue;
+        ierr = MPI_Comm_compare(pool[k].comm, comm, &result); CHKERRMPI(ierr);
+        if (result != MPI_IDENT && result != MPI_CONGRUENT) continue;
+        ierr = PetscLayoutCompare(pool[k].map, map, &same); CHKERRQ(ierr);
+        if (same) {
+            *slot = k;
+            break;
+        }
+    }
+    return 0;
+}
+
+static PetscErrorCode workspace_take(PetscInt slot) {
+    PetscErrorCode ierr;
+    PetscInt k;
+    
+    ierr = PetscLayoutDestroy(&pool[slot].map); CHKERRQ(ierr);
+    for (k = slot; k < pool_count - 1; k++) pool[k] = pool[k + 1];
+    pool_count--;
+    pool_stats.reuses++;
+    return 0;
+}
+
+static PetscErrorCode workspace_put(MPI_Comm comm, PetscLayout map, PetscInt count, Vec *vecs, KSP ksp, PetscLogDouble bytes) {
+    PetscErrorCode ierr;
+    WorkspaceEntry *entry = &pool[pool_count++];
+    
+    entry->comm = comm;
+    entry->map = NULL;
+    ierr = PetscLayoutReference(map, &entry->map); CHKERRQ(ierr);
+    entry->count = count;
+    entry->vecs = vecs;
+    entry->ksp = ksp;
+    entry->bytes = bytes;
+    return 0;
+}
+
+PetscErrorCode workspace_get_vecs(MPI_Comm comm, PetscLayout map, PetscInt count, Vec **vecs) {
+    PetscErrorCode ierr;
+    PetscInt slot, nlocal, N, k;
+    PetscLogDouble bytes;
+    
+    ierr = workspace_initialize(); CHKERRQ(ierr);
+    ierr = PetscLayoutGetLocalSize(map, &nlocal); CHKERRQ(ierr);
+    ierr = PetscLayoutGetSize(map, &N); CHKERRQ(ierr);
+    bytes = (PetscLogDouble)count * nlocal * sizeof(PetscScalar);
+    
+    if (pool_enabled) {
+        ierr = workspace_find(comm, map, count, PETSC_FALSE, &slot); CHKERRQ(ierr);
+        if (slot >= 0) {
+            *vecs = pool[slot].vecs;
+            ierr = workspace_take(slot); CHKERRQ(ierr);
+            pool_stats.bytes_reused += bytes;
+            for (k = 0; k < count; k++) { ierr = VecZeroEntries((*vecs)[k]); CHKERRQ(ierr); }
+            return 0;
+        }
+    }
+    
+    ierr = PetscMalloc1(count, vecs); CHKERRQ(ierr);
+    for (k = 0; k < count; k++) {
+        if (k == 0) {
+            ierr = VecCreate(comm, &(*vecs)[0]); CHKERRQ(ierr);
+            ierr = VecSetSizes((*vecs)[0], nlocal, N); CHKERRQ(ierr);
+            ierr = VecSetType((*vecs)[0], VECSTANDARD); CHKERRQ(ierr);
+        } else {
+            ierr = VecDuplicate((*vecs)[0], &(*vecs)[k]); CHKERRQ(ierr);
+        }
+        ierr = solver_threads_first_touch((*vecs)[k]); CHKERRQ(ierr);
+    }
+    pool_stats.allocations++;
+    pool_stats.bytes_allocated += bytes;
+    return 0;
+}
+
+PetscErrorCode workspace_return_vecs(PetscInt count, Vec **vecs) {
+    PetscErrorCode ierr;
+    PetscLayout map;
+    PetscInt nlocal;
+    
+    if (!*vecs) return 0;
+    ierr = workspace_initialize(); CHKERRQ(ierr);
+    if (!pool_enabled || pool_count == WORKSPACE_POOL_SIZE) {
+        ierr = VecDestroyVecs(count, vecs); CHKERRQ(ierr);
+        return 0;
+    }
+    ierr = VecGetLayout((*vecs)[0], &map); CHKERRQ(ierr);
+    ierr = VecGetLocalSize((*vecs)[0], &nlocal); CHKERRQ(ierr);
+    ierr = workspace_put(PetscObjectComm((PetscObject)(*vecs)[0]), map, count, *vecs, NULL,
+                         (PetscLogDouble)count * nlocal * sizeof(PetscScalar)); CHKERRQ(ierr);
+    *vecs = NULL;
+    return 0;
+}
+
+PetscErrorCode workspace_get_ksp(MPI_Comm comm, PetscLayout map, KSP *ksp, PetscBool *reused) {
+    PetscErrorCode ierr;
+    PetscInt slot = -1;
+    
+    ierr = workspace_initialize(); CHKERRQ(ierr);
+    if (pool_enabled) { ierr = workspace_find(comm, map, 0, PETSC_TRUE, &slot); CHKERRQ(ierr); }
+    *reused = (PetscBool)(slot >= 0);
+    if (*reused) {
+        *ksp = pool[slot].ksp;
+        pool_stats.bytes_reused += pool[slot].bytes;
+        ierr = workspace_take(slot); CHKERRQ(ierr);
+        return 0;
+    }
+    ierr = KSPCreate(comm, ksp); CHKERRQ(ierr);
+    pool_stats.allocations++;
+    return 0;
+}
+
+PetscErrorCode workspace_return_ksp(KSP *ksp, PetscLogDouble bytes, PetscBool reused) {
+    PetscErrorCode ierr;
+    PetscBool is_gmres;
+    PetscInt restart;
+    void *converged_ctx;
+    PC pc;
+    Mat A;
+    PetscLayout map;
+    
+    if (!*ksp) return 0;
+    ierr = workspace_initialize(); CHKERRQ(ierr);
+    // Базис нового KSP выделен им самим при настройке: учитывается при первом возврате
+    if (!reused) pool_stats.bytes_allocated += bytes;
+    if (!pool_enabled || pool_count == WORKSPACE_POOL_SIZE) {
+        ierr = KSPDestroy(ksp); CHKERRQ(ierr);
+        return 0;
+    }
+    
+    ierr = KSPGetOperators(*ksp, &A, NULL); CHKERRQ(ierr);
+    ierr = MatGetLayouts(A, NULL, &map); CHKERRQ(ierr);
+    ierr = PetscLayoutReference(map, &map); CHKERRQ(ierr);
+    
+    // Новый PC освобождает матрицы и данные предобуславливателя, базис KSP остаётся
+    ierr = PCCreate(PetscObjectComm((PetscObject)*ksp), &pc); CHKERRQ(ierr);
+    ierr = KSPSetPC(*ksp, pc); CHKERRQ(ierr);
+    ierr = PCDestroy(&pc); CHKERRQ(ierr);
+    
+    // Настройки, которые solver_create не задаёт заново, - к значениям по умолчанию
+    ierr = KSPMonitorCancel(*ksp); CHKERRQ(ierr);
+    ierr = KSPConvergedDefaultCreate(&converged_ctx); CHKERRQ(ierr);
+    ierr = KSPSetConvergenceTest(*ksp, KSPConvergedDefault, converged_ctx, KSPConvergedDefaultDestroy); CHKERRQ(ierr);
+    ierr = KSPSetInitialGuessNonzero(*ksp, PETSC_FALSE); CHKERRQ(ierr);
+    ierr = KSPSetReusePreconditioner(*ksp, PETSC_FALSE); CHKERRQ(ierr);
+    ierr = KSPSetPCSide(*ksp, PC_SIDE_DEFAULT); CHKERRQ(ierr);
+    ierr = PetscObjectTypeCompare((PetscObject)*ksp, KSPGMRES, &is_gmres); CHKERRQ(ierr);
+    if (is_gmres) {
+        ierr = KSPGMRESSetOrthogonalization(*ksp, KSPGMRESClassicalGramSchmidtOrthogonalization); CHKERRQ(ierr);
+        ierr = KSPGMRESSetCGSRefinementType(*ksp, KSP_GMRES_CGS_REFINE_NEVER); CHKERRQ(ierr);
+        // Нестандартный рестарт пересоздаёт базис, но не переходит к следующему решателю
+        ierr = KSPGMRESGetRestart(*ksp, &restart); CHKERRQ(ierr);
+        if (restart != 30) { ierr = KSPGMRESSetRestart(*ksp, 30); CHKERRQ(ierr); }
+    }
+    
+    ierr = workspace_put(PetscObjectComm((PetscObject)*ksp), map, 0, NULL, *ksp, bytes); CHKERRQ(ierr);
+    ierr = PetscLayoutDestroy(&map); CHKERRQ(ierr);
+    *ksp = NULL;
+    return 0;
+}
+
+PetscErrorCode workspace_get_stats(WorkspaceStats *stats) {
+    *stats = pool_stats;
+    stats->idle = pool_count;
+    return 0;
+}
+
+PetscErrorCode workspace_print_stats(void) {
+    PetscPrintf(PETSC_COMM_WORLD, "Workspace pool: %" PetscInt_FMT " allocations (%.1f MB), %" PetscInt_FMT " reuses (%.1f MB), %" PetscInt_FMT " idle\n",
+                pool_stats.allocations, pool_stats.bytes_allocated / 1048576.0, pool_stats.reuses,
+                pool_stats.bytes_reused / 1048576.0, pool_count);
+    return 0;
+}
+
+PetscErrorCode workspace_pool_clear(void) {
+    PetscErrorCode ierr;
+    PetscInt k;
+    
+    for (k = 0; k < pool_count; k++) {
+        if (pool[k].ksp) {
+            ierr = KSPDestroy(&pool[k].ksp); CHKERRQ(ierr);
+        } else {
+            ierr = VecDestroyVecs(pool[k].count, &pool[k].vecs); CHKERRQ(ierr);
+        }
+        ierr = PetscLayoutDestroy(&pool[k].map); CHKERRQ(ierr);
+    }
+    pool_count = 0;
+    // Следующее использование после PetscFinalize/PetscInitialize регистрирует очистку заново
+    pool_initialized = PETSC_FALSE;
+    return 0;
+}
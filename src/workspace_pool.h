@@ -0,0 +1,35 @@
+#ifndef WORKSPACE_POOL_H
+#define WORKSPACE_POOL_H
+
+#include <petscksp.h>
+
+// Пул рабочих векторов и KSP, общий для всех решателей процесса. Набор векторов
+// выдаётся по (коммуникатор, разбиение, число векторов), KSP - по (коммуникатор,
+// разбиение): выделенный при прошлой настройке базис Крылова остаётся за ним.
+// Вызовы коллективные и идут на всех процессах в одном порядке. Пул включён по
+// умолчанию (-workspace_pool 0 - выключен) и очищается в PetscFinalize.
+
+// Размер пула: при переполнении возвращаемые наборы уничтожаются
+#define WORKSPACE_POOL_SIZE 32
+
+// Метрики на процесс; байты - векторы и базис Крылова (модель solver_krylov_memory)
+typedef struct {
+    PetscInt allocations;           // созданных наборов векторов и KSP
+    PetscInt reuses;                // выдач из пула
+    PetscLogDouble bytes_allocated;
+    PetscLogDouble bytes_reused;
+    PetscInt idle;                  // наборов в пуле сейчас
+} WorkspaceStats;
+
+// Векторы обнулены; возвращаются целым набором той же длины count
+PetscErrorCode workspace_get_vecs(MPI_Comm comm, PetscLayout map, PetscInt count, Vec **vecs);
+PetscErrorCode workspace_return_vecs(PetscInt count, Vec **vecs);
+// reused - KSP взят из пула; при возврате предобуславливатель и мониторы сбрасываются,
+// bytes - память его базиса
+PetscErrorCode workspace_get_ksp(MPI_Comm comm, PetscLayout map, KSP *ksp, PetscBool *reused);
+PetscErrorCode workspace_return_ksp(KSP *ksp, PetscLogDouble bytes, PetscBool reused);
+PetscErrorCode workspace_get_stats(WorkspaceStats *stats);
+PetscErrorCode workspace_print_stats(void);
+PetscErrorCode workspace_pool_clear(void);
+
+#endif
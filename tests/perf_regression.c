@@ -0,0 +1,291 @@
+#include <petscksp.h>
+#include <petsctime.h>
+#include "../src/solver.h"
+#include "../src/benchmark.h"
+
+// Проверка производительности против базовых значений из tests/perf_baselines.csv.
+// Каждый сценарий (задача, предобуславливатель) решается warmup + repeat раз, по
+// повторам берутся медианы времени настройки, решения и SpMV. Сценарий считается
+// регрессией, если медиана медленнее базовой больше чем на -perf_tolerance (и больше
+// чем на -perf_min_time секунд), выросло число итераций или перестал сходиться.
+// Базовые значения свои для каждого числа процессов; -perf_update записывает текущие.
+// С -perf_require_baselines (make perf) сценарий без базы тоже даёт ненулевой код возврата.
+
+#define PERF_MAX_BASELINES 256
+#define PERF_NAME_LEN 64
+
+typedef struct {
+    const char *problem;
+    PetscInt size;
+    PCType pc_type;
+} PerfScenario;
+
+// Размеры - глобальные, одинаковые при любом числе процессов
+static const PerfScenario perf_scenarios[] = {
+    {"laplace", 10000, PCNONE},
+    {"laplace", 10000, PCJACOBI},
+    {"laplace", 10000, PCBJACOBI},
+    {"laplace", 10000, PCSOR},
+    {"laplace", 10000, PCASM},
+    {"laplace", 10000, PCGAMG},
+    {"poisson2d", 10000, PCNONE},
+    {"poisson2d", 10000, PCJACOBI},
+    {"poisson2d", 10000, PCBJACOBI},
+    {"poisson2d", 10000, PCSOR},
+    {"poisson2d", 10000, PCASM},
+    {"poisson2d", 10000, PCGAMG},
+    {"poisson2d_grid", 16641, PCMG},
+    {"random", 10000, PCNONE},
+    {"random", 10000, PCJACOBI},
+    {"random", 10000, PCBJACOBI},
+    {"random", 10000, PCSOR},
+    {"random", 10000, PCASM},
+    {"random", 10000, PCGAMG},
+};
+
+// Строка файла базовых значений (и результат текущего запуска)
+typedef struct {
+    char name[PERF_NAME_LEN];       // <задача>/<предобуславливатель>
+    PetscMPIInt nranks;
+    PetscInt iterations;
+    PetscLogDouble setup_median;
+    PetscLogDouble solve_median;
+    PetscLogDouble spmv_median;
+    PetscReal spmv_gbs;
+    PetscBool converged;
+} PerfRecord;
+
+typedef struct {
+    PetscReal tolerance;            // допустимое относительное замедление
+    PetscLogDouble min_time;        // замедление меньше этого - шум таймера
+    PetscReal iteration_tolerance;  // допустимый относительный рост итераций
+} PerfThresholds;
+
+// Файл читается на процессе 0 и рассылается; отсутствующий файл - пустой набор
+static PetscErrorCode perf_read_baselines(const char *filename, PerfRecord baselines[], PetscInt *count) {
+    PetscErrorCode ierr;
+    PetscMPIInt rank;
+    PetscInt n = 0;
+    
+    ierr = MPI_Comm_rank(PETSC_COMM_WORLD, &rank); CHKERRMPI(ierr);
+    if (rank == 0) {
+        FILE *fd = fopen(filename, "r");
+        char line[512];
+    
+        while (fd && fgets(line, sizeof(line), fd)) {
+            PerfRecord *r = &baselines[n];
+            int nranks, converged;
+            long iterations;
+            double setup, solve, spmv, gbs;
+    
+            if (line[0] == '#' || line[0] == '\n') continue;
+            if (sscanf(line, "%63[^,],%d,%ld,%lf,%lf,%lf,%lf,%d", r->name, &nranks, &iterations,
+                       &setup, &solve, &spmv, &gbs, &converged) != 8) continue;  // заголовок
+            if (n == PERF_MAX_BASELINES) SETERRQ(PETSC_COMM_SELF, PETSC_ERR_ARG_SIZ, "Too many baselines in %s", filename);
+            r->nranks = nranks;
+            r->iterations = (PetscInt)iterations;
+            r->setup_median = setup;
+            r->solve_median = solve;
+            r->spmv_median = spmv;
+            r->spmv_gbs = gbs;
+            r->converged = (PetscBool)(converged != 0);
+            n++;
+        }
+        if (fd) fclose(fd);
+    }
+    ierr = MPI_Bcast(&n, 1, MPIU_INT, 0, PETSC_COMM_WORLD); CHKERRMPI(ierr);
+    ierr = MPI_Bcast(baselines, (PetscMPIInt)(n * sizeof(PerfRecord)), MPI_BYTE, 0, PETSC_COMM_WORLD); CHKERRMPI(ierr);
+    *count = n;
+    return 0;
+}
+
+static PetscErrorCode perf_write_baselines(const char *filename, const PerfRecord baselines[], PetscInt count) {
+    PetscErrorCode ierr;
+    FILE *fd;
+    PetscInt i;
+    
+    ierr = PetscFOpen(PETSC_COMM_WORLD, filename, "w", &fd); CHKERRQ(ierr);
+    ierr = PetscFPrintf(PETSC_COMM_WORLD, fd, "# Базовые значения make perf; обновление - make perf-baseline на эталонной машине\n"); CHKERRQ(ierr);
+    ierr = PetscFPrintf(PETSC_COMM_WORLD, fd, "scenario,nranks,iterations,setup_median,solve_median,spmv_median,spmv_gbs,converged\n"); CHKERRQ(ierr);
+    for (i = 0; i < count; i++) {
+        const PerfRecord *r = &baselines[i];
+        ierr = PetscFPrintf(PETSC_COMM_WORLD, fd, "%s,%d,%" PetscInt_FMT ",%.6e,%.6e,%.6e,%.3f,%d\n",
+                            r->name, r->nranks, r->iterations, r->setup_median, r->solve_median,
+                            r->spmv_median, (double)r->spmv_gbs, (int)r->converged); CHKERRQ(ierr);
+    }
+    ierr = PetscFClose(PETSC_COMM_WORLD, fd); CHKERRQ(ierr);
+    return 0;
+}
+
+static PetscErrorCode perf_find_baseline(PerfRecord baselines[], PetscInt count, const char *name, PetscMPIInt nranks, PerfRecord **found) {
+    PetscErrorCode ierr;
+    PetscBool match;
+    PetscInt i;
+    
+    *found = NULL;
+    for (i = 0; i < count; i++) {
+        if (baselines[i].nranks != nranks) continue;
+        ierr = PetscStrcmp(baselines[i].name, name, &match); CHKERRQ(ierr);
+        if (match) {
+            *found = &baselines[i];
+            break;
+        }
+    }
+    return 0;
+}
+
+// Медленнее базового значения сверх допуска и сверх разрешения таймера
+static PetscBool perf_slower(PetscLogDouble value, PetscLogDouble base, const PerfThresholds *th) {
+    return (PetscBool)(value > base * (1.0 + th->tolerance) && value - base > th->min_time);
+}
+
+static PetscErrorCode perf_run_scenario(const PerfScenario *scenario, PetscInt warmup, PetscInt repeats, PerfRecord *record) {
+    PetscErrorCode ierr;
+    PetscLogDouble *setup, *solve, *spmv, assembly_time, bytes;
+    PetscInt N, r;
+    SolverConfig config;
+    SolverResult result;
+    Mat A;
+    Vec b, x;
+    
+    ierr = benchmark_create_problem(scenario->problem, scenario->size, PETSC_FALSE, &A, &N, &assembly_time); CHKERRQ(ierr);
+    ierr = MatCreateVecs(A, &x, &b); CHKERRQ(ierr);
+    ierr = VecSet(b, 1.0); CHKERRQ(ierr);
+    ierr = solver_spmv_bytes(A, &bytes); CHKERRQ(ierr);
+    ierr = PetscMalloc3(repeats, &setup, repeats, &solve, repeats, &spmv); CHKERRQ(ierr);
+    
+    config.ksp_type = KSPGMRES;
+    config.pc_type = scenario->pc_type;
+    config.restart = 0;
+    record->converged = PETSC_TRUE;
+    
+    for (r = -warmup; r < repeats; r++) {
+        PetscLogDouble times[2], spmv_time;
+    
+        ierr = VecSet(x, 0.0); CHKERRQ(ierr);
+        ierr = solver_benchmark_config(A, b, x, &config, &result); CHKERRQ(ierr);
+        ierr = solver_time_spmv(A, &spmv_time); CHKERRQ(ierr);
+        // Конфигурация работает со скоростью самого медленного процесса
+        times[0] = result.setup_time;
+        times[1] = result.solve_time;
+        ierr = MPI_Allreduce(MPI_IN_PLACE, times, 2, MPI_DOUBLE, MPI_MAX, PETSC_COMM_WORLD); CHKERRMPI(ierr);
+    
+        // Прогревочные повторы не учитываются
+        if (r < 0) continue;
+        setup[r] = times[0];
+        solve[r] = times[1];
+        spmv[r] = spmv_time;
+        record->iterations = result.iterations;
+        if (!result.converged) record->converged = PETSC_FALSE;
+    }
+    
+    ierr = benchmark_median(setup, repeats, &record->setup_median); CHKERRQ(ierr);
+    ierr = benchmark_median(solve, repeats, &record->solve_median); CHKERRQ(ierr);
+    ierr = benchmark_median(spmv, repeats, &record->spmv_median); CHKERRQ(ierr);
+    record->spmv_gbs = record->spmv_median > 0.0 ? bytes / record->spmv_median / 1e9 : 0.0;
+    
+    ierr = PetscFree3(setup, solve, spmv); CHKERRQ(ierr);
+    ierr = MatDestroy(&A); CHKERRQ(ierr);
+    ierr = VecDestroy(&b); CHKERRQ(ierr);
+    ierr = VecDestroy(&x); CHKERRQ(ierr);
+    return 0;
+}
+
+// Сравнение с базой: причина регрессии в reason, "" - регрессии нет
+static PetscErrorCode perf_compare(const PerfRecord *current, const PerfRecord *base, const PerfThresholds *th, char reason[], size_t len) {
+    PetscErrorCode ierr;
+    PetscInt allowed_its;
+    
+    reason[0] = '\0';
+    allowed_its = base->iterations + PetscMax(1, (PetscInt)(th->iteration_tolerance * base->iterations));
+    if (base->converged && !current->converged) {
+        ierr = PetscStrncpy(reason, "no longer converges", len); CHKERRQ(ierr);
+    } else if (current->iterations > allowed_its) {
+        ierr = PetscSNPrintf(reason, len, "iterations %" PetscInt_FMT " > %" PetscInt_FMT, current->iterations, base->iterations); CHKERRQ(ierr);
+    } else if (perf_slower(current->solve_median, base->solve_median, th)) {
+        ierr = PetscSNPrintf(reason, len, "solve %+.0f%%", 100.0 * (current->solve_median / base->solve_median - 1.0)); CHKERRQ(ierr);
+    } else if (perf_slower(current->setup_median, base->setup_median, th)) {
+        ierr = PetscSNPrintf(reason, len, "setup %+.0f%%", 100.0 * (current->setup_median / base->setup_median - 1.0)); CHKERRQ(ierr);
+    } else if (perf_slower(current->spmv_median, base->spmv_median, th)) {
+        ierr = PetscSNPrintf(reason, len, "SpMV %.2f < %.2f GB/s", (double)current->spmv_gbs, (double)base->spmv_gbs); CHKERRQ(ierr);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    PetscErrorCode ierr;
+    PerfRecord *baselines, current, *base;
+    PerfThresholds th = {0.15, 1e-3, 0.1};
+    PetscInt nbaselines, nscenarios = sizeof(perf_scenarios) / sizeof(perf_scenarios[0]);
+    PetscInt warmup = 1, repeats = 5, s, regressions = 0, missing = 0;
+    PetscBool update = PETSC_FALSE, require = PETSC_FALSE;
+    PetscMPIInt nranks;
+    char filename[PETSC_MAX_PATH_LEN] = "tests/perf_baselines.csv", reason[128];
+    
+    ierr = solver_initialize(argc, argv); CHKERRQ(ierr);
+    ierr = MPI_Comm_size(PETSC_COMM_WORLD, &nranks); CHKERRMPI(ierr);
+    
+    ierr = PetscOptionsGetString(NULL, NULL, "-perf_baselines", filename, sizeof(filename), NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetBool(NULL, NULL, "-perf_update", &update, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetBool(NULL, NULL, "-perf_require_baselines", &require, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetInt(NULL, NULL, "-perf_warmup", &warmup, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetInt(NULL, NULL, "-perf_repeat", &repeats, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetReal(NULL, NULL, "-perf_tolerance", &th.tolerance, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetReal(NULL, NULL, "-perf_iteration_tolerance", &th.iteration_tolerance, NULL); CHKERRQ(ierr);
+    ierr = PetscOptionsGetReal(NULL, NULL, "-perf_min_time", &th.min_time, NULL); CHKERRQ(ierr);
+    if (repeats < 1) SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_ARG_OUTOFRANGE, "-perf_repeat must be positive");
+    
+    ierr = PetscMalloc1(PERF_MAX_BASELINES, &baselines); CHKERRQ(ierr);
+    ierr = perf_read_baselines(filename, baselines, &nbaselines); CHKERRQ(ierr);
+    
+    PetscPrintf(PETSC_COMM_WORLD, "Performance regression: %d ranks, %" PetscInt_FMT " warm-up + %" PetscInt_FMT " repeats, tolerance %.0f%%, baselines %s\n",
+                nranks, warmup, repeats, 100.0 * th.tolerance, filename);
+    PetscPrintf(PETSC_COMM_WORLD, "%-20s %6s %6s %10s %10s %10s %10s %8s  %s\n",
+                "scenario", "its", "base", "setup", "solve", "base", "change", "GB/s", "status");
+    
+    for (s = 0; s < nscenarios; s++) {
+        ierr = PetscSNPrintf(current.name, sizeof(current.name), "%s/%s", perf_scenarios[s].problem, perf_scenarios[s].pc_type); CHKERRQ(ierr);
+        current.nranks = nranks;
+        ierr = perf_run_scenario(&perf_scenarios[s], warmup, repeats, &current); CHKERRQ(ierr);
+        ierr = perf_find_baseline(baselines, nbaselines, current.name, nranks, &base); CHKERRQ(ierr);
+    
+        if (update) {
+            // Новое значение заменяет старое для этого числа процессов
+            if (!base) {
+                if (nbaselines == PERF_MAX_BASELINES) SETERRQ(PETSC_COMM_WORLD, PETSC_ERR_ARG_SIZ, "Too many baselines");
+                base = &baselines[nbaselines++];
+            }
+            *base = current;
+            ierr = PetscStrncpy(reason, "updated", sizeof(reason)); CHKERRQ(ierr);
+        } else if (!base) {
+            missing++;
+            ierr = PetscStrncpy(reason, "no baseline", sizeof(reason)); CHKERRQ(ierr);
+        } else {
+            ierr = perf_compare(&current, base, &th, reason, sizeof(reason)); CHKERRQ(ierr);
+            if (reason[0]) {
+                regressions++;
+            } else {
+                ierr = PetscStrncpy(reason, "ok", sizeof(reason)); CHKERRQ(ierr);
+            }
+        }
+    
+        PetscPrintf(PETSC_COMM_WORLD, "%-20s %6" PetscInt_FMT " %6" PetscInt_FMT " %10.3e %10.3e %10.3e %+9.1f%% %8.2f  %s%s\n",
+                    current.name, current.iterations, (base && !update) ? base->iterations : current.iterations,
+                    current.setup_median, current.solve_median, (base && !update) ? base->solve_median : current.solve_median,
+                    (base && !update && base->solve_median > 0.0) ? 100.0 * (current.solve_median / base->solve_median - 1.0) : 0.0,
+                    (double)current.spmv_gbs, current.converged ? "" : "(not converged) ", reason);
+    }
+    
+    if (update) {
+        ierr = perf_write_baselines(filename, baselines, nbaselines); CHKERRQ(ierr);
+        PetscPrintf(PETSC_COMM_WORLD, "Baselines for %d ranks written to %s\n", nranks, filename);
+    } else {
+        PetscPrintf(PETSC_COMM_WORLD, "%" PetscInt_FMT " of %" PetscInt_FMT " scenarios regressed, %" PetscInt_FMT " without baseline%s\n",
+                    regressions, nscenarios, missing, (require && missing) ? " (baselines required: run make perf-baseline)" : "");
+    }
+    ierr = PetscFree(baselines); CHKERRQ(ierr);
+    
+    ierr = solver_finalize();
+    if (ierr) return ierr;
+    return (regressions || (require && !update && missing)) ? 1 : 0;
+}